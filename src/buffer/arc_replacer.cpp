@@ -0,0 +1,231 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// arc_replacer.cpp
+//
+// Identification: src/buffer/arc_replacer.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/arc_replacer.h"
+
+#include <algorithm>
+#include <exception>
+#include <iterator>
+
+namespace bustub {
+
+ARCReplacer::ARCReplacer(size_t num_frames) : num_frames_(num_frames), capacity_(num_frames), frames_(num_frames) {}
+
+void ARCReplacer::Insert(frame_id_t frame_id, ListType list) {
+  auto &list_frames = ListOf(list);
+  list_frames.push_front(frame_id);
+  frames_[frame_id].list_ = list;
+  frames_[frame_id].pos_ = list_frames.begin();
+}
+
+void ARCReplacer::Unlink(frame_id_t frame_id) {
+  auto &info = frames_[frame_id];
+  ListOf(info.list_).erase(info.pos_);
+  info.list_ = ListType::None;
+}
+
+auto ARCReplacer::LruEvictable(const std::list<frame_id_t> &list) -> frame_id_t {
+  for (auto it = list.rbegin(); it != list.rend(); it++) {
+    evict_scan_length_.fetch_add(1, std::memory_order_relaxed);
+    if (frames_[*it].is_evictable_) {
+      return *it;
+    }
+  }
+  return -1;
+}
+
+void ARCReplacer::AddGhost(page_id_t page_id, bool in_b2) {
+  auto &ghost_list = in_b2 ? b2_ : b1_;
+  ghost_list.push_front(page_id);
+  ghosts_[page_id] = GhostEntry{in_b2, ghost_list.begin()};
+  // the paper's bounds: |T1| + |B1| <= c and all four lists together <= 2c
+  while (t1_.size() + b1_.size() > capacity_ && !b1_.empty()) {
+    DropGhost(b1_.back());
+  }
+  while (b1_.size() + b2_.size() > capacity_ && !b2_.empty()) {
+    DropGhost(b2_.back());
+  }
+}
+
+void ARCReplacer::DropGhost(page_id_t page_id) {
+  auto it = ghosts_.find(page_id);
+  (it->second.in_b2_ ? b2_ : b1_).erase(it->second.pos_);
+  ghosts_.erase(it);
+}
+
+void ARCReplacer::RecordFrameAccess(frame_id_t frame_id, AccessType access_type, page_id_t page_id) {
+  BUSTUB_ASSERT(frame_id >= 0 && static_cast<size_t>(frame_id) < num_frames_, "invalid frame id");
+  std::lock_guard<std::mutex> lock(latch_);
+  auto &info = frames_[frame_id];
+  if (info.list_ != ListType::None) {
+    // a hit, the page has now been used more than once
+    if (access_type != AccessType::Scan) {
+      Unlink(frame_id);
+      Insert(frame_id, ListType::T2);
+    }
+    return;
+  }
+
+  auto list = ListType::T1;
+  auto ghost = page_id == INVALID_PAGE_ID ? ghosts_.end() : ghosts_.find(page_id);
+  if (ghost != ghosts_.end()) {
+    if (access_type != AccessType::Scan) {
+      auto b1 = b1_.size();
+      auto b2 = b2_.size();
+      if (ghost->second.in_b2_) {
+        target_ -= std::min(target_, std::max<size_t>(1, b1 / b2));
+      } else {
+        target_ = std::min(capacity_, target_ + std::max<size_t>(1, b2 / b1));
+      }
+      list = ListType::T2;
+    }
+    DropGhost(page_id);
+  }
+  info.page_id_ = page_id;
+  info.is_evictable_ = true;
+  curr_size_++;
+  Insert(frame_id, list);
+}
+
+void ARCReplacer::Restore(frame_id_t frame_id, page_id_t page_id) {
+  BUSTUB_ASSERT(frame_id >= 0 && static_cast<size_t>(frame_id) < num_frames_, "invalid frame id");
+  std::lock_guard<std::mutex> lock(latch_);
+  auto &info = frames_[frame_id];
+  if (info.list_ != ListType::None) {
+    return;
+  }
+  auto list = ListType::T1;
+  auto ghost = page_id == INVALID_PAGE_ID ? ghosts_.end() : ghosts_.find(page_id);
+  if (ghost != ghosts_.end()) {
+    // Evict made the page a ghost of the list it took the frame from
+    list = ghost->second.in_b2_ ? ListType::T2 : ListType::T1;
+    DropGhost(page_id);
+  }
+  info.page_id_ = page_id;
+  info.is_evictable_ = true;
+  curr_size_++;
+  // back at the LRU end, where Evict found it
+  auto &list_frames = ListOf(list);
+  list_frames.push_back(frame_id);
+  info.list_ = list;
+  info.pos_ = std::prev(list_frames.end());
+}
+
+void ARCReplacer::SetEvictable(frame_id_t frame_id, bool set_evictable) {
+  BUSTUB_ASSERT(frame_id >= 0 && static_cast<size_t>(frame_id) < num_frames_, "invalid frame id");
+  std::lock_guard<std::mutex> lock(latch_);
+  auto &info = frames_[frame_id];
+  if (info.list_ == ListType::None || info.is_evictable_ == set_evictable) {
+    return;
+  }
+  info.is_evictable_ = set_evictable;
+  if (set_evictable) {
+    curr_size_++;
+  } else {
+    curr_size_--;
+  }
+}
+
+void ARCReplacer::Remove(frame_id_t frame_id) {
+  BUSTUB_ASSERT(frame_id >= 0 && static_cast<size_t>(frame_id) < num_frames_, "invalid frame id");
+  std::lock_guard<std::mutex> lock(latch_);
+  auto &info = frames_[frame_id];
+  if (info.list_ == ListType::None) {
+    return;
+  }
+  if (!info.is_evictable_) {
+    throw std::exception();
+  }
+  // the page is gone for good, so it does not become a ghost
+  Unlink(frame_id);
+  info = FrameInfo();
+  curr_size_--;
+}
+
+auto ARCReplacer::Evict(frame_id_t *frame_id) -> bool {
+  std::lock_guard<std::mutex> lock(latch_);
+  evict_calls_.fetch_add(1, std::memory_order_relaxed);
+  if (curr_size_ == 0) {
+    return false;
+  }
+  bool from_t1 = t1_.size() > target_;
+  auto victim = LruEvictable(from_t1 ? t1_ : t2_);
+  if (victim == -1) {
+    from_t1 = !from_t1;
+    victim = LruEvictable(from_t1 ? t1_ : t2_);
+  }
+  BUSTUB_ASSERT(victim != -1, "evictable frames must be in T1 or T2");
+
+  auto page_id = frames_[victim].page_id_;
+  Unlink(victim);
+  frames_[victim] = FrameInfo();
+  curr_size_--;
+  if (page_id != INVALID_PAGE_ID) {
+    AddGhost(page_id, !from_t1);
+  }
+  *frame_id = victim;
+  return true;
+}
+
+auto ARCReplacer::EvictionCandidates(size_t max_frames) -> std::vector<frame_id_t> {
+  std::lock_guard<std::mutex> lock(latch_);
+  std::vector<frame_id_t> frames;
+  // replay the choices of successive Evict calls, only T1 shrinks while doing so
+  auto t1_size = t1_.size();
+  auto it1 = t1_.rbegin();
+  auto it2 = t2_.rbegin();
+  while (frames.size() < max_frames) {
+    while (it1 != t1_.rend() && !frames_[*it1].is_evictable_) {
+      it1++;
+    }
+    while (it2 != t2_.rend() && !frames_[*it2].is_evictable_) {
+      it2++;
+    }
+    bool has_t1 = it1 != t1_.rend();
+    bool has_t2 = it2 != t2_.rend();
+    if (!has_t1 && !has_t2) {
+      break;
+    }
+    bool from_t1 = t1_size > target_;
+    if (from_t1 ? !has_t1 : !has_t2) {
+      from_t1 = !from_t1;
+    }
+    if (from_t1) {
+      frames.push_back(*it1++);
+      t1_size--;
+    } else {
+      frames.push_back(*it2++);
+    }
+  }
+  return frames;
+}
+
+auto ARCReplacer::Size() -> size_t {
+  std::lock_guard<std::mutex> lock(latch_);
+  return curr_size_;
+}
+
+void ARCReplacer::SetNumFrames(size_t num_frames) {
+  std::lock_guard<std::mutex> lock(latch_);
+  capacity_ = num_frames;
+  target_ = std::min(target_, capacity_);
+  while (b1_.size() + b2_.size() > capacity_) {
+    DropGhost(b1_.empty() ? b2_.back() : b1_.back());
+  }
+}
+
+auto ARCReplacer::GetTarget() -> size_t {
+  std::lock_guard<std::mutex> lock(latch_);
+  return target_;
+}
+
+}  // namespace bustub
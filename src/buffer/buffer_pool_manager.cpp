@@ -11,177 +11,1286 @@
 //===----------------------------------------------------------------------===//
 
 #include "buffer/buffer_pool_manager.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <fstream>
+#include <new>
+#include <unordered_set>
+
+#include "buffer/arc_replacer.h"
+#include "buffer/clock_replacer.h"
+#include "buffer/lru_k_replacer.h"
+#include "buffer/lru_replacer.h"
 #include "common/exception.h"
 #include "common/macros.h"
+#include "fmt/format.h"
 #include "include/common/logger.h"
 #include "storage/page/page_guard.h"
 
 namespace bustub {
 
+namespace {
+
+/** @return the nanoseconds passed since start */
+auto NanosSince(std::chrono::steady_clock::time_point start) -> uint64_t {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Header of the warm file, followed by num_pages_ page ids. The next page id is not recorded: the page allocator
+ * derives it from the size of the database file, and StartWarmUp drops the ids it does not consider allocated.
+ */
+struct WarmFileHeader {
+  uint32_t magic_;
+  /** Size of the database file when the file was written, the file is stale if it changed since. */
+  int64_t db_file_size_;
+  uint64_t num_pages_;
+};
+
+constexpr uint32_t WARM_FILE_MAGIC = 0x4d524157;  // "WARM"
+
+}  // namespace
+
+auto BufferPoolStats::TotalHits() const -> size_t {
+  size_t total = 0;
+  for (auto hits : hits_) {
+    total += hits;
+  }
+  return total;
+}
+
+auto BufferPoolStats::TotalMisses() const -> size_t {
+  size_t total = 0;
+  for (auto misses : misses_) {
+    total += misses;
+  }
+  return total;
+}
+
+auto BufferPoolStats::ToString() const -> std::string {
+  static constexpr std::array<const char *, NUM_ACCESS_TYPES> ACCESS_TYPE_NAMES = {"unknown", "get", "scan", "index"};
+  std::string result;
+  for (size_t i = 0; i < NUM_ACCESS_TYPES; i++) {
+    result += fmt::format("hits_{}={}\n", ACCESS_TYPE_NAMES[i], hits_[i]);
+    result += fmt::format("misses_{}={}\n", ACCESS_TYPE_NAMES[i], misses_[i]);
+  }
+  auto fetches = TotalHits() + TotalMisses();
+  result += fmt::format("hit_ratio={:.4f}\n", fetches == 0 ? 0.0 : static_cast<double>(TotalHits()) / fetches);
+  result += fmt::format("evictions={}\n", evictions_);
+  result += fmt::format("foreground_write_backs={}\n", foreground_write_backs_);
+  result += fmt::format("background_write_backs={}\n", background_write_backs_);
+  result += fmt::format("pin_wait_ms={:.3f}\n", pin_wait_ns_ / 1e6);
+  result += fmt::format("latch_wait_ms={:.3f}\n", latch_wait_ns_ / 1e6);
+  result += fmt::format("evict_calls={}\n", evict_calls_);
+  result += fmt::format("evict_scan_length={}\n", evict_scan_length_);
+  result += fmt::format("avg_evict_scan_length={:.2f}\n",
+                        evict_calls_ == 0 ? 0.0 : static_cast<double>(evict_scan_length_) / evict_calls_);
+  result += fmt::format("warm_up_loads={}\n", warm_up_loads_);
+  result += fmt::format("victim_cache_hits={}\n", victim_cache_hits_);
+  result += fmt::format("victim_cache_pages={}\n", victim_cache_pages_);
+  result += fmt::format("victim_cache_bytes={}\n", victim_cache_bytes_);
+  result += fmt::format("checksum_failures={}\n", checksum_failures_);
+  return result;
+}
+
+BufferPoolManager::Shard::Shard(frame_id_t frame_offset, size_t capacity, size_t num_frames, size_t replacer_k,
+                                ReplacerPolicy replacer_policy)
+    : frame_offset_(frame_offset),
+      capacity_(capacity),
+      num_frames_(num_frames),
+      num_constructed_frames_(num_frames),
+      page_table_(2 * capacity) {
+  // at most one mapping per frame, plus one per dirty victim still being written back
+  switch (replacer_policy) {
+    case ReplacerPolicy::LRUK:
+      replacer_ = std::make_unique<LRUKReplacer>(capacity, replacer_k);
+      break;
+    case ReplacerPolicy::LRU:
+      replacer_ = std::make_unique<LRUReplacer>(capacity);
+      break;
+    case ReplacerPolicy::Clock:
+      replacer_ = std::make_unique<ClockReplacer>(capacity);
+      break;
+    case ReplacerPolicy::ARC:
+      replacer_ = std::make_unique<ARCReplacer>(capacity);
+      break;
+  }
+  replacer_->SetNumFrames(num_frames);
+  // Initially, every frame in use is in the free list.
+  for (size_t i = 0; i < num_frames_; ++i) {
+    free_list_.emplace_back(frame_offset_ + static_cast<frame_id_t>(i));
+  }
+}
+
 BufferPoolManager::BufferPoolManager(size_t pool_size, DiskManager *disk_manager, size_t replacer_k,
-                                     LogManager *log_manager)
-    : pool_size_(pool_size), disk_manager_(disk_manager), log_manager_(log_manager) {
-  // TODO(students): remove this line after you have implemented the buffer pool
-  // manager
-  //  throw NotImplementedException(
-  //      "BufferPoolManager is not implemented yet. If you have finished
-  //      implementing BPM, please remove the throw " "exception line in
-  //      `buffer_pool_manager.cpp`.");
+                                     LogManager *log_manager, size_t num_shards, ReplacerPolicy replacer_policy,
+                                     size_t max_pool_size)
+    : pool_size_(pool_size),
+      max_pool_size_(max_pool_size == 0 ? pool_size : max_pool_size),
+      disk_manager_(disk_manager),
+      log_manager_(log_manager) {
+  BUSTUB_ENSURE(num_shards >= 1 && num_shards <= pool_size, "invalid number of buffer pool shards");
+  BUSTUB_ENSURE(pool_size <= max_pool_size_, "the buffer pool cannot start out larger than its maximum size");
+
+  // The frame data is one huge-page-aligned region, the page metadata a separate array of cache-line-padded pages.
+  // Both have room for the maximum size, the pages of frames that are not used yet are constructed by GrowShard.
+  arena_ = std::make_unique<FrameArena>(max_pool_size_);
+  pages_ = static_cast<Page *>(::operator new(max_pool_size_ * sizeof(Page), std::align_val_t{alignof(Page)}));
 
-  // we allocate a consecutive memory space for the buffer pool
-  pages_ = new Page[pool_size_];
-  replacer_ = std::make_unique<LRUKReplacer>(pool_size, replacer_k);
+  // Split the frames as evenly as possible, the first (pool_size % num_shards) shards get one extra frame. Each shard
+  // gets a contiguous slice of the maximum size to grow into.
+  frame_id_t frame_offset = 0;
+  for (size_t i = 0; i < num_shards; ++i) {
+    size_t capacity = max_pool_size_ / num_shards + (i < max_pool_size_ % num_shards ? 1 : 0);
+    size_t num_frames = pool_size / num_shards + (i < pool_size % num_shards ? 1 : 0);
+    for (size_t j = 0; j < num_frames; ++j) {
+      auto frame_id = frame_offset + static_cast<frame_id_t>(j);
+      new (&pages_[frame_id]) Page(arena_->GetFrameData(frame_id));
+      pages_[frame_id].pin_count_ = UNPINNABLE;
+    }
+    shards_.emplace_back(std::make_unique<Shard>(frame_offset, capacity, num_frames, replacer_k, replacer_policy));
+    frame_offset += static_cast<frame_id_t>(capacity);
+  }
 
-  // Initially, every page is in the free list.
-  for (size_t i = 0; i < pool_size_; ++i) {
-    free_list_.emplace_back(static_cast<int>(i));
+  UpdateLimits(pool_size);
+  if (disk_manager_ != nullptr) {
+    disk_scheduler_ = std::make_unique<DiskScheduler>(disk_manager_);
+  }
+  read_ahead_thread_ = new std::thread(&BufferPoolManager::RunReadAhead, this);
+  if (disk_manager_ != nullptr) {
+    warm_file_name_ = disk_manager_->GetWarmFileName();
+    fsm_file_name_ = disk_manager_->GetFreeSpaceMapFileName();
+    snapshot_data_ = disk_manager_->GetMappedData();
+  }
+  if (snapshot_data_ != nullptr) {
+    snapshot_num_pages_ =
+        static_cast<page_id_t>((disk_manager_->GetDbFileSize() + BUSTUB_PAGE_SIZE - 1) / BUSTUB_PAGE_SIZE);
+    snapshot_pages_ = std::make_unique<std::atomic<Page *>[]>(snapshot_num_pages_);
+    for (page_id_t page_id = 0; page_id < snapshot_num_pages_; ++page_id) {
+      snapshot_pages_[page_id] = nullptr;
+    }
+  }
+  if (!fsm_file_name_.empty()) {
+    auto db_file_size = std::max<int64_t>(disk_manager_->GetDbFileSize(), 0);
+    auto num_pages_on_disk = static_cast<page_id_t>((db_file_size + BUSTUB_PAGE_SIZE - 1) / BUSTUB_PAGE_SIZE);
+    page_allocator_.Load(fsm_file_name_, num_pages_on_disk);
   }
+  StartWarmUp();
 }
 
-BufferPoolManager::~BufferPoolManager() { delete[] pages_; }
+BufferPoolManager::~BufferPoolManager() {
+  stop_warm_up_ = true;
+  if (warm_up_thread_ != nullptr) {
+    warm_up_thread_->join();
+    delete warm_up_thread_;
+  }
+  StopPageCleaner();
+  DumpResidentPages();
+  SaveFreeSpaceMap();
+  {
+    std::lock_guard<std::mutex> lock(read_ahead_latch_);
+    stop_read_ahead_ = true;
+  }
+  read_ahead_cv_.notify_all();
+  read_ahead_thread_->join();
+  delete read_ahead_thread_;
+  for (auto &shard : shards_) {
+    for (size_t i = 0; i < shard->num_constructed_frames_; ++i) {
+      pages_[shard->frame_offset_ + static_cast<frame_id_t>(i)].~Page();
+    }
+  }
+  ::operator delete(pages_, std::align_val_t{alignof(Page)});
+  for (page_id_t page_id = 0; page_id < snapshot_num_pages_; ++page_id) {
+    delete snapshot_pages_[page_id].load();
+  }
+}
 
-auto BufferPoolManager::NewPage(page_id_t *page_id) -> Page * {
-  std::lock_guard<std::mutex> lock(latch_);
-  // check if any free frame availiable
-  frame_id_t frame_id;
-  if (!free_list_.empty()) {
-    frame_id = free_list_.front();
-    free_list_.pop_front();
-  } else if (replacer_->Evict(&frame_id)) {
-    // if frame has a dirty page, write it back to disk
-    page_id_t evicted_page_id = pages_[frame_id].GetPageId();
-    if (pages_[frame_id].IsDirty()) {
-      FlushPage(evicted_page_id);
-    }
-    page_table_.erase(evicted_page_id);
-    pages_[frame_id].ResetMemory();
+auto BufferPoolManager::AcquireFrame(Shard *shard, frame_id_t *frame_id, page_id_t *victim_page_id) -> bool {
+  *victim_page_id = INVALID_PAGE_ID;
+  if (!shard->free_list_.empty()) {
+    *frame_id = shard->free_list_.front();
+    shard->free_list_.pop_front();
+    return true;
+  }
+
+  frame_id_t local_frame_id;
+  while (shard->replacer_->Evict(&local_frame_id)) {
+    if (static_cast<size_t>(local_frame_id) >= shard->num_frames_) {
+      // the pool is shrinking, ShrinkShard takes care of this frame
+      continue;
+    }
+    *frame_id = shard->frame_offset_ + local_frame_id;
+    Page *page = &pages_[*frame_id];
+    int pin_count = 0;
+    if (!page->pin_count_.compare_exchange_strong(pin_count, UNPINNABLE)) {
+      // A hit pinned the frame after the replacer last saw it unpinned. Track it again, and don't lose an unpin
+      // that raced with this.
+      shard->replacer_->Restore(local_frame_id, page->page_id_);
+      shard->replacer_->SetEvictable(local_frame_id, false);
+      if (page->pin_count_ == 0) {
+        shard->replacer_->SetEvictable(local_frame_id, true);
+      }
+      continue;
+    }
+    shard->stats_.evictions_.fetch_add(1, std::memory_order_relaxed);
+    page_id_t evicted_page_id = page->page_id_;
+    if (page->is_dirty_ || victim_cache_.IsEnabled()) {
+      // keep the mapping until the page is on disk or in the victim cache, see SaveVictim
+      *victim_page_id = evicted_page_id;
+    } else {
+      shard->page_table_.Erase(evicted_page_id);
+    }
+    return true;
+  }
+  return false;
+}
+
+void BufferPoolManager::InstallFrame(Shard *shard, frame_id_t frame_id, page_id_t page_id, AccessType access_type) {
+  auto local_frame_id = frame_id - shard->frame_offset_;
+  Page *page = &pages_[frame_id];
+  // Publish the new identity before the frame becomes pinnable again, so a latch-free hit on it sees the I/O flag.
+  page->io_in_progress_ = true;
+  page->is_dirty_ = false;
+  page->page_id_ = page_id;
+  page->pin_count_ = 1;
+  shard->page_table_.Insert(page_id, frame_id);
+  shard->replacer_->RecordAccess(local_frame_id, access_type, page_id);
+  shard->replacer_->SetEvictable(local_frame_id, false);
+}
+
+void BufferPoolManager::FinishIo(frame_id_t frame_id) {
+  pages_[frame_id].io_in_progress_ = false;
+  pages_[frame_id].io_cv_.notify_all();
+}
+
+auto BufferPoolManager::LoadFrame(Shard *shard, std::unique_lock<std::mutex> *lock, frame_id_t frame_id,
+                                  page_id_t page_id, page_id_t victim_page_id, AccessType access_type,
+                                  bool is_new_page) -> bool {
+  Page *page = &pages_[frame_id];
+  bool victim_is_dirty = page->is_dirty_;
+  InstallFrame(shard, frame_id, page_id, access_type);
+
+  // Nobody else can touch the frame data now: the old page was unpinned and the new one is marked in progress.
+  lock->unlock();
+  if (victim_page_id != INVALID_PAGE_ID && !SaveVictim(frame_id, victim_page_id, victim_is_dirty)) {
+    lock->lock();
+    KeepVictim(shard, frame_id, page_id, victim_page_id);
+    return false;
+  }
+  page->ResetMemory();
+  bool is_read = is_new_page || ReadPageData(page_id, page->data_);
+  lock->lock();
+
+  if (victim_page_id != INVALID_PAGE_ID) {
+    shard->page_table_.Erase(victim_page_id);
+  }
+  if (!is_read) {
+    AbandonFrame(shard, frame_id, page_id);
+    return false;
+  }
+  FinishIo(frame_id);
+  return true;
+}
+
+auto BufferPoolManager::SaveVictim(frame_id_t frame_id, page_id_t victim_page_id, bool is_dirty) -> bool {
+  if (is_dirty) {
+    if (!disk_scheduler_->ScheduleWrite(victim_page_id, pages_[frame_id].data_).get()) {
+      return false;
+    }
+    num_dirty_frames_--;
+    foreground_write_backs_++;
+  }
+  if (victim_cache_.IsEnabled()) {
+    victim_cache_.Insert(victim_page_id, pages_[frame_id].data_);
+  }
+  return true;
+}
+
+void BufferPoolManager::KeepVictim(Shard *shard, frame_id_t frame_id, page_id_t page_id, page_id_t victim_page_id) {
+  Page *page = &pages_[frame_id];
+  // the victim is still mapped to the frame, and its content was not touched yet
+  shard->page_table_.Erase(page_id);
+  page->page_id_ = victim_page_id;
+  page->is_dirty_ = true;
+  UnpinFrame(shard, frame_id);
+  FinishIo(frame_id);
+}
+
+void BufferPoolManager::AbandonFrame(Shard *shard, frame_id_t frame_id, page_id_t page_id) {
+  Page *page = &pages_[frame_id];
+  shard->page_table_.Erase(page_id);
+  page->page_id_ = INVALID_PAGE_ID;
+  int pin_count = 1;
+  if (page->pin_count_.compare_exchange_strong(pin_count, UNPINNABLE)) {
+    auto local_frame_id = frame_id - shard->frame_offset_;
+    shard->replacer_->SetEvictable(local_frame_id, true);
+    shard->replacer_->Remove(local_frame_id);
+    FreeFrame(shard, frame_id);
   } else {
+    // the waiters see that the frame holds no page and unpin it, then the replacer hands it out again
+    UnpinFrame(shard, frame_id);
+  }
+  FinishIo(frame_id);
+}
+
+void BufferPoolManager::FreeFrame(Shard *shard, frame_id_t frame_id) {
+  if (static_cast<size_t>(frame_id - shard->frame_offset_) < shard->num_frames_) {
+    shard->free_list_.push_back(frame_id);
+  }
+}
+
+void BufferPoolManager::MarkDirty(Page *page) {
+  if (!page->is_dirty_.exchange(true)) {
+    num_dirty_frames_++;
+  }
+}
+
+auto BufferPoolManager::ReadPageData(page_id_t page_id, char *data) -> bool {
+  return ScheduleReadPageData(page_id, data).get();
+}
+
+auto BufferPoolManager::ScheduleReadPageData(page_id_t page_id, char *data) -> std::future<bool> {
+  if (victim_cache_.IsEnabled() && victim_cache_.Take(page_id, data)) {
+    victim_cache_hits_.fetch_add(1, std::memory_order_relaxed);
+    std::promise<bool> done;
+    done.set_value(true);
+    return done.get_future();
+  }
+  return disk_scheduler_->ScheduleRead(page_id, data);
+}
+
+auto BufferPoolManager::FindFrame(Shard *shard, std::unique_lock<std::mutex> *lock, page_id_t page_id) -> frame_id_t {
+  while (true) {
+    frame_id_t frame_id = shard->page_table_.Find(page_id);
+    if (frame_id == -1) {
+      return -1;
+    }
+    if (pages_[frame_id].page_id_ == page_id) {
+      return frame_id;
+    }
+    // The page was evicted and is being saved from this frame, look it up again once that is done.
+    auto start = std::chrono::steady_clock::now();
+    pages_[frame_id].io_cv_.wait(*lock);
+    pin_wait_ns_.fetch_add(NanosSince(start), std::memory_order_relaxed);
+  }
+}
+
+void BufferPoolManager::WaitForIo(std::unique_lock<std::mutex> *lock, frame_id_t frame_id) {
+  if (!pages_[frame_id].io_in_progress_) {
+    return;
+  }
+  auto start = std::chrono::steady_clock::now();
+  pages_[frame_id].io_cv_.wait(*lock, [&] { return !pages_[frame_id].io_in_progress_; });
+  pin_wait_ns_.fetch_add(NanosSince(start), std::memory_order_relaxed);
+}
+
+auto BufferPoolManager::LockShard(Shard *shard) -> std::unique_lock<std::mutex> {
+  std::unique_lock<std::mutex> lock(shard->latch_, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    // only contended acquisitions pay for reading the clock
+    auto start = std::chrono::steady_clock::now();
+    lock.lock();
+    latch_wait_ns_.fetch_add(NanosSince(start), std::memory_order_relaxed);
+  }
+  return lock;
+}
+
+void BufferPoolManager::CountFetch(Shard *shard, AccessType access_type, bool hit) {
+  auto &counters = hit ? shard->stats_.hits_ : shard->stats_.misses_;
+  counters[static_cast<size_t>(access_type)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void BufferPoolManager::PinFrame(Shard *shard, frame_id_t frame_id) {
+  auto pin_count = pages_[frame_id].pin_count_++;
+  BUSTUB_ASSERT(pin_count >= 0, "a buffered page cannot be in the free list or evicted");
+  shard->replacer_->SetEvictable(frame_id - shard->frame_offset_, false);
+}
+
+void BufferPoolManager::UnpinFrame(Shard *shard, frame_id_t frame_id) {
+  if (pages_[frame_id].pin_count_-- == 1) {
+    shard->replacer_->SetEvictable(frame_id - shard->frame_offset_, true);
+  }
+}
+
+auto BufferPoolManager::FetchHit(Shard *shard, page_id_t page_id, AccessType access_type) -> Page * {
+  auto frame_id = shard->page_table_.Find(page_id);
+  if (frame_id == -1) {
+    return nullptr;
+  }
+  Page *page = &pages_[frame_id];
+  auto pin_count = page->pin_count_.load();
+  do {
+    if (pin_count < 0) {
+      return nullptr;
+    }
+  } while (!page->pin_count_.compare_exchange_weak(pin_count, pin_count + 1));
+
+  // The lookup may have been stale: the frame could hold another page by now, or still be reading this one in.
+  if (page->page_id_ != page_id || page->io_in_progress_) {
+    UnpinFrame(shard, frame_id);
+    return nullptr;
+  }
+  auto local_frame_id = frame_id - shard->frame_offset_;
+  shard->replacer_->RecordAccess(local_frame_id, access_type, page_id);
+  shard->replacer_->SetEvictable(local_frame_id, false);
+  return page;
+}
+
+auto BufferPoolManager::NewPage(page_id_t *page_id, AccessType access_type) -> Page * {
+  if (snapshot_data_ != nullptr) {
+    return nullptr;
+  }
+  bool is_recycled;
+  page_id_t new_page_id = AllocatePage(&is_recycled);
+  auto *page = CreatePage(new_page_id, is_recycled, access_type);
+  if (page == nullptr) {
+    page_allocator_.Unallocate(new_page_id, is_recycled);
     return nullptr;  // no new page could be created
   }
+  *page_id = new_page_id;
+  return page;
+}
 
-  *page_id = AllocatePage();
-  pages_[frame_id].page_id_ = *page_id;
-  disk_manager_->ReadPage(*page_id, pages_[frame_id].data_);
-  page_table_[*page_id] = frame_id;
-  replacer_->RecordAccess(frame_id);
-  replacer_->SetEvictable(frame_id, false);
-  pages_[frame_id].pin_count_++;
-  return &pages_[frame_id];
+auto BufferPoolManager::AllocateExtent(page_id_t num_pages) -> page_id_t {
+  return page_allocator_.AllocateExtent(num_pages);
 }
 
-auto BufferPoolManager::FetchPage(page_id_t page_id, AccessType access_type) -> Page * {
-  std::lock_guard<std::mutex> lock(latch_);
-  if (page_table_.count(page_id) > 0) {
-    auto frame_id = page_table_[page_id];
-    replacer_->RecordAccess(frame_id);
-    replacer_->SetEvictable(frame_id, false);
-    pages_[frame_id].pin_count_++;
-    return &pages_[frame_id];
+auto BufferPoolManager::NewPageInExtent(page_id_t page_id, AccessType access_type) -> Page * {
+  // the id was never handed out before, so nothing of an old page can be on disk
+  return CreatePage(page_id, false, access_type);
+}
+
+void BufferPoolManager::ReleaseExtent(page_id_t first_page_id, page_id_t num_pages) {
+  for (page_id_t page_id = first_page_id; page_id < first_page_id + num_pages; ++page_id) {
+    DeallocatePage(page_id);
   }
+}
 
+auto BufferPoolManager::CreatePage(page_id_t page_id, bool is_recycled, AccessType access_type) -> Page * {
+  if (snapshot_data_ != nullptr) {
+    return nullptr;
+  }
+  auto &shard = GetShard(page_id);
+  auto lock = LockShard(&shard);
   frame_id_t frame_id;
-  if (!free_list_.empty()) {
-    frame_id = free_list_.front();
-    free_list_.pop_front();
-  } else if (replacer_->Evict(&frame_id)) {
-    page_id_t evicted_page_id = pages_[frame_id].GetPageId();
-    if (pages_[frame_id].IsDirty()) {
-      FlushPage(evicted_page_id);
-    }
-    page_table_.erase(evicted_page_id);
-    pages_[frame_id].ResetMemory();
-  } else {
+  page_id_t victim_page_id;
+  if (!AcquireFrame(&shard, &frame_id, &victim_page_id)) {
+    return nullptr;
+  }
+  // a new page is all zeros, there is nothing to read
+  if (!LoadFrame(&shard, &lock, frame_id, page_id, victim_page_id, access_type, true)) {
     return nullptr;
   }
+  if (is_recycled) {
+    // the disk still holds the content of the deleted page, the zeroed one has to replace it
+    pages_[frame_id].is_dirty_ = true;
+    num_dirty_frames_++;
+  }
+  return &pages_[frame_id];
+}
+
+auto BufferPoolManager::FetchPage(page_id_t page_id, AccessType access_type) -> Page * {
+  if (snapshot_data_ != nullptr) {
+    return FetchSnapshotPage(page_id);
+  }
+  auto &shard = GetShard(page_id);
+  Page *page = FetchHit(&shard, page_id, access_type);
+  if (page != nullptr) {
+    CountFetch(&shard, access_type, true);
+    return page;
+  }
 
-  pages_[frame_id].page_id_ = page_id;
-  disk_manager_->ReadPage(page_id, pages_[frame_id].data_);
-  page_table_[page_id] = frame_id;
-  replacer_->RecordAccess(frame_id);
-  replacer_->SetEvictable(frame_id, false);
-  pages_[frame_id].pin_count_++;
+  auto lock = LockShard(&shard);
+  auto frame_id = FindFrame(&shard, &lock, page_id);
+  CountFetch(&shard, access_type, frame_id != -1);
+  if (frame_id != -1) {
+    PinFrame(&shard, frame_id);
+    shard.replacer_->RecordAccess(frame_id - shard.frame_offset_, access_type, page_id);
+    // another thread may still be reading the page in
+    WaitForIo(&lock, frame_id);
+    if (pages_[frame_id].page_id_ != page_id) {
+      // and failed to
+      UnpinFrame(&shard, frame_id);
+      return nullptr;
+    }
+    return &pages_[frame_id];
+  }
 
+  page_id_t victim_page_id;
+  if (!AcquireFrame(&shard, &frame_id, &victim_page_id) ||
+      !LoadFrame(&shard, &lock, frame_id, page_id, victim_page_id, access_type, false)) {
+    return nullptr;
+  }
   return &pages_[frame_id];
 }
 
 auto BufferPoolManager::UnpinPage(page_id_t page_id, bool is_dirty, [[maybe_unused]] AccessType access_type) -> bool {
-  std::lock_guard<std::mutex> lock(latch_);
-  if (page_table_.count(page_id) == 0 || pages_[page_table_[page_id]].pin_count_ == 0) {
-    return false;
+  if (snapshot_data_ != nullptr) {
+    // snapshot pages are never pinned, they stay valid as long as the mapping
+    return !is_dirty && page_id >= 0 && page_id < snapshot_num_pages_;
   }
-
-  if (--pages_[page_table_[page_id]].pin_count_ == 0) {
-    replacer_->SetEvictable(page_table_[page_id], true);
+  auto &shard = GetShard(page_id);
+  // The caller's pin keeps the page in its frame, so the latch-free lookup is enough unless it raced with an erase.
+  auto frame_id = shard.page_table_.Find(page_id);
+  if (frame_id == -1 || pages_[frame_id].page_id_ != page_id) {
+    auto lock = LockShard(&shard);
+    frame_id = FindFrame(&shard, &lock, page_id);
+    if (frame_id == -1) {
+      return false;
+    }
   }
 
-  pages_[page_table_[page_id]].is_dirty_ |= is_dirty;
+  Page *page = &pages_[frame_id];
+  if (page->pin_count_ <= 0) {
+    return false;
+  }
+  // mark the page dirty while still holding the pin, so that whoever evicts it sees the flag
+  if (is_dirty && !page->is_dirty_.exchange(true)) {
+    if (++num_dirty_frames_ == cleaner_high_watermark_ && enable_page_cleaner_) {
+      cleaner_cv_.notify_one();
+    }
+  }
+  auto pin_count = page->pin_count_.load();
+  do {
+    if (pin_count <= 0) {
+      return false;
+    }
+  } while (!page->pin_count_.compare_exchange_weak(pin_count, pin_count - 1));
+  if (pin_count == 1) {
+    shard.replacer_->SetEvictable(frame_id - shard.frame_offset_, true);
+  }
   return true;
 }
 
 auto BufferPoolManager::FlushPage(page_id_t page_id) -> bool {
-  if (page_table_.count(page_id) == 0) {
+  auto &shard = GetShard(page_id);
+  auto lock = LockShard(&shard);
+  auto frame_id = FindFrame(&shard, &lock, page_id);
+  if (frame_id == -1) {
     return false;
   }
-  auto frame_id = page_table_[page_id];
-  disk_manager_->WritePage(page_id, pages_[frame_id].data_);
-  pages_[frame_id].is_dirty_ = false;
-  return true;
+  // Pin the frame so it cannot be evicted while the latch is released for the I/O wait and the write. The dirty
+  // flag is cleared before writing, so a modification racing with the write marks the page dirty again.
+  Page *page = &pages_[frame_id];
+  PinFrame(&shard, frame_id);
+  WaitForIo(&lock, frame_id);
+  if (page->page_id_ != page_id) {
+    // the page could not be read in
+    UnpinFrame(&shard, frame_id);
+    return false;
+  }
+  if (page->is_dirty_.exchange(false)) {
+    num_dirty_frames_--;
+  }
+  lock.unlock();
+  bool is_written = disk_scheduler_->ScheduleWrite(page_id, page->data_).get();
+  if (!is_written) {
+    MarkDirty(page);
+  }
+  UnpinFrame(&shard, frame_id);
+  return is_written;
 }
 
 void BufferPoolManager::FlushAllPages() {
-  for (auto [page_id, _] : page_table_) {
-    FlushPage(page_id);
+  // Collect the dirty pages, and the evicted ones that may still be on their way to disk.
+  std::vector<page_id_t> page_ids;
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->latch_);
+    for (auto page_id : shard->page_table_.GetPageIds()) {
+      Page *page = &pages_[shard->page_table_.Find(page_id)];
+      if (page->is_dirty_ || page->page_id_ != page_id) {
+        page_ids.push_back(page_id);
+      }
+    }
+  }
+  // In page id order, neighbours on disk are written back together. A batch pins at most half of the pool.
+  std::sort(page_ids.begin(), page_ids.end());
+  auto batch_size = std::clamp<size_t>(pool_size_ / 2, 1, FLUSH_BATCH_SIZE);
+  for (size_t begin = 0; begin < page_ids.size(); begin += batch_size) {
+    auto end = std::min(page_ids.size(), begin + batch_size);
+    FlushBatch(std::vector<page_id_t>(page_ids.begin() + begin, page_ids.begin() + end));
+  }
+  DumpResidentPages();
+  SaveFreeSpaceMap();
+}
+
+void BufferPoolManager::FlushBatch(const std::vector<page_id_t> &page_ids) {
+  std::vector<page_id_t> dirty_page_ids;
+  std::vector<const char *> dirty_data;
+  std::vector<frame_id_t> frames;
+  for (auto page_id : page_ids) {
+    auto &shard = GetShard(page_id);
+    auto lock = LockShard(&shard);
+    // an evicted page is waited for until it is written back
+    auto frame_id = FindFrame(&shard, &lock, page_id);
+    if (frame_id == -1) {
+      continue;
+    }
+    // Pin the frame like FlushPage does, and clear the dirty flag before the write.
+    Page *page = &pages_[frame_id];
+    PinFrame(&shard, frame_id);
+    WaitForIo(&lock, frame_id);
+    if (page->page_id_ != page_id || !page->is_dirty_.exchange(false)) {
+      UnpinFrame(&shard, frame_id);
+      continue;
+    }
+    num_dirty_frames_--;
+    dirty_page_ids.push_back(page_id);
+    dirty_data.push_back(page->data_);
+    frames.push_back(frame_id);
+  }
+
+  // the batch may have been written in part, keep all of it dirty for the next flush then
+  bool is_written = disk_manager_->WritePages(dirty_page_ids, dirty_data);
+  for (size_t i = 0; i < frames.size(); i++) {
+    if (!is_written) {
+      MarkDirty(&pages_[frames[i]]);
+    }
+    UnpinFrame(&GetShard(dirty_page_ids[i]), frames[i]);
+  }
+}
+
+void BufferPoolManager::DumpResidentPages() {
+  if (warm_file_name_.empty()) {
+    return;
+  }
+  std::vector<std::vector<page_id_t>> shard_page_ids;
+  size_t num_pages = 0;
+  for (auto &shard : shards_) {
+    auto &page_ids = shard_page_ids.emplace_back();
+    std::lock_guard<std::mutex> lock(shard->latch_);
+    auto candidates = shard->replacer_->EvictionCandidates(shard->num_frames_);
+    std::vector<bool> is_candidate(shard->capacity_, false);
+    for (auto local_frame_id : candidates) {
+      is_candidate[local_frame_id] = true;
+    }
+    for (size_t i = 0; i < shard->num_frames_; ++i) {
+      Page *page = &pages_[shard->frame_offset_ + static_cast<frame_id_t>(i)];
+      if (!is_candidate[i] && page->pin_count_ > 0 && page->page_id_ != INVALID_PAGE_ID) {
+        page_ids.push_back(page->page_id_);
+      }
+    }
+    for (auto it = candidates.rbegin(); it != candidates.rend(); ++it) {
+      Page *page = &pages_[shard->frame_offset_ + *it];
+      if (page->pin_count_ >= 0 && page->page_id_ != INVALID_PAGE_ID) {
+        page_ids.push_back(page->page_id_);
+      }
+    }
+    num_pages += page_ids.size();
+  }
+  std::vector<page_id_t> page_ids;
+  page_ids.reserve(num_pages);
+  for (size_t rank = 0; page_ids.size() < num_pages; ++rank) {
+    for (auto &shard_pages : shard_page_ids) {
+      if (rank < shard_pages.size()) {
+        page_ids.push_back(shard_pages[rank]);
+      }
+    }
+  }
+
+  // Write a new file and rename it over the old one, so that a crash never leaves a torn warm file behind.
+  WarmFileHeader header{WARM_FILE_MAGIC, disk_manager_->GetDbFileSize(), page_ids.size()};
+  auto tmp_file_name = warm_file_name_ + ".tmp";
+  std::ofstream out(tmp_file_name, std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char *>(page_ids.data()),
+            static_cast<std::streamsize>(page_ids.size() * sizeof(page_id_t)));
+  out.close();
+  if (out.fail()) {
+    LOG_DEBUG("I/O error while writing the warm file");
+    std::remove(tmp_file_name.c_str());
+    return;
+  }
+  std::rename(tmp_file_name.c_str(), warm_file_name_.c_str());
+}
+
+void BufferPoolManager::SaveFreeSpaceMap() {
+  if (fsm_file_name_.empty()) {
+    return;
+  }
+  page_allocator_.Save(fsm_file_name_);
+}
+
+void BufferPoolManager::StartWarmUp() {
+  if (warm_file_name_.empty()) {
+    return;
+  }
+  std::ifstream in(warm_file_name_, std::ios::binary);
+  WarmFileHeader header;
+  if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)) || header.magic_ != WARM_FILE_MAGIC ||
+      header.db_file_size_ != disk_manager_->GetDbFileSize()) {
+    // no warm file, or one that does not match the database file anymore
+    return;
+  }
+  std::vector<page_id_t> page_ids(std::min<uint64_t>(header.num_pages_, pool_size_));
+  if (!in.read(reinterpret_cast<char *>(page_ids.data()),
+               static_cast<std::streamsize>(page_ids.size() * sizeof(page_id_t)))) {
+    return;
+  }
+  page_ids.erase(std::remove_if(page_ids.begin(), page_ids.end(),
+                                [&](page_id_t page_id) { return !page_allocator_.IsAllocated(page_id); }),
+                 page_ids.end());
+  // the hottest pages are picked, but read in file order
+  std::sort(page_ids.begin(), page_ids.end());
+  warm_up_thread_ = new std::thread(&BufferPoolManager::RunWarmUp, this, std::move(page_ids));
+}
+
+auto BufferPoolManager::FetchSnapshotPage(page_id_t page_id) -> Page * {
+  if (page_id < 0 || page_id >= snapshot_num_pages_) {
+    return nullptr;
+  }
+  auto &slot = snapshot_pages_[page_id];
+  auto *page = slot.load();
+  if (page == nullptr) {
+    // the mapping does not change, a page has to be verified on its first fetch only
+    if (!disk_manager_->VerifyMappedPage(page_id)) {
+      return nullptr;
+    }
+    auto *new_page = new Page(snapshot_data_ + static_cast<size_t>(page_id) * BUSTUB_PAGE_SIZE, page_id);
+    if (slot.compare_exchange_strong(page, new_page)) {
+      page = new_page;
+    } else {
+      // another fetch created the page first, page holds it now
+      delete new_page;
+    }
   }
+  return page;
+}
+
+void BufferPoolManager::RunWarmUp(std::vector<page_id_t> page_ids) {
+  for (auto page_id : page_ids) {
+    if (stop_warm_up_) {
+      return;
+    }
+    WarmPage(page_id);
+  }
+}
+
+void BufferPoolManager::WarmPage(page_id_t page_id) {
+  auto &shard = GetShard(page_id);
+  std::unique_lock<std::mutex> lock(shard.latch_);
+  // never evict anything, the pages the workload asked for in the meantime are worth more
+  if (shard.page_table_.Find(page_id) != -1 || shard.free_list_.empty()) {
+    return;
+  }
+  frame_id_t frame_id;
+  page_id_t victim_page_id;
+  AcquireFrame(&shard, &frame_id, &victim_page_id);
+  if (!LoadFrame(&shard, &lock, frame_id, page_id, victim_page_id, AccessType::Unknown, false)) {
+    return;
+  }
+  lock.unlock();
+  UnpinFrame(&shard, frame_id);
+  warm_up_loads_++;
 }
 
 auto BufferPoolManager::DeletePage(page_id_t page_id) -> bool {
-  std::lock_guard<std::mutex> lock(latch_);
-  if (page_table_.count(page_id) == 0) {
+  if (snapshot_data_ != nullptr) {
+    return false;
+  }
+  auto &shard = GetShard(page_id);
+  auto lock = LockShard(&shard);
+  auto frame_id = FindFrame(&shard, &lock, page_id);
+  if (frame_id == -1) {
+    // an evicted page may still have a copy in the victim cache
+    victim_cache_.Erase(page_id);
+    DeallocatePage(page_id);
+    return true;
+  }
+  Page *page = &pages_[frame_id];
+  int pin_count = 0;
+  if (!page->pin_count_.compare_exchange_strong(pin_count, UNPINNABLE)) {
+    return false;
+  }
+
+  // The page is gone for good, so there is no point in writing back its dirty content.
+  if (page->is_dirty_.exchange(false)) {
+    num_dirty_frames_--;
+  }
+  // the replacer may not have seen the last unpin yet
+  auto local_frame_id = frame_id - shard.frame_offset_;
+  shard.replacer_->SetEvictable(local_frame_id, true);
+  shard.replacer_->Remove(local_frame_id);
+  shard.page_table_.Erase(page_id);
+  page->ResetMemory();
+  page->page_id_ = INVALID_PAGE_ID;
+  FreeFrame(&shard, frame_id);
+  DeallocatePage(page_id);
+  return true;
+}
+
+void BufferPoolManager::PrefetchPage(page_id_t page_id) { ReadAhead(page_id, 1, nullptr); }
+
+void BufferPoolManager::ReadAhead(page_id_t page_id, size_t window,
+                                  std::function<page_id_t(const char *)> next_page_id) {
+  window = std::min<size_t>(window, max_read_ahead_window_);
+  // the kernel reads ahead in the mapping of a snapshot by itself
+  if (page_id == INVALID_PAGE_ID || window == 0 || snapshot_data_ != nullptr) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(read_ahead_latch_);
+    if (read_ahead_queue_.size() >= static_cast<size_t>(READ_AHEAD_QUEUE_SIZE)) {
+      return;
+    }
+    read_ahead_queue_.push_back({page_id, window, std::move(next_page_id)});
+  }
+  read_ahead_cv_.notify_one();
+}
+
+void BufferPoolManager::RunReadAhead() {
+  while (true) {
+    ReadAheadRequest request;
+    {
+      std::unique_lock<std::mutex> lock(read_ahead_latch_);
+      read_ahead_cv_.wait(lock, [&] { return stop_read_ahead_ || !read_ahead_queue_.empty(); });
+      if (stop_read_ahead_) {
+        return;
+      }
+      request = std::move(read_ahead_queue_.front());
+      read_ahead_queue_.pop_front();
+    }
+
+    // Each next page id comes out of the previous page, so the window is read one page after the other.
+    auto page_id = request.page_id_;
+    for (size_t i = 0; i < request.window_ && page_id != INVALID_PAGE_ID; i++) {
+      {
+        auto &shard = GetShard(page_id);
+        std::lock_guard<std::mutex> lock(shard.latch_);
+        if (shard.page_table_.Find(page_id) == -1 && !HasCleanFrame(&shard)) {
+          // a speculative read is not worth writing a dirty page back for, leave that to the foreground
+          break;
+        }
+      }
+      Page *page = FetchPage(page_id, AccessType::Scan);
+      if (page == nullptr) {
+        // every frame is pinned, reading further ahead would not stick anyway
+        break;
+      }
+      auto next_page_id = INVALID_PAGE_ID;
+      if (request.next_page_id_ != nullptr) {
+        page->RLatch();
+        next_page_id = request.next_page_id_(page->GetData());
+        page->RUnlatch();
+      }
+      UnpinPage(page_id, false, AccessType::Scan);
+      page_id = next_page_id;
+    }
+  }
+}
+
+auto BufferPoolManager::HasCleanFrame(Shard *shard) -> bool {
+  if (!shard->free_list_.empty()) {
+    return true;
+  }
+  for (auto local_frame_id : shard->replacer_->EvictionCandidates(1)) {
+    if (static_cast<size_t>(local_frame_id) < shard->num_frames_) {
+      return !pages_[shard->frame_offset_ + local_frame_id].is_dirty_;
+    }
+  }
+  return false;
+}
+
+void BufferPoolManager::StartPageCleaner(double high_watermark, double low_watermark) {
+  BUSTUB_ENSURE(page_cleaner_thread_ == nullptr, "page cleaner is already running");
+  BUSTUB_ENSURE(0 <= low_watermark && low_watermark <= high_watermark && high_watermark <= 1,
+                "invalid page cleaner watermarks");
+  cleaner_high_share_ = high_watermark;
+  cleaner_low_share_ = low_watermark;
+  UpdateLimits(pool_size_);
+  enable_page_cleaner_ = true;
+  page_cleaner_thread_ = new std::thread(&BufferPoolManager::RunPageCleaner, this);
+}
+
+void BufferPoolManager::UpdateLimits(size_t pool_size) {
+  cleaner_high_watermark_ = std::max<size_t>(1, cleaner_high_share_ * pool_size);
+  cleaner_low_watermark_ = std::min<size_t>(cleaner_high_watermark_ - 1, cleaner_low_share_ * pool_size);
+  // Never let read-ahead claim more than an eighth of the pool, it would evict the pages the reader still needs.
+  max_read_ahead_window_ = pool_size / 8;
+}
+
+void BufferPoolManager::StopPageCleaner() {
+  enable_page_cleaner_ = false;
+  cleaner_cv_.notify_all();
+  if (page_cleaner_thread_ != nullptr) {
+    page_cleaner_thread_->join();
+    delete page_cleaner_thread_;
+    page_cleaner_thread_ = nullptr;
+  }
+}
+
+void BufferPoolManager::RunPageCleaner() {
+  while (enable_page_cleaner_) {
+    {
+      std::unique_lock<std::mutex> lock(cleaner_latch_);
+      cleaner_cv_.wait_for(lock, page_cleaner_interval,
+                           [&] { return !enable_page_cleaner_ || num_dirty_frames_ >= cleaner_high_watermark_; });
+    }
+    if (num_dirty_frames_ < cleaner_high_watermark_) {
+      continue;
+    }
+    while (enable_page_cleaner_ && num_dirty_frames_ > cleaner_low_watermark_) {
+      size_t cleaned = 0;
+      for (auto &shard : shards_) {
+        cleaned += CleanShard(shard.get());
+      }
+      if (cleaned == 0) {
+        // every dirty frame is pinned, nothing to do until they get unpinned
+        break;
+      }
+    }
+  }
+}
+
+auto BufferPoolManager::CleanShard(Shard *shard) -> size_t {
+  std::vector<frame_id_t> frames;
+  {
+    std::lock_guard<std::mutex> lock(shard->latch_);
+    for (auto local_frame_id : shard->replacer_->EvictionCandidates(shard->num_frames_)) {
+      auto frame_id = shard->frame_offset_ + local_frame_id;
+      Page *page = &pages_[frame_id];
+      if (!page->is_dirty_) {
+        continue;
+      }
+      // Pin the frame so it cannot be evicted during the write, and clear the dirty flag up front like FlushPage.
+      PinFrame(shard, frame_id);
+      if (page->is_dirty_.exchange(false)) {
+        num_dirty_frames_--;
+      }
+      frames.push_back(frame_id);
+      if (frames.size() == static_cast<size_t>(PAGE_CLEANER_BATCH_SIZE)) {
+        break;
+      }
+    }
+  }
+
+  // the whole batch is in flight at once
+  std::vector<std::future<bool>> writes;
+  writes.reserve(frames.size());
+  for (auto frame_id : frames) {
+    writes.push_back(disk_scheduler_->ScheduleWrite(pages_[frame_id].page_id_, pages_[frame_id].data_));
+  }
+  size_t num_written = 0;
+  for (size_t i = 0; i < frames.size(); ++i) {
+    if (writes[i].get()) {
+      num_written++;
+    } else {
+      MarkDirty(&pages_[frames[i]]);
+    }
+    UnpinFrame(shard, frames[i]);
+  }
+  background_write_backs_ += num_written;
+  return num_written;
+}
+
+auto BufferPoolManager::Resize(size_t pool_size) -> bool {
+  if (pool_size < shards_.size() || pool_size > max_pool_size_) {
+    return false;
+  }
+  std::lock_guard<std::mutex> resize_lock(resize_latch_);
+  auto num_shards = shards_.size();
+  auto deadline = std::chrono::steady_clock::now() + resize_timeout;
+  std::vector<size_t> old_num_frames;
+  for (size_t i = 0; i < num_shards; ++i) {
+    old_num_frames.push_back(shards_[i]->num_frames_);
+    size_t num_frames = pool_size / num_shards + (i < pool_size % num_shards ? 1 : 0);
+    GrowShard(shards_[i].get(), num_frames);
+    if (!ShrinkShard(shards_[i].get(), num_frames, deadline)) {
+      LOG_WARN("buffer pool resize to %zu frames timed out waiting for pinned pages", pool_size);
+      // the shards before this one all shrunk, since their sizes move together, so growing them undoes the resize
+      for (size_t j = 0; j < i; ++j) {
+        GrowShard(shards_[j].get(), old_num_frames[j]);
+      }
+      return false;
+    }
+  }
+  pool_size_ = pool_size;
+  UpdateLimits(pool_size);
+  return true;
+}
+
+void BufferPoolManager::GrowShard(Shard *shard, size_t num_frames) {
+  std::lock_guard<std::mutex> lock(shard->latch_);
+  for (size_t i = shard->num_frames_; i < num_frames; ++i) {
+    auto frame_id = shard->frame_offset_ + static_cast<frame_id_t>(i);
+    if (i == shard->num_constructed_frames_) {
+      new (&pages_[frame_id]) Page(arena_->GetFrameData(frame_id));
+      pages_[frame_id].pin_count_ = UNPINNABLE;
+      shard->num_constructed_frames_++;
+    }
+    shard->free_list_.push_back(frame_id);
+  }
+  if (num_frames > shard->num_frames_) {
+    shard->num_frames_ = num_frames;
+    shard->replacer_->SetNumFrames(num_frames);
+  }
+}
+
+auto BufferPoolManager::ShrinkShard(Shard *shard, size_t num_frames, std::chrono::steady_clock::time_point deadline)
+    -> bool {
+  std::unique_lock<std::mutex> lock(shard->latch_);
+  auto old_num_frames = shard->num_frames_;
+  if (num_frames >= old_num_frames) {
     return true;
   }
-  frame_id_t frame_id = page_table_[page_id];
-  if (pages_[frame_id].GetPinCount() > 0) {
+  // From here on AcquireFrame skips the retired frames, so they only ever get emptier.
+  shard->num_frames_ = num_frames;
+  auto first_retired = shard->frame_offset_ + static_cast<frame_id_t>(num_frames);
+  auto end_retired = shard->frame_offset_ + static_cast<frame_id_t>(old_num_frames);
+  shard->free_list_.remove_if([&](frame_id_t frame_id) { return frame_id >= first_retired; });
+
+  while (true) {
+    bool all_retired = true;
+    for (auto frame_id = first_retired; frame_id < end_retired; ++frame_id) {
+      all_retired = RetireFrame(shard, &lock, frame_id) && all_retired;
+    }
+    if (all_retired) {
+      break;
+    }
+    if (std::chrono::steady_clock::now() >= deadline) {
+      // Give the frames back. Those that still hold a page may have been dropped by the replacer's Evict in the
+      // meantime, so make it forget all of them and track them again like AcquireFrame does.
+      shard->num_frames_ = old_num_frames;
+      for (auto frame_id = first_retired; frame_id < end_retired; ++frame_id) {
+        if (pages_[frame_id].pin_count_ == UNPINNABLE) {
+          shard->free_list_.push_back(frame_id);
+          continue;
+        }
+        auto local_frame_id = frame_id - shard->frame_offset_;
+        shard->replacer_->SetEvictable(local_frame_id, true);
+        shard->replacer_->Remove(local_frame_id);
+        shard->replacer_->Restore(local_frame_id, pages_[frame_id].page_id_);
+        shard->replacer_->SetEvictable(local_frame_id, false);
+        if (pages_[frame_id].pin_count_ == 0) {
+          shard->replacer_->SetEvictable(local_frame_id, true);
+        }
+      }
+      return false;
+    }
+    // some pages are still pinned, give their users a moment
+    lock.unlock();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    lock.lock();
+  }
+  // the retired frames are gone from the replacer, it may size its policies for the remaining ones now
+  shard->replacer_->SetNumFrames(num_frames);
+  arena_->Discard(first_retired, old_num_frames - num_frames);
+  return true;
+}
+
+auto BufferPoolManager::RetireFrame(Shard *shard, std::unique_lock<std::mutex> *lock, frame_id_t frame_id) -> bool {
+  Page *page = &pages_[frame_id];
+  if (page->pin_count_ == UNPINNABLE) {
+    // was in the free list, or retired in an earlier round
+    return true;
+  }
+  int pin_count = 0;
+  if (!page->pin_count_.compare_exchange_strong(pin_count, UNPINNABLE)) {
     return false;
   }
+  // the replacer may not have seen the last unpin yet
+  auto local_frame_id = frame_id - shard->frame_offset_;
+  shard->replacer_->SetEvictable(local_frame_id, true);
+  shard->replacer_->Remove(local_frame_id);
 
-  if (pages_[frame_id].IsDirty()) {
-    FlushPage(page_id);
+  page_id_t page_id = page->page_id_;
+  if (page->is_dirty_.exchange(false)) {
+    // Keep the mapping while writing back, FindFrame waits for the frame like for an evicted dirty victim.
+    num_dirty_frames_--;
+    page->io_in_progress_ = true;
+    page->page_id_ = INVALID_PAGE_ID;
+    lock->unlock();
+    bool is_written = disk_scheduler_->ScheduleWrite(page_id, page->data_).get();
+    lock->lock();
+    if (!is_written) {
+      // keep the page in the frame, the shrink tries again later
+      page->page_id_ = page_id;
+      MarkDirty(page);
+      page->pin_count_ = 0;
+      shard->replacer_->Restore(local_frame_id, page_id);
+      page->io_in_progress_ = false;
+      page->io_cv_.notify_all();
+      return false;
+    }
   }
-  page_table_.erase(page_id);
-  pages_[frame_id].ResetMemory();
-  free_list_.push_back(frame_id);
-  // DeallocatePage(page_id);
+  shard->page_table_.Erase(page_id);
+  page->page_id_ = INVALID_PAGE_ID;
+  page->io_in_progress_ = false;
+  page->io_cv_.notify_all();
   return true;
 }
 
-auto BufferPoolManager::AllocatePage() -> page_id_t { return next_page_id_++; }
+auto BufferPoolManager::GetStats() -> BufferPoolStats {
+  BufferPoolStats stats;
+  for (auto &shard : shards_) {
+    for (size_t i = 0; i < NUM_ACCESS_TYPES; i++) {
+      stats.hits_[i] += shard->stats_.hits_[i].load(std::memory_order_relaxed);
+      stats.misses_[i] += shard->stats_.misses_[i].load(std::memory_order_relaxed);
+    }
+    stats.evictions_ += shard->stats_.evictions_.load(std::memory_order_relaxed);
+    stats.evict_calls_ += shard->replacer_->GetEvictCalls();
+    stats.evict_scan_length_ += shard->replacer_->GetEvictScanLength();
+  }
+  stats.foreground_write_backs_ = foreground_write_backs_;
+  stats.background_write_backs_ = background_write_backs_;
+  stats.pin_wait_ns_ = pin_wait_ns_.load(std::memory_order_relaxed);
+  stats.latch_wait_ns_ = latch_wait_ns_.load(std::memory_order_relaxed);
+  stats.warm_up_loads_ = warm_up_loads_;
+  stats.victim_cache_hits_ = victim_cache_hits_.load(std::memory_order_relaxed);
+  stats.victim_cache_pages_ = victim_cache_.GetNumPages();
+  stats.victim_cache_bytes_ = victim_cache_.GetSize();
+  stats.checksum_failures_ = disk_manager_ == nullptr ? 0 : disk_manager_->GetNumChecksumFailures();
+  return stats;
+}
+
+auto BufferPoolManager::AllocatePage(bool *is_recycled) -> page_id_t {
+  return page_allocator_.Allocate(is_recycled);
+}
 
-auto BufferPoolManager::FetchPageBasic(page_id_t page_id) -> BasicPageGuard {
+auto BufferPoolManager::FetchPageBasic(page_id_t page_id, AccessType access_type) -> BasicPageGuard {
   //  std::scoped_lock<std::mutex> lock(latch_);
-  return {this, FetchPage(page_id)};
+  return {this, FetchPage(page_id, access_type)};
 }
 
-auto BufferPoolManager::FetchPageRead(page_id_t page_id) -> ReadPageGuard {
+auto BufferPoolManager::FetchPageRead(page_id_t page_id, AccessType access_type) -> ReadPageGuard {
   //  std::scoped_lock<std::mutex> lock(latch_);
-  Page *page = FetchPage(page_id);
+  Page *page = FetchPage(page_id, access_type);
   if (page != nullptr) {
     page->RLatch();
   }
   return {this, page};
 }
 
-auto BufferPoolManager::FetchPageWrite(page_id_t page_id) -> WritePageGuard {
+auto BufferPoolManager::FetchPageWrite(page_id_t page_id, AccessType access_type) -> WritePageGuard {
   //  std::scoped_lock<std::mutex> lock(latch_);
-  Page *page = FetchPage(page_id);
+  if (snapshot_data_ != nullptr) {
+    return {this, nullptr};
+  }
+  Page *page = FetchPage(page_id, access_type);
   if (page != nullptr) {
     page->WLatch();
   }
   return {this, page};
 }
 
-auto BufferPoolManager::NewPageGuarded(page_id_t *page_id) -> BasicPageGuard {
+auto BufferPoolManager::FetchPagesRead(const std::vector<page_id_t> &page_ids, AccessType access_type)
+    -> std::vector<ReadPageGuard> {
+  // Every page is fetched and latched once: taking a second read latch on the same page is undefined, and it
+  // deadlocks as soon as a writer queues up between the two.
+  std::vector<bool> is_repeated(page_ids.size());
+  std::unordered_set<page_id_t> seen;
+  for (size_t i = 0; i < page_ids.size(); ++i) {
+    is_repeated[i] = !seen.insert(page_ids[i]).second;
+  }
+  if (snapshot_data_ != nullptr) {
+    // there is nothing to read in, every page is in the mapping already
+    std::vector<ReadPageGuard> guards;
+    guards.reserve(page_ids.size());
+    for (size_t i = 0; i < page_ids.size(); ++i) {
+      guards.push_back(is_repeated[i] ? ReadPageGuard(this, nullptr) : FetchPageRead(page_ids[i], access_type));
+    }
+    return guards;
+  }
+  std::vector<Page *> pages(page_ids.size(), nullptr);
+  // pages found through the page table that may still be in I/O, and pages this call reads in
+  std::vector<size_t> found;
+  std::vector<size_t> loads;
+
+  // Pin the hits and claim frames for the misses, without reading anything yet. A page found here may still be read
+  // in by another thread, only wait for it once our own reads are in flight.
+  for (size_t i = 0; i < page_ids.size(); ++i) {
+    if (is_repeated[i]) {
+      continue;
+    }
+    auto page_id = page_ids[i];
+    auto &shard = GetShard(page_id);
+    pages[i] = FetchHit(&shard, page_id, access_type);
+    if (pages[i] != nullptr) {
+      CountFetch(&shard, access_type, true);
+      continue;
+    }
+    auto lock = LockShard(&shard);
+    auto frame_id = FindFrame(&shard, &lock, page_id);
+    CountFetch(&shard, access_type, frame_id != -1);
+    if (frame_id != -1) {
+      PinFrame(&shard, frame_id);
+      shard.replacer_->RecordAccess(frame_id - shard.frame_offset_, access_type, page_id);
+      found.push_back(i);
+    } else {
+      page_id_t victim_page_id;
+      if (!AcquireFrame(&shard, &frame_id, &victim_page_id)) {
+        continue;
+      }
+      bool victim_is_dirty = pages_[frame_id].is_dirty_;
+      InstallFrame(&shard, frame_id, page_id, access_type);
+      if (victim_page_id != INVALID_PAGE_ID) {
+        // Save the victim right away, a later page of the batch may be the victim and wait for it.
+        lock.unlock();
+        bool is_saved = SaveVictim(frame_id, victim_page_id, victim_is_dirty);
+        lock.lock();
+        if (!is_saved) {
+          KeepVictim(&shard, frame_id, page_id, victim_page_id);
+          continue;
+        }
+        shard.page_table_.Erase(victim_page_id);
+        pages_[frame_id].io_cv_.notify_all();
+      }
+      loads.push_back(i);
+    }
+    pages[i] = &pages_[frame_id];
+  }
+
+  // Start all reads of the misses before waiting for any of them, the disk scheduler keeps them in flight together.
+  std::vector<std::future<bool>> reads;
+  reads.reserve(loads.size());
+  for (auto i : loads) {
+    pages[i]->ResetMemory();
+    reads.push_back(ScheduleReadPageData(page_ids[i], pages[i]->data_));
+  }
+  for (size_t j = 0; j < loads.size(); ++j) {
+    auto i = loads[j];
+    bool is_read = reads[j].get();
+    auto &shard = GetShard(page_ids[i]);
+    std::lock_guard<std::mutex> lock(shard.latch_);
+    auto frame_id = static_cast<frame_id_t>(pages[i] - pages_);
+    if (!is_read) {
+      AbandonFrame(&shard, frame_id, page_ids[i]);
+      pages[i] = nullptr;
+      continue;
+    }
+    FinishIo(frame_id);
+  }
+  for (auto i : found) {
+    auto &shard = GetShard(page_ids[i]);
+    std::unique_lock<std::mutex> lock(shard.latch_);
+    auto frame_id = static_cast<frame_id_t>(pages[i] - pages_);
+    WaitForIo(&lock, frame_id);
+    if (pages_[frame_id].page_id_ != page_ids[i]) {
+      UnpinFrame(&shard, frame_id);
+      pages[i] = nullptr;
+    }
+  }
+
+  std::vector<ReadPageGuard> guards;
+  guards.reserve(page_ids.size());
+  for (auto *page : pages) {
+    if (page != nullptr) {
+      page->RLatch();
+    }
+    guards.emplace_back(this, page);
+  }
+  return guards;
+}
+
+auto BufferPoolManager::FetchPageOptimistic(page_id_t page_id, AccessType access_type) -> OptimisticReadPageGuard {
+  return {this, FetchPage(page_id, access_type)};
+}
+
+auto BufferPoolManager::NewPageGuarded(page_id_t *page_id, AccessType access_type) -> BasicPageGuard {
   //  std::scoped_lock<std::mutex> lock(latch_);
-  return {this, NewPage(page_id)};
+  return {this, NewPage(page_id, access_type)};
 }
 
 }  // namespace bustub
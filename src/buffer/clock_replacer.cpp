@@ -12,18 +12,128 @@
 
 #include "buffer/clock_replacer.h"
 
+#include <exception>
+
 namespace bustub {
 
-ClockReplacer::ClockReplacer(size_t num_pages) {}
+ClockReplacer::ClockReplacer(size_t num_pages) : num_frames_(num_pages), state_(num_pages) {}
 
 ClockReplacer::~ClockReplacer() = default;
 
-auto ClockReplacer::Victim(frame_id_t *frame_id) -> bool { return false; }
+void ClockReplacer::RecordFrameAccess(frame_id_t frame_id, AccessType access_type, page_id_t /* page_id */) {
+  BUSTUB_ASSERT(frame_id >= 0 && static_cast<size_t>(frame_id) < num_frames_, "invalid frame id");
+  auto &state = state_[frame_id];
+  auto old_state = state.load(std::memory_order_relaxed);
+  while (true) {
+    uint8_t new_state = old_state | TRACKED;
+    if ((old_state & TRACKED) == 0) {
+      new_state |= EVICTABLE;
+    }
+    if (access_type != AccessType::Scan) {
+      new_state |= REFERENCED;
+    }
+    if (new_state == old_state) {
+      return;
+    }
+    if (state.compare_exchange_weak(old_state, new_state, std::memory_order_relaxed)) {
+      break;
+    }
+  }
+  if ((old_state & TRACKED) == 0) {
+    curr_size_++;
+  }
+}
+
+void ClockReplacer::SetEvictable(frame_id_t frame_id, bool set_evictable) {
+  BUSTUB_ASSERT(frame_id >= 0 && static_cast<size_t>(frame_id) < num_frames_, "invalid frame id");
+  auto &state = state_[frame_id];
+  auto old_state = state.load(std::memory_order_relaxed);
+  while (true) {
+    if ((old_state & TRACKED) == 0 || ((old_state & EVICTABLE) != 0) == set_evictable) {
+      return;
+    }
+    uint8_t new_state = set_evictable ? (old_state | EVICTABLE) : (old_state & ~EVICTABLE);
+    if (state.compare_exchange_weak(old_state, new_state, std::memory_order_relaxed)) {
+      break;
+    }
+  }
+  if (set_evictable) {
+    curr_size_++;
+  } else {
+    curr_size_--;
+  }
+}
+
+void ClockReplacer::Remove(frame_id_t frame_id) {
+  BUSTUB_ASSERT(frame_id >= 0 && static_cast<size_t>(frame_id) < num_frames_, "invalid frame id");
+  auto &state = state_[frame_id];
+  auto old_state = state.load(std::memory_order_relaxed);
+  while (true) {
+    if ((old_state & TRACKED) == 0) {
+      return;
+    }
+    if ((old_state & EVICTABLE) == 0) {
+      throw std::exception();
+    }
+    if (state.compare_exchange_weak(old_state, 0, std::memory_order_relaxed)) {
+      break;
+    }
+  }
+  curr_size_--;
+}
+
+auto ClockReplacer::TryEvict(frame_id_t frame_id, bool honor_reference) -> bool {
+  auto &state = state_[frame_id];
+  auto old_state = state.load(std::memory_order_relaxed);
+  while ((old_state & (TRACKED | EVICTABLE)) == (TRACKED | EVICTABLE)) {
+    if (honor_reference && (old_state & REFERENCED) != 0) {
+      // second chance
+      state.fetch_and(~REFERENCED, std::memory_order_relaxed);
+      return false;
+    }
+    if (state.compare_exchange_weak(old_state, 0, std::memory_order_relaxed)) {
+      curr_size_--;
+      return true;
+    }
+  }
+  return false;
+}
 
-void ClockReplacer::Pin(frame_id_t frame_id) {}
+auto ClockReplacer::Evict(frame_id_t *frame_id) -> bool {
+  std::lock_guard<std::mutex> lock(latch_);
+  // Two rounds clear every reference bit. Accesses racing with the sweep may set them again, so the third round
+  // takes any evictable frame.
+  evict_calls_.fetch_add(1, std::memory_order_relaxed);
+  size_t step = 0;
+  for (; step < 3 * num_frames_ && curr_size_ > 0; step++) {
+    auto frame = static_cast<frame_id_t>(hand_);
+    hand_ = (hand_ + 1) % num_frames_;
+    if (TryEvict(frame, step < 2 * num_frames_)) {
+      evict_scan_length_.fetch_add(step + 1, std::memory_order_relaxed);
+      *frame_id = frame;
+      return true;
+    }
+  }
+  evict_scan_length_.fetch_add(step, std::memory_order_relaxed);
+  return false;
+}
 
-void ClockReplacer::Unpin(frame_id_t frame_id) {}
+auto ClockReplacer::EvictionCandidates(size_t max_frames) -> std::vector<frame_id_t> {
+  std::lock_guard<std::mutex> lock(latch_);
+  std::vector<frame_id_t> frames;
+  // the hand takes unreferenced frames in its first round, and the rest in its second
+  for (auto referenced : {false, true}) {
+    for (size_t i = 0; i < num_frames_ && frames.size() < max_frames; i++) {
+      auto frame = static_cast<frame_id_t>((hand_ + i) % num_frames_);
+      auto state = state_[frame].load(std::memory_order_relaxed);
+      if ((state & (TRACKED | EVICTABLE)) == (TRACKED | EVICTABLE) && ((state & REFERENCED) != 0) == referenced) {
+        frames.push_back(frame);
+      }
+    }
+  }
+  return frames;
+}
 
-auto ClockReplacer::Size() -> size_t { return 0; }
+auto ClockReplacer::Size() -> size_t { return curr_size_; }
 
 }  // namespace bustub
@@ -0,0 +1,98 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// frame_arena.cpp
+//
+// Identification: src/buffer/frame_arena.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/frame_arena.h"
+
+#include <sys/mman.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "common/exception.h"
+
+#if defined(__SANITIZE_ADDRESS__)
+#define BUSTUB_FRAME_ARENA_ASAN 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define BUSTUB_FRAME_ARENA_ASAN 1
+#endif
+#endif
+
+namespace bustub {
+
+FrameArena::FrameArena(size_t num_frames) {
+#ifdef BUSTUB_FRAME_ARENA_ASAN
+  frames_.resize(num_frames, nullptr);
+#else
+  auto data_size = num_frames * BUSTUB_PAGE_SIZE;
+  size_ = (data_size + FRAME_ARENA_ALIGNMENT - 1) / FRAME_ARENA_ALIGNMENT * FRAME_ARENA_ALIGNMENT;
+  // mmap only guarantees OS page alignment, so map an extra alignment unit and cut off what is not needed
+  auto mapped_size = size_ + FRAME_ARENA_ALIGNMENT;
+  void *mapped = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (mapped == MAP_FAILED) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot map buffer pool frames");
+  }
+  auto begin = reinterpret_cast<uintptr_t>(mapped);
+  auto aligned = (begin + FRAME_ARENA_ALIGNMENT - 1) / FRAME_ARENA_ALIGNMENT * FRAME_ARENA_ALIGNMENT;
+  if (aligned > begin) {
+    munmap(mapped, aligned - begin);
+  }
+  if (begin + mapped_size > aligned + size_) {
+    munmap(reinterpret_cast<void *>(aligned + size_), begin + mapped_size - aligned - size_);
+  }
+  data_ = reinterpret_cast<char *>(aligned);
+#ifdef MADV_HUGEPAGE
+  // best effort, the pool works the same with regular pages
+  madvise(data_, size_, MADV_HUGEPAGE);
+#endif
+#endif
+}
+
+auto FrameArena::GetFrameData(frame_id_t frame_id) -> char * {
+  if (frames_.empty()) {
+    return data_ + static_cast<size_t>(frame_id) * BUSTUB_PAGE_SIZE;
+  }
+  auto &frame = frames_[frame_id];
+  if (frame == nullptr) {
+    frame = static_cast<char *>(std::aligned_alloc(BUSTUB_PAGE_SIZE, BUSTUB_PAGE_SIZE));
+    if (frame == nullptr) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot allocate buffer pool frames");
+    }
+    memset(frame, 0, BUSTUB_PAGE_SIZE);
+  }
+  return frame;
+}
+
+void FrameArena::Discard(frame_id_t frame_id, size_t num_frames) {
+  if (frames_.empty()) {
+    // frames are OS pages, MADV_DONTNEED drops them and maps zero pages on the next access
+    madvise(data_ + static_cast<size_t>(frame_id) * BUSTUB_PAGE_SIZE, num_frames * BUSTUB_PAGE_SIZE, MADV_DONTNEED);
+    return;
+  }
+  // keep the allocations, pages still point at them
+  for (size_t i = 0; i < num_frames; i++) {
+    if (frames_[frame_id + i] != nullptr) {
+      memset(frames_[frame_id + i], 0, BUSTUB_PAGE_SIZE);
+    }
+  }
+}
+
+FrameArena::~FrameArena() {
+  for (auto *frame : frames_) {
+    std::free(frame);  // NOLINT
+  }
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+  }
+}
+
+}  // namespace bustub
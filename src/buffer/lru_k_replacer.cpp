@@ -11,131 +11,253 @@
 //===----------------------------------------------------------------------===//
 
 #include "buffer/lru_k_replacer.h"
+
+#include <algorithm>
+
 #include "common/exception.h"
 
 namespace bustub {
 
-LRUKReplacer::LRUKReplacer(size_t num_frames, size_t k) : replacer_size_(num_frames), k_(k) { max_size_ = num_frames; }
+LRUKReplacer::FrameHeap::FrameHeap(size_t num_frames) : pos_(num_frames, NOT_IN_HEAP) { heap_.reserve(num_frames); }
+
+void LRUKReplacer::FrameHeap::Push(frame_id_t frame_id, size_t key) {
+  heap_.emplace_back(key, frame_id);
+  pos_[frame_id] = heap_.size() - 1;
+  SiftUp(heap_.size() - 1);
+}
+
+void LRUKReplacer::FrameHeap::Erase(frame_id_t frame_id) {
+  auto pos = pos_[frame_id];
+  pos_[frame_id] = NOT_IN_HEAP;
+  auto last = heap_.back();
+  heap_.pop_back();
+  if (pos == heap_.size()) {
+    return;
+  }
+  Place(pos, last);
+  SiftUp(pos);
+  SiftDown(pos_[last.second]);
+}
+
+void LRUKReplacer::FrameHeap::Place(size_t pos, std::pair<size_t, frame_id_t> entry) {
+  heap_[pos] = entry;
+  pos_[entry.second] = pos;
+}
+
+void LRUKReplacer::FrameHeap::SiftUp(size_t pos) {
+  auto entry = heap_[pos];
+  while (pos > 0 && entry.first < heap_[(pos - 1) / 2].first) {
+    Place(pos, heap_[(pos - 1) / 2]);
+    pos = (pos - 1) / 2;
+  }
+  Place(pos, entry);
+}
+
+void LRUKReplacer::FrameHeap::SiftDown(size_t pos) {
+  auto entry = heap_[pos];
+  while (true) {
+    auto child = 2 * pos + 1;
+    if (child >= heap_.size()) {
+      break;
+    }
+    if (child + 1 < heap_.size() && heap_[child + 1].first < heap_[child].first) {
+      child++;
+    }
+    if (entry.first <= heap_[child].first) {
+      break;
+    }
+    Place(pos, heap_[child]);
+    pos = child;
+  }
+  Place(pos, entry);
+}
+
+LRUKReplacer::LRUKReplacer(size_t num_frames, size_t k)
+    : node_store_(num_frames),
+      history_(num_frames * k),
+      new_frames_(num_frames),
+      k_frames_(num_frames),
+      scan_frames_(num_frames),
+      index_frames_(num_frames),
+      replacer_size_(num_frames),
+      k_(k) {
+  BUSTUB_ENSURE(k > 0, "k must be positive");
+  scan_ring_size_ = std::max<size_t>(1, num_frames / LRUK_SCAN_RING_RATIO);
+  index_cap_ = num_frames / LRUK_INDEX_RESIDENCY_RATIO;
+}
+
+void LRUKReplacer::SetNumFrames(size_t num_frames) {
+  std::lock_guard<std::mutex> lock(latch_);
+  scan_ring_size_ = std::max<size_t>(1, num_frames / LRUK_SCAN_RING_RATIO);
+  index_cap_ = num_frames / LRUK_INDEX_RESIDENCY_RATIO;
+}
+
+auto LRUKReplacer::HeapOf(frame_id_t frame_id) -> FrameHeap & {
+  auto &node = node_store_[frame_id];
+  if (node.in_scan_ring_) {
+    return scan_frames_;
+  }
+  if (node.is_index_) {
+    return index_frames_;
+  }
+  return node.count_ < k_ ? new_frames_ : k_frames_;
+}
+
+void LRUKReplacer::RemoveFrame(frame_id_t frame_id) {
+  auto &node = node_store_[frame_id];
+  HeapOf(frame_id).Erase(frame_id);
+  if (node.in_scan_ring_) {
+    num_scan_frames_--;
+  }
+  if (node.is_index_) {
+    num_index_frames_--;
+  }
+  node = LRUKNode();
+  curr_size_--;
+}
 
 auto LRUKReplacer::Evict(frame_id_t *frame_id) -> bool {
   std::lock_guard<std::mutex> lock(latch_);
-  if (Size() == 0) {
+  evict_calls_.fetch_add(1, std::memory_order_relaxed);
+  if (curr_size_ == 0) {
     return false;
   }
-  for (auto it = new_frames_.rbegin(); it != new_frames_.rend(); it++) {
-    auto frame = *it;
-    if (evictable_[frame]) {
-      *frame_id = frame;
-      record_cnt_[frame] = 0;
-      new_frames_.erase(new_pos_[frame]);
-      new_pos_.erase(frame);
-      hist_[frame].clear();
-      curr_size_--;
-      return true;
-    }
-  }
-  for (auto it = k_frames_.begin(); it != k_frames_.end(); it++) {
-    auto frame = it->first;
-    if (evictable_[frame]) {
-      *frame_id = frame;
-      record_cnt_[frame] = 0;
-      k_frames_.erase(it);
-      k_pos_.erase(frame);
-      hist_[frame].clear();
-      curr_size_--;
-      return true;
-    }
+  if (num_scan_frames_ >= scan_ring_size_ && !scan_frames_.Empty()) {
+    *frame_id = scan_frames_.Top();
+  } else if (num_index_frames_ > index_cap_ && !index_frames_.Empty()) {
+    *frame_id = index_frames_.Top();
+  } else if (!new_frames_.Empty()) {
+    *frame_id = new_frames_.Top();
+  } else if (!k_frames_.Empty()) {
+    *frame_id = k_frames_.Top();
+  } else if (!scan_frames_.Empty()) {
+    // the scan ring is still growing, but there is nothing else left
+    *frame_id = scan_frames_.Top();
+  } else {
+    // only index frames within their cap are left
+    *frame_id = index_frames_.Top();
   }
-  return false;
+  // the victim is the top of a heap, no matter how many frames are tracked
+  evict_scan_length_.fetch_add(1, std::memory_order_relaxed);
+  RemoveFrame(*frame_id);
+  return true;
 }
-void LRUKReplacer::RecordAccess(frame_id_t frame_id, AccessType access_type) {
+
+void LRUKReplacer::RecordFrameAccess(frame_id_t frame_id, AccessType access_type, page_id_t /* page_id */) {
   std::lock_guard<std::mutex> lock(latch_);
-  if (frame_id > static_cast<frame_id_t>(replacer_size_)) {
+  if (frame_id < 0 || frame_id >= static_cast<frame_id_t>(replacer_size_)) {
     throw std::exception();
   }
-  current_timestamp_++;
-  hist_[frame_id].push_back(current_timestamp_);
-  size_t cnt = ++record_cnt_[frame_id];
-  if (cnt == 1) {
-    if (curr_size_ == replacer_size_) {
-      frame_id_t frame;
-      Evict(&frame);
+  auto &node = node_store_[frame_id];
+  auto timestamp = ++current_timestamp_;
+  if (access_type == AccessType::Scan) {
+    if (node.count_ == 0 && !node.in_scan_ring_) {
+      node.in_scan_ring_ = true;
+      node.is_evictable_ = true;
+      history_[frame_id * k_] = timestamp;
+      scan_frames_.Push(frame_id, timestamp);
+      num_scan_frames_++;
+      curr_size_++;
     }
-    evictable_[frame_id] = true;
-    curr_size_++;
-    new_frames_.push_front(frame_id);
-    new_pos_[frame_id] = new_frames_.begin();
-  }
-  if (cnt == k_) {
-    new_frames_.erase(new_pos_[frame_id]);
-    new_pos_.erase(frame_id);
-    auto kth_time = hist_[frame_id].front();
-    k_time new_k(frame_id, kth_time);
-    auto it = std::upper_bound(k_frames_.begin(), k_frames_.end(), new_k, CmpTimestamp);
-    it = k_frames_.insert(it, new_k);
-    k_pos_[frame_id] = it;
+    // scans never add to a K-history, so they cannot make a page look hot
     return;
   }
-  if (cnt > k_) {
-    hist_[frame_id].erase(hist_[frame_id].begin());
-    k_frames_.erase(k_pos_[frame_id]);
-    auto kth_time = hist_[frame_id].front();
-    k_time new_k(frame_id, kth_time);
-    auto it = std::upper_bound(k_frames_.begin(), k_frames_.end(), new_k, CmpTimestamp);
-    it = k_frames_.insert(it, new_k);
-    k_pos_[frame_id] = it;
-    return;
+  if (node.is_evictable_) {
+    HeapOf(frame_id).Erase(frame_id);
+  }
+  if (node.in_scan_ring_) {
+    // the first non-scan access starts a regular history, the frame keeps its evictable state
+    node.in_scan_ring_ = false;
+    num_scan_frames_--;
+  } else if (node.count_ == 0) {
+    node.is_evictable_ = true;
+    curr_size_++;
+  }
+  if (access_type == AccessType::Index && !node.is_index_) {
+    // an index page stays one until it leaves the frame
+    node.is_index_ = true;
+    num_index_frames_++;
+  }
+  auto *history = &history_[frame_id * k_];
+  if (node.count_ < k_) {
+    history[node.count_++] = timestamp;
+  } else {
+    history[node.oldest_] = timestamp;
+    node.oldest_ = (node.oldest_ + 1) % k_;
+  }
+  if (node.is_evictable_) {
+    HeapOf(frame_id).Push(frame_id, Key(frame_id));
   }
 }
 
 void LRUKReplacer::SetEvictable(frame_id_t frame_id, bool set_evictable) {
   std::lock_guard<std::mutex> lock(latch_);
-  if (record_cnt_[frame_id] == 0) {
-    return;
+  if (frame_id < 0 || frame_id >= static_cast<frame_id_t>(replacer_size_)) {
+    throw std::exception();
   }
-  auto status = evictable_[frame_id];
-  evictable_[frame_id] = set_evictable;
-  if (status && !set_evictable) {
-    --max_size_;
-    --curr_size_;
+  auto &node = node_store_[frame_id];
+  if ((node.count_ == 0 && !node.in_scan_ring_) || node.is_evictable_ == set_evictable) {
+    return;
   }
-  if (!status && set_evictable) {
-    ++max_size_;
-    ++curr_size_;
+  node.is_evictable_ = set_evictable;
+  if (set_evictable) {
+    HeapOf(frame_id).Push(frame_id, Key(frame_id));
+    curr_size_++;
+  } else {
+    HeapOf(frame_id).Erase(frame_id);
+    curr_size_--;
   }
 }
 
 void LRUKReplacer::Remove(frame_id_t frame_id) {
   std::lock_guard<std::mutex> lock(latch_);
-  if (frame_id > static_cast<frame_id_t>(replacer_size_)) {
+  if (frame_id < 0 || frame_id >= static_cast<frame_id_t>(replacer_size_)) {
     throw std::exception();
   }
-  auto cnt = record_cnt_[frame_id];
-  if (cnt == 0) {
+  auto &node = node_store_[frame_id];
+  if (node.count_ == 0 && !node.in_scan_ring_) {
     return;
   }
-  if (!evictable_[frame_id]) {
+  if (!node.is_evictable_) {
     throw std::exception();
   }
-  if (cnt < k_) {
-    new_frames_.erase(new_pos_[frame_id]);
-    new_pos_.erase(frame_id);
-    record_cnt_[frame_id] = 0;
-    hist_[frame_id].clear();
-    curr_size_--;
-  } else {
-    k_frames_.erase(k_pos_[frame_id]);
-    k_pos_.erase(frame_id);
-    record_cnt_[frame_id] = 0;
-    hist_[frame_id].clear();
-    curr_size_--;
-  }
+  RemoveFrame(frame_id);
 }
 
-auto LRUKReplacer::Size() -> size_t { return curr_size_; }
+void LRUKReplacer::PeekHeap(FrameHeap *heap, size_t max_frames, std::vector<frame_id_t> *frames) {
+  auto begin = frames->size();
+  while (frames->size() < max_frames && !heap->Empty()) {
+    frames->push_back(heap->Top());
+    heap->Erase(heap->Top());
+  }
+  for (auto i = begin; i < frames->size(); i++) {
+    heap->Push((*frames)[i], Key((*frames)[i]));
+  }
+}
 
-auto LRUKReplacer::CmpTimestamp(const LRUKReplacer::k_time &f1, const LRUKReplacer::k_time &f2) -> bool {
-  return f1.second < f2.second;
+auto LRUKReplacer::EvictionCandidates(size_t max_frames) -> std::vector<frame_id_t> {
+  std::lock_guard<std::mutex> lock(latch_);
+  std::vector<frame_id_t> frames;
+  bool scan_ring_full = num_scan_frames_ >= scan_ring_size_;
+  if (scan_ring_full) {
+    PeekHeap(&scan_frames_, max_frames, &frames);
+  }
+  // the index frames beyond the cap go before the others, the rest after all of them
+  std::vector<frame_id_t> index_frames;
+  PeekHeap(&index_frames_, max_frames, &index_frames);
+  auto over_cap = num_index_frames_ > index_cap_ ? num_index_frames_ - index_cap_ : 0;
+  auto split = index_frames.begin() + std::min(over_cap, index_frames.size());
+  frames.insert(frames.end(), index_frames.begin(), split);
+  PeekHeap(&new_frames_, max_frames, &frames);
+  PeekHeap(&k_frames_, max_frames, &frames);
+  if (!scan_ring_full) {
+    PeekHeap(&scan_frames_, max_frames, &frames);
+  }
+  frames.insert(frames.end(), split, index_frames.end());
+  frames.resize(std::min(frames.size(), max_frames));
+  return frames;
 }
 
+auto LRUKReplacer::Size() -> size_t { return curr_size_; }
+
 }  // namespace bustub
@@ -12,18 +12,85 @@
 
 #include "buffer/lru_replacer.h"
 
+#include <exception>
+
 namespace bustub {
 
-LRUReplacer::LRUReplacer(size_t num_pages) {}
+LRUReplacer::LRUReplacer(size_t num_pages)
+    : num_frames_(num_pages), tracked_(num_pages), evictable_(num_pages), lru_pos_(num_pages) {}
 
 LRUReplacer::~LRUReplacer() = default;
 
-auto LRUReplacer::Victim(frame_id_t *frame_id) -> bool { return false; }
+void LRUReplacer::RecordFrameAccess(frame_id_t frame_id, AccessType /* access_type */, page_id_t /* page_id */) {
+  BUSTUB_ASSERT(frame_id >= 0 && static_cast<size_t>(frame_id) < num_frames_, "invalid frame id");
+  std::lock_guard<std::mutex> lock(latch_);
+  if (!tracked_[frame_id]) {
+    tracked_[frame_id] = true;
+    evictable_[frame_id] = true;
+  } else if (evictable_[frame_id]) {
+    lru_list_.erase(lru_pos_[frame_id]);
+  } else {
+    return;
+  }
+  lru_list_.push_front(frame_id);
+  lru_pos_[frame_id] = lru_list_.begin();
+}
+
+void LRUReplacer::SetEvictable(frame_id_t frame_id, bool set_evictable) {
+  BUSTUB_ASSERT(frame_id >= 0 && static_cast<size_t>(frame_id) < num_frames_, "invalid frame id");
+  std::lock_guard<std::mutex> lock(latch_);
+  if (!tracked_[frame_id] || evictable_[frame_id] == set_evictable) {
+    return;
+  }
+  evictable_[frame_id] = set_evictable;
+  if (set_evictable) {
+    lru_list_.push_front(frame_id);
+    lru_pos_[frame_id] = lru_list_.begin();
+  } else {
+    lru_list_.erase(lru_pos_[frame_id]);
+  }
+}
+
+void LRUReplacer::Remove(frame_id_t frame_id) {
+  BUSTUB_ASSERT(frame_id >= 0 && static_cast<size_t>(frame_id) < num_frames_, "invalid frame id");
+  std::lock_guard<std::mutex> lock(latch_);
+  if (!tracked_[frame_id]) {
+    return;
+  }
+  if (!evictable_[frame_id]) {
+    throw std::exception();
+  }
+  lru_list_.erase(lru_pos_[frame_id]);
+  tracked_[frame_id] = false;
+  evictable_[frame_id] = false;
+}
 
-void LRUReplacer::Pin(frame_id_t frame_id) {}
+auto LRUReplacer::Evict(frame_id_t *frame_id) -> bool {
+  std::lock_guard<std::mutex> lock(latch_);
+  evict_calls_.fetch_add(1, std::memory_order_relaxed);
+  if (lru_list_.empty()) {
+    return false;
+  }
+  evict_scan_length_.fetch_add(1, std::memory_order_relaxed);
+  *frame_id = lru_list_.back();
+  lru_list_.pop_back();
+  tracked_[*frame_id] = false;
+  evictable_[*frame_id] = false;
+  return true;
+}
 
-void LRUReplacer::Unpin(frame_id_t frame_id) {}
+auto LRUReplacer::EvictionCandidates(size_t max_frames) -> std::vector<frame_id_t> {
+  std::lock_guard<std::mutex> lock(latch_);
+  std::vector<frame_id_t> frames;
+  for (auto it = lru_list_.rbegin(); it != lru_list_.rend() && frames.size() < max_frames; it++) {
+    frames.push_back(*it);
+  }
+  return frames;
+}
 
-auto LRUReplacer::Size() -> size_t { return 0; }
+auto LRUReplacer::Size() -> size_t {
+  std::lock_guard<std::mutex> lock(latch_);
+  return lru_list_.size();
+}
 
 }  // namespace bustub
@@ -0,0 +1,98 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_table.cpp
+//
+// Identification: src/buffer/page_table.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/page_table.h"
+
+namespace bustub {
+
+PageTable::PageTable(size_t max_entries) {
+  size_t bits = 3;
+  while ((static_cast<size_t>(1) << bits) < 2 * max_entries) {
+    bits++;
+  }
+  slots_ = std::vector<std::atomic<uint64_t>>(static_cast<size_t>(1) << bits);
+  for (auto &slot : slots_) {
+    slot.store(EMPTY, std::memory_order_relaxed);
+  }
+  mask_ = slots_.size() - 1;
+  shift_ = 64 - bits;
+}
+
+auto PageTable::Find(page_id_t page_id) const -> frame_id_t {
+  auto slot = Home(page_id);
+  for (size_t i = 0; i < slots_.size(); i++) {
+    auto entry = slots_[slot].load();
+    if (entry == EMPTY) {
+      return -1;
+    }
+    if (PageOf(entry) == page_id) {
+      return FrameOf(entry);
+    }
+    slot = (slot + 1) & mask_;
+  }
+  return -1;
+}
+
+void PageTable::Insert(page_id_t page_id, frame_id_t frame_id) {
+  auto slot = Home(page_id);
+  while (true) {
+    auto entry = slots_[slot].load(std::memory_order_relaxed);
+    if (entry == EMPTY || PageOf(entry) == page_id) {
+      slots_[slot].store(MakeEntry(page_id, frame_id));
+      return;
+    }
+    slot = (slot + 1) & mask_;
+  }
+}
+
+void PageTable::Erase(page_id_t page_id) {
+  auto hole = Home(page_id);
+  while (true) {
+    auto entry = slots_[hole].load(std::memory_order_relaxed);
+    if (entry == EMPTY) {
+      return;
+    }
+    if (PageOf(entry) == page_id) {
+      break;
+    }
+    hole = (hole + 1) & mask_;
+  }
+  // Shift later entries of the probe sequence back into the hole, so that lookups never need tombstones. An entry
+  // can fill the hole if its home slot is not cyclically within (hole, slot].
+  auto slot = hole;
+  while (true) {
+    slot = (slot + 1) & mask_;
+    auto entry = slots_[slot].load(std::memory_order_relaxed);
+    if (entry == EMPTY) {
+      break;
+    }
+    auto home = Home(PageOf(entry));
+    if (((slot - home) & mask_) >= ((slot - hole) & mask_)) {
+      slots_[hole].store(entry);
+      hole = slot;
+    }
+  }
+  slots_[hole].store(EMPTY);
+}
+
+auto PageTable::GetPageIds() const -> std::vector<page_id_t> {
+  std::vector<page_id_t> page_ids;
+  for (const auto &slot : slots_) {
+    auto entry = slot.load(std::memory_order_relaxed);
+    if (entry != EMPTY) {
+      page_ids.push_back(PageOf(entry));
+    }
+  }
+  return page_ids;
+}
+
+}  // namespace bustub
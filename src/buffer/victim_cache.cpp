@@ -0,0 +1,103 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// victim_cache.cpp
+//
+// Identification: src/buffer/victim_cache.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/victim_cache.h"
+
+#include <cstring>
+
+#include "common/util/compression_util.h"
+
+namespace bustub {
+
+VictimCache::VictimCache(size_t budget) : budget_(budget) {}
+
+void VictimCache::SetBudget(size_t budget) {
+  std::lock_guard<std::mutex> lock(latch_);
+  budget_ = budget;
+  Shrink(budget);
+}
+
+void VictimCache::Insert(page_id_t page_id, const char *data) {
+  // compress before taking the latch, the evicting threads of all shards come through here
+  Entry entry;
+  entry.is_compressed_ = CompressionUtil::Compress(data, BUSTUB_PAGE_SIZE, &entry.data_);
+  if (!entry.is_compressed_) {
+    entry.data_.assign(data, BUSTUB_PAGE_SIZE);
+  }
+  entry.data_.shrink_to_fit();
+
+  std::lock_guard<std::mutex> lock(latch_);
+  auto budget = budget_.load(std::memory_order_relaxed);
+  if (entry.data_.size() > budget) {
+    return;
+  }
+  if (auto it = entries_.find(page_id); it != entries_.end()) {
+    Drop(it);
+  }
+  Shrink(budget - entry.data_.size());
+  size_ += entry.data_.size();
+  fifo_.push_front(page_id);
+  entry.pos_ = fifo_.begin();
+  entries_.emplace(page_id, std::move(entry));
+}
+
+auto VictimCache::Take(page_id_t page_id, char *data) -> bool {
+  Entry entry;
+  {
+    std::lock_guard<std::mutex> lock(latch_);
+    auto it = entries_.find(page_id);
+    if (it == entries_.end()) {
+      return false;
+    }
+    entry = Drop(it);
+  }
+  if (!entry.is_compressed_) {
+    memcpy(data, entry.data_.data(), BUSTUB_PAGE_SIZE);
+    return true;
+  }
+  [[maybe_unused]] auto ok = CompressionUtil::Decompress(entry.data_.data(), entry.data_.size(), data, BUSTUB_PAGE_SIZE);
+  BUSTUB_ASSERT(ok, "the victim cache holds a corrupt page");
+  return true;
+}
+
+void VictimCache::Erase(page_id_t page_id) {
+  std::lock_guard<std::mutex> lock(latch_);
+  if (auto it = entries_.find(page_id); it != entries_.end()) {
+    Drop(it);
+  }
+}
+
+auto VictimCache::GetNumPages() -> size_t {
+  std::lock_guard<std::mutex> lock(latch_);
+  return entries_.size();
+}
+
+auto VictimCache::GetSize() -> size_t {
+  std::lock_guard<std::mutex> lock(latch_);
+  return size_;
+}
+
+void VictimCache::Shrink(size_t budget) {
+  while (size_ > budget) {
+    Drop(entries_.find(fifo_.back()));
+  }
+}
+
+auto VictimCache::Drop(std::unordered_map<page_id_t, Entry>::iterator it) -> Entry {
+  size_ -= it->second.data_.size();
+  fifo_.erase(it->second.pos_);
+  auto entry = std::move(it->second);
+  entries_.erase(it);
+  return entry;
+}
+
+}  // namespace bustub
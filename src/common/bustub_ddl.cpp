@@ -3,6 +3,7 @@
 
 #include <optional>
 #include <shared_mutex>
+#include <stdexcept>
 #include <string>
 #include <tuple>
 
@@ -128,11 +129,30 @@ void BustubInstance::HandleExplainStatement(Transaction *txn, const ExplainState
 void BustubInstance::HandleVariableShowStatement(Transaction *txn, const VariableShowStatement &stmt,
                                                  ResultWriter &writer) {
   auto content = GetSessionVariable(stmt.variable_);
+  if (stmt.variable_ == "buffer_pool_size" && buffer_pool_manager_ != nullptr) {
+    content = std::to_string(buffer_pool_manager_->GetPoolSize());
+  }
   WriteOneCell(fmt::format("{}={}", stmt.variable_, content), writer);
 }
 
 void BustubInstance::HandleVariableSetStatement(Transaction *txn, const VariableSetStatement &stmt,
                                                 ResultWriter &writer) {
+  if (stmt.variable_ == "buffer_pool_size" && buffer_pool_manager_ != nullptr) {
+    size_t pool_size = 0;
+    try {
+      pool_size = std::stoul(stmt.value_);
+    } catch (const std::logic_error &e) {
+      throw Exception(fmt::format("invalid buffer_pool_size: {}", stmt.value_));
+    }
+    if (pool_size < buffer_pool_manager_->GetNumShards() || pool_size > buffer_pool_manager_->GetMaxPoolSize()) {
+      throw Exception(fmt::format("buffer_pool_size must be in [{}, {}]", buffer_pool_manager_->GetNumShards(),
+                                  buffer_pool_manager_->GetMaxPoolSize()));
+    }
+    // shrinking waits for pinned pages, and this statement holds none
+    if (!buffer_pool_manager_->Resize(pool_size)) {
+      throw Exception("buffer_pool_size: pages stayed pinned too long to shrink the buffer pool, try again later");
+    }
+  }
   session_variables_[stmt.variable_] = stmt.value_;
 }
 
@@ -42,51 +42,16 @@ auto BustubInstance::MakeExecutorContext(Transaction *txn, bool is_modify) -> st
   return std::make_unique<ExecutorContext>(txn, catalog_, buffer_pool_manager_, txn_manager_, lock_manager_, is_modify);
 }
 
-BustubInstance::BustubInstance(const std::string &db_file_name) {
-  enable_logging = false;
-
-  // Storage related.
-  disk_manager_ = new DiskManager(db_file_name);
-
-  // Log related.
-  log_manager_ = new LogManager(disk_manager_);
-
-  // We need more frames for GenerateTestTable to work. Therefore, we use 128 instead of the default
-  // buffer pool size specified in `config.h`.
-  try {
-    buffer_pool_manager_ = new BufferPoolManager(128, disk_manager_, LRUK_REPLACER_K, log_manager_);
-  } catch (NotImplementedException &e) {
-    std::cerr << "BufferPoolManager is not implemented, only mock tables are supported." << std::endl;
-    buffer_pool_manager_ = nullptr;
-  }
-
-  // Transaction (txn) related.
-
-  lock_manager_ = new LockManager();
-
-  txn_manager_ = new TransactionManager(lock_manager_, log_manager_);
-
-  lock_manager_->txn_manager_ = txn_manager_;
+BustubInstance::BustubInstance(const std::string &db_file_name, bool use_direct_io)
+    : BustubInstance(new DiskManager(db_file_name, use_direct_io)) {}
 
-#ifndef __EMSCRIPTEN__
-  lock_manager_->StartDeadlockDetection();
-#endif
+BustubInstance::BustubInstance() : BustubInstance(new DiskManagerUnlimitedMemory()) {}
 
-  // Checkpoint related.
-  checkpoint_manager_ = new CheckpointManager(txn_manager_, log_manager_, buffer_pool_manager_);
-
-  // Catalog.
-  catalog_ = new Catalog(buffer_pool_manager_, lock_manager_, log_manager_);
-
-  // Execution engine.
-  execution_engine_ = new ExecutionEngine(buffer_pool_manager_, txn_manager_, catalog_);
-}
-
-BustubInstance::BustubInstance() {
+BustubInstance::BustubInstance(DiskManager *disk_manager) {
   enable_logging = false;
 
   // Storage related.
-  disk_manager_ = new DiskManagerUnlimitedMemory();
+  disk_manager_ = disk_manager;
 
   // Log related.
   log_manager_ = new LogManager(disk_manager_);
@@ -94,7 +59,8 @@ BustubInstance::BustubInstance() {
   // We need more frames for GenerateTestTable to work. Therefore, we use 128 instead of the default
   // buffer pool size specified in `config.h`.
   try {
-    buffer_pool_manager_ = new BufferPoolManager(128, disk_manager_, LRUK_REPLACER_K, log_manager_);
+    buffer_pool_manager_ = new BufferPoolManager(128, disk_manager_, LRUK_REPLACER_K, log_manager_, 1,
+                                                 ReplacerPolicy::LRUK, BUFFER_POOL_MAX_SIZE);
   } catch (NotImplementedException &e) {
     std::cerr << "BufferPoolManager is not implemented, only mock tables are supported." << std::endl;
     buffer_pool_manager_ = nullptr;
@@ -176,6 +142,7 @@ void BustubInstance::CmdDisplayHelp(ResultWriter &writer) {
 
 \dt: show all tables
 \di: show all indices
+\bpm: show the buffer pool statistics
 \help: show this message again
 
 BusTub shell currently only supports a small set of Postgres queries. We'll set
@@ -189,6 +156,13 @@ see the execution plan of your query.
   WriteOneCell(help, writer);
 }
 
+void BustubInstance::CmdDisplayBufferPoolStats(ResultWriter &writer) {
+  if (buffer_pool_manager_ == nullptr) {
+    throw Exception("the buffer pool manager is not available");
+  }
+  WriteOneCell(buffer_pool_manager_->GetStats().ToString(), writer);
+}
+
 auto BustubInstance::ExecuteSql(const std::string &sql, ResultWriter &writer,
                                 std::shared_ptr<CheckOptions> check_options) -> bool {
   auto txn = txn_manager_->Begin();
@@ -216,6 +190,10 @@ auto BustubInstance::ExecuteSqlTxn(const std::string &sql, ResultWriter &writer,
       CmdDisplayIndices(writer);
       return true;
     }
+    if (sql == "\\bpm") {
+      CmdDisplayBufferPoolStats(writer);
+      return true;
+    }
     if (sql == "\\help") {
       CmdDisplayHelp(writer);
       return true;
@@ -235,6 +213,13 @@ auto BustubInstance::ExecuteSqlTxn(const std::string &sql, ResultWriter &writer,
 
     bool is_delete = false;
 
+    if (buffer_pool_manager_ != nullptr && buffer_pool_manager_->IsReadOnly() &&
+        statement->type_ != StatementType::SELECT_STATEMENT && statement->type_ != StatementType::EXPLAIN_STATEMENT &&
+        statement->type_ != StatementType::VARIABLE_SHOW_STATEMENT &&
+        statement->type_ != StatementType::VARIABLE_SET_STATEMENT) {
+      throw Exception(fmt::format("{} is not supported on a read-only database", statement->type_));
+    }
+
     switch (statement->type_) {
       case StatementType::CREATE_STATEMENT: {
         const auto &create_stmt = dynamic_cast<const CreateStatement &>(*statement);
@@ -0,0 +1,99 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// checksum_util.cpp
+//
+// Identification: src/common/util/checksum_util.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "common/util/checksum_util.h"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define BUSTUB_HAS_SSE42_CRC 1
+#endif
+
+namespace bustub {
+
+namespace {
+
+/** The reflected CRC32C polynomial. */
+constexpr uint32_t CRC32C_POLYNOMIAL = 0x82F63B78;
+
+auto MakeTable() -> std::array<uint32_t, 256> {
+  std::array<uint32_t, 256> table{};
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ ((crc & 1) != 0 ? CRC32C_POLYNOMIAL : 0);
+    }
+    table[i] = crc;
+  }
+  return table;
+}
+
+auto Crc32cSoftware(const char *data, size_t size, uint32_t crc) -> uint32_t {
+  static const std::array<uint32_t, 256> TABLE = MakeTable();
+  const auto *bytes = reinterpret_cast<const unsigned char *>(data);
+  for (size_t i = 0; i < size; i++) {
+    crc = TABLE[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return crc;
+}
+
+#ifdef BUSTUB_HAS_SSE42_CRC
+// compiled for SSE4.2 on its own, the rest of the binary still runs on CPUs without it
+__attribute__((target("sse4.2"))) auto Crc32cHardware(const char *data, size_t size, uint32_t crc) -> uint32_t {
+#if defined(__x86_64__)
+  uint64_t crc64 = crc;
+  for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t), data += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, data, sizeof(word));
+    crc64 = _mm_crc32_u64(crc64, word);
+  }
+  crc = static_cast<uint32_t>(crc64);
+#else
+  // the 64-bit instruction exists in 64-bit mode only
+  for (; size >= sizeof(uint32_t); size -= sizeof(uint32_t), data += sizeof(uint32_t)) {
+    uint32_t word;
+    memcpy(&word, data, sizeof(word));
+    crc = _mm_crc32_u32(crc, word);
+  }
+#endif
+  for (; size > 0; size--, data++) {
+    crc = _mm_crc32_u8(crc, static_cast<unsigned char>(*data));
+  }
+  return crc;
+}
+#endif
+
+}  // namespace
+
+auto ChecksumUtil::IsHardwareAccelerated() -> bool {
+#ifdef BUSTUB_HAS_SSE42_CRC
+  static const bool HAS_SSE42 = __builtin_cpu_supports("sse4.2") != 0;
+  return HAS_SSE42;
+#else
+  return false;
+#endif
+}
+
+auto ChecksumUtil::Crc32c(const char *data, size_t size, uint32_t crc) -> uint32_t {
+  // the checksum is kept inverted between calls, so that leading zero bytes change it
+  crc = ~crc;
+#ifdef BUSTUB_HAS_SSE42_CRC
+  if (IsHardwareAccelerated()) {
+    return ~Crc32cHardware(data, size, crc);
+  }
+#endif
+  return ~Crc32cSoftware(data, size, crc);
+}
+
+}  // namespace bustub
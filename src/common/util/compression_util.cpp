@@ -0,0 +1,155 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// compression_util.cpp
+//
+// Identification: src/common/util/compression_util.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "common/util/compression_util.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace bustub {
+
+namespace {
+
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t MAX_OFFSET = 65535;
+constexpr size_t HASH_BITS = 12;
+
+auto Load32(const char *data) -> uint32_t {
+  uint32_t value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+/** Append the part of a length beyond the 15 of its nibble. */
+void PutLength(std::string *dst, size_t length) {
+  for (; length >= 255; length -= 255) {
+    dst->push_back(static_cast<char>(255));
+  }
+  dst->push_back(static_cast<char>(length));
+}
+
+/** Add the continuation bytes of a length to it. */
+auto GetLength(const unsigned char **in, const unsigned char *end, size_t *length) -> bool {
+  unsigned char byte;
+  do {
+    if (*in == end) {
+      return false;
+    }
+    byte = *(*in)++;
+    *length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+/** Append one (literals, match) pair, a match length of 0 ends the output. */
+void PutSequence(std::string *dst, const char *literals, size_t num_literals, size_t offset, size_t match_length) {
+  size_t match_code = match_length == 0 ? 0 : match_length - MIN_MATCH;
+  auto token = std::min<size_t>(num_literals, 15) << 4 | std::min<size_t>(match_code, 15);
+  dst->push_back(static_cast<char>(token));
+  if (num_literals >= 15) {
+    PutLength(dst, num_literals - 15);
+  }
+  dst->append(literals, num_literals);
+  if (match_length == 0) {
+    return;
+  }
+  dst->push_back(static_cast<char>(offset & 0xFF));
+  dst->push_back(static_cast<char>(offset >> 8));
+  if (match_code >= 15) {
+    PutLength(dst, match_code - 15);
+  }
+}
+
+}  // namespace
+
+auto CompressionUtil::Compress(const char *src, size_t src_size, std::string *dst) -> bool {
+  dst->clear();
+  dst->reserve(src_size);
+  // the last position each 4-byte sequence was seen at, candidates are verified so stale entries are harmless
+  std::array<uint32_t, 1 << HASH_BITS> last_seen{};
+  size_t anchor = 0;
+  size_t pos = 0;
+  while (pos + MIN_MATCH <= src_size) {
+    auto sequence = Load32(src + pos);
+    auto &slot = last_seen[(sequence * 2654435761U) >> (32 - HASH_BITS)];
+    size_t candidate = slot;
+    slot = static_cast<uint32_t>(pos);
+    if (candidate >= pos || pos - candidate > MAX_OFFSET || Load32(src + candidate) != sequence) {
+      // the longer nothing matched, the faster we skip ahead, so data that does not compress costs little
+      pos += 1 + ((pos - anchor) >> 6);
+      continue;
+    }
+    size_t length = MIN_MATCH;
+    while (pos + length < src_size && src[candidate + length] == src[pos + length]) {
+      length++;
+    }
+    PutSequence(dst, src + anchor, pos - anchor, pos - candidate, length);
+    pos += length;
+    anchor = pos;
+    if (dst->size() >= src_size) {
+      return false;
+    }
+  }
+  PutSequence(dst, src + anchor, src_size - anchor, 0, 0);
+  return dst->size() < src_size;
+}
+
+auto CompressionUtil::Decompress(const char *src, size_t src_size, char *dst, size_t dst_size) -> bool {
+  const auto *in = reinterpret_cast<const unsigned char *>(src);
+  const auto *end = in + src_size;
+  size_t out = 0;
+  while (in < end) {
+    unsigned token = *in++;
+    size_t num_literals = token >> 4;
+    if (num_literals == 15 && !GetLength(&in, end, &num_literals)) {
+      return false;
+    }
+    if (static_cast<size_t>(end - in) < num_literals || dst_size - out < num_literals) {
+      return false;
+    }
+    memcpy(dst + out, in, num_literals);
+    in += num_literals;
+    out += num_literals;
+    if (in == end) {
+      // the last pair has literals only
+      break;
+    }
+
+    if (end - in < 2) {
+      return false;
+    }
+    size_t offset = in[0] | static_cast<size_t>(in[1]) << 8;
+    in += 2;
+    size_t length = token & 15;
+    if (length == 15 && !GetLength(&in, end, &length)) {
+      return false;
+    }
+    length += MIN_MATCH;
+    if (offset == 0 || offset > out || dst_size - out < length) {
+      return false;
+    }
+    if (offset >= length) {
+      memcpy(dst + out, dst + out - offset, length);
+    } else {
+      // the match overlaps the bytes it produces, e.g. a run of zeros
+      for (size_t i = 0; i < length; i++) {
+        dst[out + i] = dst[out + i - offset];
+      }
+    }
+    out += length;
+  }
+  return out == dst_size;
+}
+
+}  // namespace bustub
@@ -0,0 +1,120 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// arc_replacer.h
+//
+// Identification: src/include/buffer/arc_replacer.h
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <list>
+#include <mutex>  // NOLINT
+#include <unordered_map>
+#include <vector>
+
+#include "buffer/replacer.h"
+#include "common/config.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+/**
+ * ARCReplacer implements the Adaptive Replacement Cache policy (Megiddo and Modha, FAST '03).
+ *
+ * Resident frames are split into T1, frames whose page was accessed once since it was loaded, and T2, frames
+ * whose page was accessed again. The replacer also remembers the pages recently evicted from T1 and T2 in the
+ * ghost lists B1 and B2. A page loaded again while it is in B1 means T1 was too small, one in B2 means T2 was
+ * too small, and the target size of T1 moves accordingly. Victims come from the LRU end of T1 while T1 is larger
+ * than its target, and from T2 otherwise.
+ *
+ * The ghost lists are keyed by page id, so they only work if the buffer pool passes page ids to RecordAccess.
+ * Scans never promote a frame to T2 and never adapt the target.
+ */
+class ARCReplacer : public Replacer {
+ public:
+  /**
+   * @brief a new ARCReplacer.
+   * @param num_frames the maximum number of frames the replacer will be required to store
+   */
+  explicit ARCReplacer(size_t num_frames);
+
+  DISALLOW_COPY_AND_MOVE(ARCReplacer);
+
+  ~ARCReplacer() override = default;
+
+  auto Evict(frame_id_t *frame_id) -> bool override;
+
+  /** Put the frame back into the list it was evicted from, without the ghost hit adapting the target. */
+  void Restore(frame_id_t frame_id, page_id_t page_id) override;
+
+  void SetEvictable(frame_id_t frame_id, bool set_evictable) override;
+
+  void Remove(frame_id_t frame_id) override;
+
+  auto EvictionCandidates(size_t max_frames) -> std::vector<frame_id_t> override;
+
+  auto Size() -> size_t override;
+
+  void SetNumFrames(size_t num_frames) override;
+
+  /** @return the current target size of T1, for tests */
+  auto GetTarget() -> size_t;
+
+ protected:
+  void RecordFrameAccess(frame_id_t frame_id, AccessType access_type, page_id_t page_id) override;
+
+ private:
+  enum class ListType { None = 0, T1, T2 };
+
+  /** Per-frame state, indexed by frame id. */
+  struct FrameInfo {
+    ListType list_{ListType::None};
+    bool is_evictable_{false};
+    page_id_t page_id_{INVALID_PAGE_ID};
+    /** Position in t1_ or t2_. */
+    std::list<frame_id_t>::iterator pos_;
+  };
+
+  /** Where a ghost page is remembered. */
+  struct GhostEntry {
+    bool in_b2_;
+    std::list<page_id_t>::iterator pos_;
+  };
+
+  auto ListOf(ListType list) -> std::list<frame_id_t> & { return list == ListType::T1 ? t1_ : t2_; }
+  /** Put a frame at the MRU end of a resident list. Caller holds latch_. */
+  void Insert(frame_id_t frame_id, ListType list);
+  /** Take a frame off its resident list. Caller holds latch_. */
+  void Unlink(frame_id_t frame_id);
+  /**
+   * The least recently used evictable frame of a resident list, or -1. The frames it skips count towards the Evict
+   * scan length. Caller holds latch_.
+   */
+  auto LruEvictable(const std::list<frame_id_t> &list) -> frame_id_t;
+  /** Remember an evicted page in B1 or B2, and drop the oldest ghosts beyond the cache size. Caller holds latch_. */
+  void AddGhost(page_id_t page_id, bool in_b2);
+  void DropGhost(page_id_t page_id);
+
+  const size_t num_frames_;
+  /** The cache size c of the paper, the number of frames in use. */
+  size_t capacity_;
+  std::vector<FrameInfo> frames_;
+  /** Resident frames, most recently used in front. */
+  std::list<frame_id_t> t1_;
+  std::list<frame_id_t> t2_;
+  /** Ghost pages, most recently evicted in front. */
+  std::list<page_id_t> b1_;
+  std::list<page_id_t> b2_;
+  std::unordered_map<page_id_t, GhostEntry> ghosts_;
+  /** Target size of T1. */
+  size_t target_{0};
+  size_t curr_size_{0};
+  std::mutex latch_;
+};
+
+}  // namespace bustub
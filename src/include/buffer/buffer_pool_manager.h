@@ -12,22 +12,97 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <functional>
+#include <future>  // NOLINT
 #include <list>
 #include <memory>
 #include <mutex>  // NOLINT
-#include <unordered_map>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
 
-#include "buffer/lru_k_replacer.h"
+#include "buffer/frame_arena.h"
+#include "buffer/page_table.h"
+#include "buffer/replacer.h"
+#include "buffer/victim_cache.h"
 #include "common/config.h"
 #include "recovery/log_manager.h"
 #include "storage/disk/disk_manager.h"
+#include "storage/disk/disk_scheduler.h"
+#include "storage/disk/page_allocator.h"
 #include "storage/page/page.h"
 #include "storage/page/page_guard.h"
 
 namespace bustub {
 
+/** Number of AccessType values, the per-access-type counters of BufferPoolStats are indexed by them. */
+static constexpr size_t NUM_ACCESS_TYPES = static_cast<size_t>(AccessType::Index) + 1;
+
+/**
+ * A snapshot of the counters of a BufferPoolManager, see BufferPoolManager::GetStats. All counters start at zero when
+ * the pool is created and only grow.
+ */
+struct BufferPoolStats {
+  /** Fetches that found their page in the pool, indexed by AccessType. */
+  std::array<size_t, NUM_ACCESS_TYPES> hits_{};
+  /** Fetches that had to read their page in, indexed by AccessType. */
+  std::array<size_t, NUM_ACCESS_TYPES> misses_{};
+  /** Pages evicted to make room for another one. */
+  size_t evictions_{0};
+  /** Dirty victims written back by NewPage and the fetches, on the caller's thread. */
+  size_t foreground_write_backs_{0};
+  /** Dirty frames written back by the background page cleaner. */
+  size_t background_write_backs_{0};
+  /** Time fetches spent waiting for the I/O of the page they wanted to pin, in nanoseconds. */
+  uint64_t pin_wait_ns_{0};
+  /** Time spent blocked on shard latches, in nanoseconds. */
+  uint64_t latch_wait_ns_{0};
+  /** Calls of the replacers' Evict, and the number of frames they looked at to find their victims. */
+  size_t evict_calls_{0};
+  size_t evict_scan_length_{0};
+  /** Pages read in by the warm-up after a restart. */
+  size_t warm_up_loads_{0};
+  /** Misses served by the victim cache instead of the disk. */
+  size_t victim_cache_hits_{0};
+  /** Pages in the victim cache, and the bytes their compressed copies take. */
+  size_t victim_cache_pages_{0};
+  size_t victim_cache_bytes_{0};
+  /** Pages read from disk that did not match their checksum. */
+  size_t checksum_failures_{0};
+
+  /** @return the hits over all access types */
+  auto TotalHits() const -> size_t;
+  /** @return the misses over all access types */
+  auto TotalMisses() const -> size_t;
+  /** @return one "name value" line per counter, plus the hit ratio and the average scan length */
+  auto ToString() const -> std::string;
+};
+
 /**
  * BufferPoolManager reads disk pages to and from its internal buffer pool.
+ *
+ * The frames of the pool can be partitioned into several shards. Every page id is hashed to exactly one shard, and
+ * each shard owns its own latch, page table, replacer and free list, so that accesses to pages living in different
+ * shards never contend with each other. With a single shard (the default) the pool behaves like a classic buffer pool.
+ * Hits on resident pages do not take the shard latch, but they do take the replacer's own latch unless the replacer
+ * is the ClockReplacer, see FetchHit.
+ *
+ * The pool can be resized while it is in use, up to the maximum size given at construction, see Resize.
+ *
+ * If the disk manager has a database file, FlushAllPages and the destructor write the ids of the resident pages,
+ * hottest first, to the disk manager's warm file. A pool created later on the same database reads the hottest of
+ * them back in the background, in page id order and only into free frames, so it reaches its steady-state hit rate
+ * without waiting for the workload to fault every page in again.
+ *
+ * If the disk manager maps a read-only snapshot of the database file, see DiskManagerSnapshot, the frames are not used
+ * at all: fetches return pages that point straight into the mapping, and everything that would modify a page fails.
+ * NewPage and FetchPageWrite return nothing, and BasicPageGuard::GetDataMut throws. A page is verified against its
+ * checksum on its first fetch, a corrupt one is not returned.
  */
 class BufferPoolManager {
  public:
@@ -37,9 +112,14 @@ class BufferPoolManager {
    * @param disk_manager the disk manager
    * @param replacer_k the LookBack constant k for the LRU-K replacer
    * @param log_manager the log manager (for testing only: nullptr = disable logging). Please ignore this for P1.
+   * @param num_shards the number of partitions the frames are split into, must be in [1, pool_size]
+   * @param replacer_policy the replacement policy of every shard, replacer_k only matters for LRU-K
+   * @param max_pool_size the largest size Resize may grow the pool to, 0 for pool_size. Room for it is reserved up
+   * front, but frames only take memory once they are used.
    */
   BufferPoolManager(size_t pool_size, DiskManager *disk_manager, size_t replacer_k = LRUK_REPLACER_K,
-                    LogManager *log_manager = nullptr);
+                    LogManager *log_manager = nullptr, size_t num_shards = 1,
+                    ReplacerPolicy replacer_policy = ReplacerPolicy::LRUK, size_t max_pool_size = 0);
 
   /**
    * @brief Destroy an existing BufferPoolManager.
@@ -49,15 +129,41 @@ class BufferPoolManager {
   /** @brief Return the size (number of frames) of the buffer pool. */
   auto GetPoolSize() -> size_t { return pool_size_; }
 
+  /** @brief Return the largest size the buffer pool can be resized to. */
+  auto GetMaxPoolSize() -> size_t { return max_pool_size_; }
+
+  /**
+   * @brief Grow or shrink the buffer pool while it is in use.
+   *
+   * Every shard keeps a slice of max_pool_size / num_shards frames and uses a prefix of it. Growing hands more of the
+   * slice to the free list. Shrinking stops handing out the frames at the end of the slice, then evicts their pages,
+   * writing dirty ones back, and gives their memory back to the OS. Pinned pages stay where they are until they are
+   * unpinned, so shrinking waits for them. If they are still pinned after resize_timeout, e.g. because the caller
+   * holds one of them, the resize fails and every shard gets its old frames back.
+   *
+   * @param pool_size the new number of frames, in [GetNumShards(), GetMaxPoolSize()]
+   * @return false if pool_size is out of range or shrinking timed out, true once the pool has the new size
+   */
+  auto Resize(size_t pool_size) -> bool;
+
   /** @brief Return the pointer to all the pages in the buffer pool. */
   auto GetPages() -> Page * { return pages_; }
 
+  /** @brief Return the number of shards the buffer pool is partitioned into. */
+  auto GetNumShards() -> size_t { return shards_.size(); }
+
+  /** @brief Return true if the pool serves a read-only snapshot of the database file. */
+  auto IsReadOnly() const -> bool { return snapshot_data_ != nullptr; }
+
   /**
    * TODO(P1): Add implementation
    *
    * @brief Create a new page in the buffer pool. Set page_id to the new page's id, or nullptr if all frames
    * are currently in use and not evictable (in another word, pinned).
    *
+   * With multiple shards, only the frames of the shard that the new page id hashes to are considered. The ids of
+   * deleted pages are reused, lowest first, before new ones are appended to the database file.
+   *
    * You should pick the replacement frame from either the free list or the replacer (always find from the free list
    * first), and then call the AllocatePage() method to get a new page id. If the replacement frame has a dirty page,
    * you should write it back to the disk first. You also need to reset the memory and metadata for the new page.
@@ -67,9 +173,10 @@ class BufferPoolManager {
    * Also, remember to record the access history of the frame in the replacer for the lru-k algorithm to work.
    *
    * @param[out] page_id id of created page
+   * @param access_type type of access to the page, index structures should pass AccessType::Index
    * @return nullptr if no new pages could be created, otherwise pointer to new page
    */
-  auto NewPage(page_id_t *page_id) -> Page *;
+  auto NewPage(page_id_t *page_id, AccessType access_type = AccessType::Unknown) -> Page *;
 
   /**
    * TODO(P1): Add implementation
@@ -81,9 +188,37 @@ class BufferPoolManager {
    * BasicPageGuard structure.
    *
    * @param[out] page_id, the id of the new page
+   * @param access_type type of access to the page, index structures should pass AccessType::Index
    * @return BasicPageGuard holding a new page
    */
-  auto NewPageGuarded(page_id_t *page_id) -> BasicPageGuard;
+  auto NewPageGuarded(page_id_t *page_id, AccessType access_type = AccessType::Unknown) -> BasicPageGuard;
+
+  /**
+   * @brief Reserve a run of consecutive page ids past the end of the database file, so that the pages of one table
+   * end up next to each other on disk no matter what other tables allocate in between.
+   *
+   * The pages are created one at a time with NewPageInExtent. Ids that are never used should be handed back with
+   * ReleaseExtent, otherwise they stay allocated as holes in the file.
+   *
+   * @param num_pages the number of page ids to reserve, at least 1
+   * @return the first page id of the extent
+   */
+  auto AllocateExtent(page_id_t num_pages) -> page_id_t;
+
+  /**
+   * @brief Create a new page like NewPage, but with an id reserved by AllocateExtent.
+   * @param page_id an id reserved by AllocateExtent that was not used yet. It stays reserved if no frame is available.
+   * @param access_type type of access to the page
+   * @return nullptr if no frame is available, otherwise pointer to the new page
+   */
+  auto NewPageInExtent(page_id_t page_id, AccessType access_type = AccessType::Unknown) -> Page *;
+
+  /**
+   * @brief Hand the unused ids of an extent back, so that NewPage recycles them.
+   * @param first_page_id the first unused id
+   * @param num_pages the number of unused ids from first_page_id on
+   */
+  void ReleaseExtent(page_id_t first_page_id, page_id_t num_pages);
 
   /**
    * TODO(P1): Add implementation
@@ -99,7 +234,7 @@ class BufferPoolManager {
    * In addition, remember to disable eviction and record the access history of the frame like you did for NewPage().
    *
    * @param page_id id of page to be fetched
-   * @param access_type type of access to the page, only needed for leaderboard tests.
+   * @param access_type type of access to the page, pages only accessed by scans are evicted first.
    * @return nullptr if page_id cannot be fetched, otherwise pointer to the requested page
    */
   auto FetchPage(page_id_t page_id, AccessType access_type = AccessType::Unknown) -> Page *;
@@ -115,11 +250,44 @@ class BufferPoolManager {
    * the returned page already has a read or write latch held, respectively.
    *
    * @param page_id, the id of the page to fetch
+   * @param access_type type of access to the page, scans should pass AccessType::Scan and index structures
+   * AccessType::Index, so that their pages stay resident over data pages
    * @return PageGuard holding the fetched page
    */
-  auto FetchPageBasic(page_id_t page_id) -> BasicPageGuard;
-  auto FetchPageRead(page_id_t page_id) -> ReadPageGuard;
-  auto FetchPageWrite(page_id_t page_id) -> WritePageGuard;
+  auto FetchPageBasic(page_id_t page_id, AccessType access_type = AccessType::Unknown) -> BasicPageGuard;
+  auto FetchPageRead(page_id_t page_id, AccessType access_type = AccessType::Unknown) -> ReadPageGuard;
+  auto FetchPageWrite(page_id_t page_id, AccessType access_type = AccessType::Unknown) -> WritePageGuard;
+
+  /**
+   * @brief Fetch several pages at once and read latch them, like calling FetchPageRead for each of them.
+   *
+   * All misses get their frames up front, and their reads are then handed to the disk scheduler all at once, so that
+   * N misses cost about one device latency instead of N. Dirty victims are still written back one at a time before
+   * that. The read latches are taken in the order of page_ids.
+   *
+   * Each page is fetched and latched once. If a page id shows up more than once, only its first guard holds the page,
+   * the guards of the repetitions are empty.
+   *
+   * @param page_ids the ids of the pages to fetch
+   * @param access_type type of access to the pages
+   * @return one guard per page id, in the same order. Like with FetchPageRead, the guard holds no page if every frame
+   * of the page's shard was pinned, which also happens if the batch needs more frames than the shard has.
+   */
+  auto FetchPagesRead(const std::vector<page_id_t> &page_ids, AccessType access_type = AccessType::Unknown)
+      -> std::vector<ReadPageGuard>;
+
+  /**
+   * @brief Like FetchPageRead, but the page is read optimistically instead of under its read latch.
+   *
+   * Reads through the returned guard have to be validated, see OptimisticReadPageGuard. Meant for short reads of
+   * pages that many threads read at once.
+   *
+   * @param page_id, the id of the page to fetch
+   * @param access_type type of access to the page
+   * @return OptimisticReadPageGuard holding the fetched page
+   */
+  auto FetchPageOptimistic(page_id_t page_id, AccessType access_type = AccessType::Unknown)
+      -> OptimisticReadPageGuard;
 
   /**
    * TODO(P1): Add implementation
@@ -146,17 +314,87 @@ class BufferPoolManager {
    * Unset the dirty flag of the page after flushing.
    *
    * @param page_id id of page to be flushed, cannot be INVALID_PAGE_ID
-   * @return false if the page could not be found in the page table, true otherwise
+   * @return false if the page could not be found in the page table or not be written, true otherwise. A page that
+   * could not be written stays dirty.
    */
   auto FlushPage(page_id_t page_id) -> bool;
 
   /**
    * TODO(P1): Add implementation
    *
-   * @brief Flush all the pages in the buffer pool to disk.
+   * @brief Flush all the dirty pages in the buffer pool to disk, and remember the resident pages for a warm restart.
+   *
+   * The pages are written back in page id order, in batches of up to FLUSH_BATCH_SIZE pages and half the pool, which
+   * are pinned during the write.
+   * Each batch goes out through DiskManager::WritePages, which writes runs of neighbouring pages with one call and
+   * syncs once per batch, so a checkpoint runs at sequential bandwidth.
    */
   void FlushAllPages();
 
+  /**
+   * @brief Bring a page into the buffer pool in the background, without pinning it for the caller.
+   * @param page_id id of the page to prefetch
+   */
+  void PrefetchPage(page_id_t page_id);
+
+  /**
+   * @brief Read ahead along a chain of pages in the background.
+   *
+   * Starting at page_id, up to window pages are brought into the buffer pool with AccessType::Scan. The id of the page
+   * following each one is taken from its content by next_page_id, e.g. TablePage::GetNextPageId. Pages that are
+   * already buffered only cost a lookup, so callers can simply re-issue the request every time they advance a page.
+   * The window is capped to a small share of the pool, and requests are dropped when the read-ahead queue is full.
+   *
+   * This is a serial prefetcher: a single background thread reads the window one page at a time, since it only learns
+   * the next page id from the page before. It hides the latency of a scan that consumes pages slower than the disk
+   * delivers them, but it never has more than one read in flight. It stops at a page whose frame would have to be
+   * taken from a dirty page, rather than write that page back itself.
+   *
+   * @param page_id id of the first page of the window
+   * @param window the number of pages to read ahead
+   * @param next_page_id extracts the id of the next page in the chain from a page's data, INVALID_PAGE_ID ends it
+   */
+  void ReadAhead(page_id_t page_id, size_t window, std::function<page_id_t(const char *)> next_page_id);
+
+  /**
+   * @brief Start the background page cleaner thread.
+   *
+   * Whenever the share of dirty frames exceeds high_watermark, the cleaner writes back dirty evictable frames in the
+   * order the replacer would evict them, until the share drops to low_watermark. Evictions on the foreground path
+   * then mostly find clean victims and don't have to wait for a write-back.
+   *
+   * @param high_watermark share of dirty frames in [0, 1] at which the cleaner starts writing back
+   * @param low_watermark share of dirty frames in [0, high_watermark] at which the cleaner stops again
+   */
+  void StartPageCleaner(double high_watermark = PAGE_CLEANER_HIGH_WATERMARK,
+                        double low_watermark = PAGE_CLEANER_LOW_WATERMARK);
+
+  /** @brief Stop and join the background page cleaner thread, if it is running. */
+  void StopPageCleaner();
+
+  /** @return the number of dirty victims written back by NewPage/FetchPage on the caller's thread */
+  auto GetForegroundWriteBacks() -> size_t { return foreground_write_backs_; }
+
+  /** @return the number of dirty frames written back by the background page cleaner */
+  auto GetBackgroundWriteBacks() -> size_t { return background_write_backs_; }
+
+  /**
+   * @brief Give evicted pages a second chance in a compressed in-memory victim cache.
+   *
+   * Evicted pages are compressed into the cache, dirty ones after they were written back, and a miss looks there
+   * before reading from disk. This trades some CPU on every eviction for fewer device reads when the working set is
+   * a bit larger than the pool, e.g. under repeated scans. The cache is disabled by default.
+   *
+   * @param budget the number of bytes the compressed pages may take, 0 disables the cache again
+   */
+  void SetVictimCacheBudget(size_t budget) { victim_cache_.SetBudget(budget); }
+
+  /**
+   * @brief Collect the counters of the pool. They are always on and cheap to keep: hits bump a relaxed counter of
+   * their shard, and the wait times are only measured when a thread actually has to wait.
+   */
+  auto GetStats() -> BufferPoolStats;
+
   /**
    * TODO(P1): Add implementation
    *
@@ -164,8 +402,8 @@ class BufferPoolManager {
    * page is pinned and cannot be deleted, return false immediately.
    *
    * After deleting the page from the page table, stop tracking the frame in the replacer and add the frame
-   * back to the free list. Also, reset the page's memory and metadata. Finally, you should call DeallocatePage() to
-   * imitate freeing the page on the disk.
+   * back to the free list. Also, reset the page's memory and metadata. Finally, call DeallocatePage() to free the
+   * page on disk for reuse. If page_id is not in the buffer pool, only deallocate it.
    *
    * @param page_id id of page to be deleted
    * @return false if the page exists but could not be deleted, true if the page didn't exist or deletion succeeded
@@ -173,39 +411,322 @@ class BufferPoolManager {
   auto DeletePage(page_id_t page_id) -> bool;
 
  private:
+  /**
+   * A partition of the buffer pool. The shard owns the frames [frame_offset_, frame_offset_ + capacity_) of pages_,
+   * together with the bookkeeping of every page id that hashes to it, and uses the first num_frames_ of them. The
+   * replacer works on shard-local frame ids.
+   */
+  struct Shard {
+    Shard(frame_id_t frame_offset, size_t capacity, size_t num_frames, size_t replacer_k,
+          ReplacerPolicy replacer_policy);
+
+    /** Global id of the first frame owned by this shard. */
+    const frame_id_t frame_offset_;
+    /** Number of frames reserved for this shard. */
+    const size_t capacity_;
+    /** Number of frames in use, frames beyond are never handed out. Protected by latch_. */
+    size_t num_frames_;
+    /** Number of frames whose Page has been constructed. They stay constructed until the pool is destroyed. */
+    size_t num_constructed_frames_;
+    /** Page table for keeping track of the pages buffered in this shard, lookups need no latch. */
+    PageTable page_table_;
+    /** Replacer to find unpinned frames of this shard for replacement, indexed by local frame id. */
+    std::unique_ptr<Replacer> replacer_;
+    /** List of free frames of this shard that don't have any pages on them. */
+    std::list<frame_id_t> free_list_;
+    /**
+     * Serializes the writers of page_table_, free_list_ and the metadata of the frames owned by this shard. Buffer
+     * hits and unpins only pin, validate and unpin frames with atomics, see FetchHit.
+     */
+    std::mutex latch_;
+
+    /** Counters of this shard, on their own cache line since latch-free hits bump them. */
+    struct alignas(CACHE_LINE_SIZE) Stats {
+      std::array<std::atomic<size_t>, NUM_ACCESS_TYPES> hits_{};
+      std::array<std::atomic<size_t>, NUM_ACCESS_TYPES> misses_{};
+      std::atomic<size_t> evictions_{0};
+    } stats_;
+  };
+
   /** Number of pages in the buffer pool. */
-  const size_t pool_size_;
-  /** The next page id to be allocated  */
-  std::atomic<page_id_t> next_page_id_ = 0;
+  std::atomic<size_t> pool_size_;
+  /** Largest pool_size_ the pool can be resized to. */
+  const size_t max_pool_size_;
+  /** Serializes calls to Resize. */
+  std::mutex resize_latch_;
+  /** Hands out page ids, recycling those of deleted pages. */
+  PageAllocator page_allocator_;
 
-  /** Array of buffer pool pages. */
+  /** Data of the buffer pool frames. */
+  std::unique_ptr<FrameArena> arena_;
+  /** Array of buffer pool pages, their data lives in arena_. */
   Page *pages_;
   /** Pointer to the disk manager. */
   DiskManager *disk_manager_ __attribute__((__unused__));
+  /** The mapped database file of a read-only snapshot, nullptr otherwise. */
+  const char *snapshot_data_{nullptr};
+  page_id_t snapshot_num_pages_{0};
+  /** The page of each page id of the snapshot, created on its first fetch. */
+  std::unique_ptr<std::atomic<Page *>[]> snapshot_pages_;
+  /** Executes the page reads and writes, so that several of them can be in flight at once. */
+  std::unique_ptr<DiskScheduler> disk_scheduler_;
   /** Pointer to the log manager. Please ignore this for P1. */
   LogManager *log_manager_ __attribute__((__unused__));
-  /** Page table for keeping track of buffer pool pages. */
-  std::unordered_map<page_id_t, frame_id_t> page_table_;
-  /** Replacer to find unpinned pages for replacement. */
-  std::unique_ptr<LRUKReplacer> replacer_;
-  /** List of free frames that don't have any pages on them. */
-  std::list<frame_id_t> free_list_;
-  /** This latch protects shared data structures. We recommend updating this comment to describe what it protects. */
-  std::mutex latch_;
+  /** Partitions of the buffer pool, a page lives in shards_[page_id % shards_.size()]. */
+  std::vector<std::unique_ptr<Shard>> shards_;
+
+  /** Number of frames holding a dirty page. */
+  std::atomic<size_t> num_dirty_frames_{0};
+  /** Dirty victims written back on the foreground path. */
+  std::atomic<size_t> foreground_write_backs_{0};
+  /** Dirty frames written back by the page cleaner. */
+  std::atomic<size_t> background_write_backs_{0};
+  /** Compressed copies of evicted pages, disabled unless SetVictimCacheBudget was called. */
+  VictimCache victim_cache_;
+  std::atomic<size_t> victim_cache_hits_{0};
+  /** Nanoseconds spent waiting for frame I/O and on shard latches, see BufferPoolStats. */
+  std::atomic<uint64_t> pin_wait_ns_{0};
+  std::atomic<uint64_t> latch_wait_ns_{0};
+
+  /** Shares of dirty frames the page cleaner was started with, the watermarks follow them when the pool is resized. */
+  double cleaner_high_share_{0};
+  double cleaner_low_share_{0};
+  /** Number of dirty frames at which the page cleaner starts writing back. */
+  std::atomic<size_t> cleaner_high_watermark_{0};
+  /** Number of dirty frames at which the page cleaner stops writing back. */
+  std::atomic<size_t> cleaner_low_watermark_{0};
+  std::atomic<bool> enable_page_cleaner_{false};
+  std::thread *page_cleaner_thread_{nullptr};
+  /** Wakes the page cleaner up early, when the high watermark is crossed or on shutdown. */
+  std::condition_variable cleaner_cv_;
+  std::mutex cleaner_latch_;
+
+  /** A pending ReadAhead call. */
+  struct ReadAheadRequest {
+    page_id_t page_id_;
+    size_t window_;
+    std::function<page_id_t(const char *)> next_page_id_;
+  };
+  /** The largest read-ahead window allowed for this pool. */
+  std::atomic<size_t> max_read_ahead_window_;
+  /** Pending read-ahead requests, protected by read_ahead_latch_. */
+  std::deque<ReadAheadRequest> read_ahead_queue_;
+  bool stop_read_ahead_{false};
+  std::mutex read_ahead_latch_;
+  std::condition_variable read_ahead_cv_;
+  std::thread *read_ahead_thread_;
+
+  /** Side file of the resident page ids, empty if the disk manager has no database file. */
+  std::string warm_file_name_;
+  std::atomic<bool> stop_warm_up_{false};
+  std::thread *warm_up_thread_{nullptr};
+  std::atomic<size_t> warm_up_loads_{0};
+  /** Side file of the page allocator's free-space map, empty if the disk manager has no database file. */
+  std::string fsm_file_name_;
+
+  /**
+   * Pin count of frames in the free list or being evicted. Pinning only succeeds on frames with a non-negative pin
+   * count, so moving a frame from 0 to UNPINNABLE with a CAS is what makes it safe to evict.
+   */
+  static constexpr int UNPINNABLE = -1;
+
+  /** @return the shard that is responsible for the given page id */
+  auto GetShard(page_id_t page_id) -> Shard & { return *shards_[static_cast<size_t>(page_id) % shards_.size()]; }
+
+  /** @brief Take the latch of a shard, adding the time spent blocked on it to latch_wait_ns_. */
+  auto LockShard(Shard *shard) -> std::unique_lock<std::mutex>;
+
+  /** @brief Count a hit or miss of a fetch in the shard's counters. */
+  void CountFetch(Shard *shard, AccessType access_type, bool hit);
+
+  /**
+   * @brief Take a frame from the free list of the shard, or evict one. Caller should hold the shard latch.
+   *
+   * If the evicted page is dirty, or the victim cache is enabled, it stays in the page table (mapped to a frame that
+   * now carries another page id) until SaveVictim is done with it, so that concurrent requests for it wait instead of
+   * reading a stale copy.
+   *
+   * @param[out] frame_id the global id of the acquired frame
+   * @param[out] victim_page_id the evicted page that must be saved first, or INVALID_PAGE_ID
+   * @return false if every frame of the shard is pinned
+   */
+  auto AcquireFrame(Shard *shard, frame_id_t *frame_id, page_id_t *victim_page_id) -> bool;
+
+  /**
+   * @brief Hand the frames [num_frames_, num_frames) of the shard's slice to its free list.
+   */
+  void GrowShard(Shard *shard, size_t num_frames);
+
+  /**
+   * @brief Stop using the frames [num_frames, num_frames_) of the shard's slice, waiting for pinned ones.
+   * @return false if some of them were still pinned at the deadline, the shard keeps all its frames then
+   */
+  auto ShrinkShard(Shard *shard, size_t num_frames, std::chrono::steady_clock::time_point deadline) -> bool;
+
+  /**
+   * @brief Evict the page of a frame that is being removed by ShrinkShard, writing it back if it is dirty.
+   * @return false if the page is pinned or could not be written back, true if the frame is empty now
+   */
+  auto RetireFrame(Shard *shard, std::unique_lock<std::mutex> *lock, frame_id_t frame_id) -> bool;
+
+  /** @brief Derive the page cleaner and read-ahead limits from the pool size. */
+  void UpdateLimits(size_t pool_size);
+
+  /**
+   * @brief Make a frame returned by AcquireFrame hold page_id, pinned once and marked as having I/O in progress.
+   * Caller holds the latch and has to read the page in and call FinishIo afterwards.
+   */
+  void InstallFrame(Shard *shard, frame_id_t frame_id, page_id_t page_id, AccessType access_type);
+
+  /** @brief Put an empty frame back on the free list, unless a shrink is retiring it. Caller holds the latch. */
+  void FreeFrame(Shard *shard, frame_id_t frame_id);
+
+  /** @brief Clear the I/O flag of a frame and wake up its waiters. Caller holds the latch. */
+  void FinishIo(frame_id_t frame_id);
+
+  /**
+   * @brief Install page_id into a frame returned by AcquireFrame, pin it and bring its content in from disk, or zero
+   * it if is_new_page is set.
+   *
+   * The frame is marked as having I/O in progress and the shard latch is released while the previous page is saved
+   * and the new one is read, so that a miss never blocks hits on other pages of the shard. Other requesters of
+   * page_id wait on the frame only. The latch is held again when this function returns.
+   *
+   * @return false if the dirty victim could not be written back, it stays in the frame then, or if the page could not
+   * be read. Either way page_id is not in the pool and the frame is not pinned for the caller.
+   */
+  auto LoadFrame(Shard *shard, std::unique_lock<std::mutex> *lock, frame_id_t frame_id, page_id_t page_id,
+                 page_id_t victim_page_id, AccessType access_type, bool is_new_page) -> bool;
+
+  /**
+   * @brief Move an evicted page out of its frame: write it back if it is dirty, and put it into the victim cache if
+   * that is enabled. Called without the latch, the page stays mapped to the frame until the caller erases it.
+   * @return false if the page could not be written back
+   */
+  auto SaveVictim(frame_id_t frame_id, page_id_t victim_page_id, bool is_dirty) -> bool;
+
+  /**
+   * @brief Undo the eviction of a dirty victim that could not be written back: the frame holds the victim again, and
+   * page_id, installed in its place, is dropped. Unpins the frame and finishes its I/O. Caller holds the latch.
+   */
+  void KeepVictim(Shard *shard, frame_id_t frame_id, page_id_t page_id, page_id_t victim_page_id);
+
+  /**
+   * @brief Drop page_id from a frame it could not be read into. The frame goes back to the free list, or, if others
+   * already wait for the page, is left empty for the replacer once they see the page is gone and unpin it. Unpins the
+   * frame and finishes its I/O. Caller holds the latch.
+   */
+  void AbandonFrame(Shard *shard, frame_id_t frame_id, page_id_t page_id);
+
+  /** @brief Mark a page dirty again after its write-back failed. */
+  void MarkDirty(Page *page);
+
+  /**
+   * @brief Bring a page's content in from the victim cache, or from disk if it is not there. Needs no latch.
+   * @return false if the page could not be read
+   */
+  auto ReadPageData(page_id_t page_id, char *data) -> bool;
+
+  /**
+   * @brief Like ReadPageData, but only start reading from disk. The future is ready once data holds the page, it is
+   * false if the page could not be read.
+   */
+  auto ScheduleReadPageData(page_id_t page_id, char *data) -> std::future<bool>;
+
+  /**
+   * @brief Look up the frame holding page_id, waiting for SaveVictim to finish first if the page was just evicted.
+   * Caller should hold the shard latch through lock. The returned frame may still be reading the page in.
+   * @return the global frame id, or -1 if the page is not buffered in the shard
+   */
+  auto FindFrame(Shard *shard, std::unique_lock<std::mutex> *lock, page_id_t page_id) -> frame_id_t;
+
+  /**
+   * @brief The latch-free hit path: look the page up, pin its frame and validate that it still holds the page.
+   *
+   * The replacer only learns about the pin afterwards, so its evictable flags are hints: AcquireFrame treats a frame
+   * as evictable only once it moved the pin count from 0 to UNPINNABLE.
+   *
+   * This only skips the shard latch. The hit still calls RecordAccess and SetEvictable, and so does the last
+   * UnpinPage, so with a replacer that has its own mutex (LRU-K, LRU, ARC) every hit and unpin still serialize on
+   * it. Only the ClockReplacer records them without a latch.
+   *
+   * @return the pinned page, or nullptr if the slow path under the shard latch has to decide
+   */
+  auto FetchHit(Shard *shard, page_id_t page_id, AccessType access_type) -> Page *;
+
+  /** @brief Pin a frame known to hold a page, e.g. found under the shard latch, and tell the replacer. */
+  void PinFrame(Shard *shard, frame_id_t frame_id);
+
+  /** @brief Drop one pin of a frame, the last one makes it evictable again. Needs no latch. */
+  void UnpinFrame(Shard *shard, frame_id_t frame_id);
+
+  /** @brief Body of the read-ahead thread, serves read_ahead_queue_ until the pool is destroyed. */
+  void RunReadAhead();
+
+  /** @return true if a frame of the shard is free or its next victim is clean. Caller holds the shard latch. */
+  auto HasCleanFrame(Shard *shard) -> bool;
+
+  /**
+   * @brief Write the ids of the resident pages to the warm file, hottest first. The shards take turns, each giving
+   * its pinned pages and then its evictable ones in the reverse of the replacer's eviction order.
+   */
+  void DumpResidentPages();
+
+  /** @brief Write back the pages of a FlushAllPages batch that are dirty, page_ids being sorted. */
+  void FlushBatch(const std::vector<page_id_t> &page_ids);
+
+  /** @brief Write the page allocator's free-space map to its side file, so freed pages are reused after a restart. */
+  void SaveFreeSpaceMap();
+
+  /**
+   * @brief Read the warm file left behind by an earlier pool on the same database, and start warming up with the
+   * hottest pool-size pages of it that are still allocated.
+   */
+  void StartWarmUp();
+
+  /**
+   * @brief Put a new, zeroed page with the given id into a frame of its shard.
+   * @param is_recycled whether the id was allocated before, the page is dirty from the start then
+   * @return nullptr if no frame is available
+   */
+  auto CreatePage(page_id_t page_id, bool is_recycled, AccessType access_type) -> Page *;
+
+  /**
+   * @brief Return the page of the snapshot pointing into the mapping, nullptr if the page id is out of range or the page
+   * does not match its checksum.
+   */
+  auto FetchSnapshotPage(page_id_t page_id) -> Page *;
+
+  /** @brief Body of the warm-up thread, reads the pages in until it is done or the pool is destroyed. */
+  void RunWarmUp(std::vector<page_id_t> page_ids);
+
+  /** @brief Read a page into a free frame of its shard, unless it is buffered already or the shard is full. */
+  void WarmPage(page_id_t page_id);
+
+  /** @brief Body of the page cleaner thread. */
+  void RunPageCleaner();
+
+  /**
+   * @brief Write back up to PAGE_CLEANER_BATCH_SIZE dirty evictable frames of the shard, next victims first.
+   * @return the number of frames written back, frames that could not be written stay dirty
+   */
+  auto CleanShard(Shard *shard) -> size_t;
+
+  /** @brief Block until no I/O is in flight on the frame. Caller should hold the shard latch through lock. */
+  void WaitForIo(std::unique_lock<std::mutex> *lock, frame_id_t frame_id);
 
   /**
-   * @brief Allocate a page on disk. Caller should acquire the latch before calling this function.
-   * @return the id of the allocated page
+   * @brief Allocate a page id, reusing the one of a deleted page if there is any. Needs no latch.
+   * @param[out] is_recycled whether the page was deleted before, its old content may still be on disk then
+   * @return the page id
    */
-  auto AllocatePage() -> page_id_t;
+  auto AllocatePage(bool *is_recycled) -> page_id_t;
 
   /**
-   * @brief Deallocate a page on disk. Caller should acquire the latch before calling this function.
+   * @brief Deallocate a page on disk, so that its id is handed out again. Needs no latch.
    * @param page_id id of the page to deallocate
    */
-  void DeallocatePage(__attribute__((unused)) page_id_t page_id) {
-    // This is a no-nop right now without a more complex data structure to track deallocated pages
-  }
+  void DeallocatePage(page_id_t page_id) { page_allocator_.Deallocate(page_id); }
 
   // TODO(student): You may add additional private members and helper functions
 };
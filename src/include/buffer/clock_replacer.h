@@ -12,17 +12,23 @@
 
 #pragma once
 
-#include <list>
+#include <atomic>
 #include <mutex>  // NOLINT
 #include <vector>
 
 #include "buffer/replacer.h"
 #include "common/config.h"
+#include "common/macros.h"
 
 namespace bustub {
 
 /**
  * ClockReplacer implements the clock replacement policy, which approximates the Least Recently Used policy.
+ *
+ * The state of every frame (tracked, evictable, referenced) is a single atomic byte. Recording an access to a
+ * tracked frame only sets its reference bit, and does nothing at all if the bit is already set, so the hit path
+ * neither takes a latch nor writes a shared cache line in the common case. Only the clock hand is protected by
+ * a latch. Scans don't set the reference bit, so frames only touched by scans go at the next sweep.
  */
 class ClockReplacer : public Replacer {
  public:
@@ -32,21 +38,41 @@ class ClockReplacer : public Replacer {
    */
   explicit ClockReplacer(size_t num_pages);
 
+  DISALLOW_COPY_AND_MOVE(ClockReplacer);
+
   /**
    * Destroys the ClockReplacer.
    */
   ~ClockReplacer() override;
 
-  auto Victim(frame_id_t *frame_id) -> bool override;
+  auto Evict(frame_id_t *frame_id) -> bool override;
+
+  void SetEvictable(frame_id_t frame_id, bool set_evictable) override;
 
-  void Pin(frame_id_t frame_id) override;
+  void Remove(frame_id_t frame_id) override;
 
-  void Unpin(frame_id_t frame_id) override;
+  auto EvictionCandidates(size_t max_frames) -> std::vector<frame_id_t> override;
 
   auto Size() -> size_t override;
 
+ protected:
+  void RecordFrameAccess(frame_id_t frame_id, AccessType access_type, page_id_t page_id) override;
+
  private:
-  // TODO(student): implement me!
+  static constexpr uint8_t TRACKED = 1;
+  static constexpr uint8_t EVICTABLE = 2;
+  static constexpr uint8_t REFERENCED = 4;
+
+  /** Try to take the frame under the hand, clearing its reference bit if it is set. Caller holds latch_. */
+  auto TryEvict(frame_id_t frame_id, bool honor_reference) -> bool;
+
+  const size_t num_frames_;
+  /** TRACKED | EVICTABLE | REFERENCED bits of each frame. */
+  std::vector<std::atomic<uint8_t>> state_;
+  std::atomic<size_t> curr_size_{0};
+  /** The clock hand, protected by latch_. */
+  size_t hand_{0};
+  std::mutex latch_;
 };
 
 }  // namespace bustub
@@ -0,0 +1,65 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// frame_arena.h
+//
+// Identification: src/include/buffer/frame_arena.h
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <vector>
+
+#include "common/config.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+/**
+ * FrameArena owns the data of all frames of a buffer pool as one anonymous mmap region, aligned to
+ * FRAME_ARENA_ALIGNMENT and backed by transparent huge pages where the OS supports them. Frame i starts at byte
+ * i * BUSTUB_PAGE_SIZE, so every frame is page aligned and can be the target of an O_DIRECT transfer.
+ *
+ * In AddressSanitizer builds every frame is a separate page-aligned heap allocation instead, so that ASAN still
+ * catches a page overflowing into the next frame.
+ *
+ * Memory is only committed once a frame is first touched, so an arena can reserve room for a pool to grow into.
+ */
+class FrameArena {
+ public:
+  /**
+   * @brief Map zeroed memory for num_frames frames.
+   * @param num_frames the number of frames
+   */
+  explicit FrameArena(size_t num_frames);
+
+  DISALLOW_COPY_AND_MOVE(FrameArena);
+
+  ~FrameArena();
+
+  /**
+   * @return the data of the given frame, BUSTUB_PAGE_SIZE bytes. In sanitizer builds the frame is allocated on the
+   * first call, concurrent calls have to be for different frames.
+   */
+  auto GetFrameData(frame_id_t frame_id) -> char *;
+
+  /** @brief Give the memory of frames that are no longer used back to the OS. Their data reads as zeros after. */
+  void Discard(frame_id_t frame_id, size_t num_frames);
+
+  /** @return true if the frames are one contiguous mmap region */
+  auto IsContiguous() const -> bool { return frames_.empty(); }
+
+ private:
+  /** The mapped region, nullptr if the frames are allocated one by one. */
+  char *data_{nullptr};
+  /** Length of the mapped region, a multiple of FRAME_ARENA_ALIGNMENT. */
+  size_t size_{0};
+  /** Frames allocated one by one in sanitizer builds, nullptr until first used. */
+  std::vector<char *> frames_;
+};
+
+}  // namespace bustub
@@ -14,27 +14,25 @@
 
 #include <algorithm>
 #include <limits>
-#include <list>
 #include <mutex>  // NOLINT
-#include <unordered_map>
 #include <utility>
 #include <vector>
+#include "buffer/replacer.h"
 #include "common/config.h"
 #include "common/macros.h"
 
 namespace bustub {
 
-enum class AccessType { Unknown = 0, Get, Scan };
-
-class LRUKNode {
- private:
-  /** History of last seen K timestamps of this page. Least recent timestamp stored in front. */
-  // Remove maybe_unused if you start using them. Feel free to change the member variables as you want.
-
-  [[maybe_unused]] std::list<size_t> history_;
-  [[maybe_unused]] size_t k_;
-  [[maybe_unused]] frame_id_t fid_;
-  [[maybe_unused]] bool is_evictable_{false};
+/** Per-frame state of the LRU-K replacer, kept in a flat array indexed by frame id. */
+struct LRUKNode {
+  /** Number of timestamps in the frame's history, at most k. 0 if the frame has no regular history. */
+  size_t count_{0};
+  /** Slot of the least recent timestamp in the frame's circular history. */
+  size_t oldest_{0};
+  bool is_evictable_{false};
+  bool in_scan_ring_{false};
+  /** The frame holds an index page, it was accessed with AccessType::Index. */
+  bool is_index_{false};
 };
 
 /**
@@ -47,8 +45,27 @@ class LRUKNode {
  * A frame with less than k historical references is given
  * +inf as its backward k-distance. When multiple frames have +inf backward k-distance,
  * classical LRU algorithm is used to choose victim.
+ *
+ * To resist sequential flooding, frames that have only ever been accessed with AccessType::Scan
+ * are kept in a separate scan ring without any K-history. Once the ring holds 1/LRUK_SCAN_RING_RATIO
+ * of the frames, its oldest frame is always evicted first, so a large scan keeps recycling its own
+ * frames instead of pushing out pages that point lookups keep coming back to. Below that size, scan
+ * frames are evicted last. Scan accesses to frames with a regular history are ignored, and the
+ * first non-scan access moves a frame out of the scan ring.
+ *
+ * Frames accessed with AccessType::Index are the opposite: they are evicted after all other frames, least recently
+ * used first, as long as they make up at most 1/LRUK_INDEX_RESIDENCY_RATIO of the frames. Beyond that cap the least
+ * recently used index frame goes first, so index pages cannot crowd out the data pages entirely.
+ *
+ * All per-frame state lives in flat arrays sized at construction: the K-history of each frame is a
+ * fixed circular buffer, and the evictable frames of each class sit in an indexed min-heap. Every
+ * operation is O(log n) and nothing is allocated after construction.
+ *
+ * Every operation, RecordAccess and SetEvictable included, takes latch_. The buffer pool calls both on
+ * each hit and on the last unpin, so buffer pool hits serialize on this latch; use the ClockReplacer
+ * where that matters.
  */
-class LRUKReplacer {
+class LRUKReplacer : public Replacer {
  public:
   /**
    *
@@ -66,13 +83,14 @@ class LRUKReplacer {
    *
    * @brief Destroys the LRUReplacer.
    */
-  ~LRUKReplacer() = default;
+  ~LRUKReplacer() override = default;
 
   /**
    * TODO(P1): Add implementation
    *
    * @brief Find the frame with largest backward k-distance and evict that frame. Only frames
-   * that are marked as 'evictable' are candidates for eviction.
+   * that are marked as 'evictable' are candidates for eviction. Evictable frames of a full scan
+   * ring are picked before any other frame.
    *
    * A frame with less than k historical references is given +inf as its backward k-distance.
    * If multiple frames have inf backward k-distance, then evict frame with earliest timestamp
@@ -84,22 +102,7 @@ class LRUKReplacer {
    * @param[out] frame_id id of frame that is evicted.
    * @return true if a frame is evicted successfully, false if no frames can be evicted.
    */
-  auto Evict(frame_id_t *frame_id) -> bool;
-
-  /**
-   * TODO(P1): Add implementation
-   *
-   * @brief Record the event that the given frame id is accessed at current timestamp.
-   * Create a new entry for access history if frame id has not been seen before.
-   *
-   * If frame id is invalid (ie. larger than replacer_size_), throw an exception. You can
-   * also use BUSTUB_ASSERT to abort the process if frame id is invalid.
-   *
-   * @param frame_id id of frame that received a new access.
-   * @param access_type type of access that was received. This parameter is only needed for
-   * leaderboard tests.
-   */
-  void RecordAccess(frame_id_t frame_id, AccessType access_type = AccessType::Unknown);
+  auto Evict(frame_id_t *frame_id) -> bool override;
 
   /**
    * TODO(P1): Add implementation
@@ -118,7 +121,7 @@ class LRUKReplacer {
    * @param frame_id id of frame whose 'evictable' status will be modified
    * @param set_evictable whether the given frame is evictable or not
    */
-  void SetEvictable(frame_id_t frame_id, bool set_evictable);
+  void SetEvictable(frame_id_t frame_id, bool set_evictable) override;
 
   /**
    * TODO(P1): Add implementation
@@ -137,7 +140,15 @@ class LRUKReplacer {
    *
    * @param frame_id id of frame to be removed
    */
-  void Remove(frame_id_t frame_id);
+  void Remove(frame_id_t frame_id) override;
+
+  /**
+   * @brief Peek at the evictable frames in the order Evict would pick them, without evicting anything.
+   *
+   * @param max_frames the maximum number of frames to return
+   * @return up to max_frames evictable frame ids, the next victim first
+   */
+  auto EvictionCandidates(size_t max_frames) -> std::vector<frame_id_t> override;
 
   /**
    * TODO(P1): Add implementation
@@ -146,27 +157,88 @@ class LRUKReplacer {
    *
    * @return size_t
    */
-  auto Size() -> size_t;
+  auto Size() -> size_t override;
+
+  void SetNumFrames(size_t num_frames) override;
+
+ protected:
+  /**
+   * TODO(P1): Add implementation
+   *
+   * @brief Record the event that the given frame id is accessed at current timestamp.
+   * Create a new entry for access history if frame id has not been seen before.
+   *
+   * If frame id is invalid (ie. larger than replacer_size_), throw an exception. You can
+   * also use BUSTUB_ASSERT to abort the process if frame id is invalid.
+   *
+   * @param frame_id id of frame that received a new access.
+   * @param access_type type of access that was received. Frames only ever accessed by scans
+   * go to the scan ring, and scans don't count towards the history of other frames.
+   * @param page_id unused, LRU-K only looks at the history of the frame.
+   */
+  void RecordFrameAccess(frame_id_t frame_id, AccessType access_type, page_id_t page_id) override;
 
  private:
-  // TODO(student): implement me! You can replace these member variables as you like.
-  // Remove maybe_unused if you start using them.
-  std::unordered_map<frame_id_t, LRUKNode> node_store_;
+  /** Indexed binary min-heap of frame ids ordered by a timestamp, supporting removal of any frame. */
+  class FrameHeap {
+   public:
+    explicit FrameHeap(size_t num_frames);
+    void Push(frame_id_t frame_id, size_t key);
+    void Erase(frame_id_t frame_id);
+    auto Contains(frame_id_t frame_id) const -> bool { return pos_[frame_id] != NOT_IN_HEAP; }
+    auto Empty() const -> bool { return heap_.empty(); }
+    auto Top() const -> frame_id_t { return heap_.front().second; }
+
+   private:
+    static constexpr size_t NOT_IN_HEAP = std::numeric_limits<size_t>::max();
+    void Place(size_t pos, std::pair<size_t, frame_id_t> entry);
+    void SiftUp(size_t pos);
+    void SiftDown(size_t pos);
+    /** (key, frame id) pairs, capacity reserved for all frames. */
+    std::vector<std::pair<size_t, frame_id_t>> heap_;
+    /** Position of each frame in heap_, NOT_IN_HEAP if absent. */
+    std::vector<size_t> pos_;
+  };
+
+  /**
+   * The key a frame is ordered by in its heap: its first access, its k-th most recent access, or its scan. Index
+   * frames are ordered by their most recent access.
+   */
+  auto Key(frame_id_t frame_id) const -> size_t {
+    const auto &node = node_store_[frame_id];
+    auto slot = node.is_index_ ? (node.oldest_ + node.count_ - 1) % k_ : node.oldest_;
+    return history_[frame_id * k_ + slot];
+  }
+  /** The heap an evictable frame belongs in. */
+  auto HeapOf(frame_id_t frame_id) -> FrameHeap &;
+  /** Forget the frame entirely, caller holds latch_ and the frame is evictable. */
+  void RemoveFrame(frame_id_t frame_id);
+  /** Pop up to max_frames from the heap into frames, and push them back afterwards. */
+  void PeekHeap(FrameHeap *heap, size_t max_frames, std::vector<frame_id_t> *frames);
+
+  std::vector<LRUKNode> node_store_;
+  /** replacer_size_ * k_ timestamps, the circular history of frame f lives at [f * k_, (f + 1) * k_). */
+  std::vector<size_t> history_;
+  /** Evictable frames with less than k accesses, ordered by their first access. */
+  FrameHeap new_frames_;
+  /** Evictable frames with a full K-history, ordered by their k-th most recent access. */
+  FrameHeap k_frames_;
+  /** Evictable frames of the scan ring, ordered by their scan. */
+  FrameHeap scan_frames_;
+  /** Frames in the scan ring, evictable or not. */
+  size_t num_scan_frames_{0};
+  /** Size from which the scan ring recycles its own frames. */
+  size_t scan_ring_size_;
+  /** Evictable index frames, ordered by their most recent access. */
+  FrameHeap index_frames_;
+  /** Frames holding index pages, evictable or not. */
+  size_t num_index_frames_{0};
+  /** Number of index frames that are kept over all other frames. */
+  size_t index_cap_;
   size_t current_timestamp_{0};
   size_t curr_size_{0};
   size_t replacer_size_;
   size_t k_;
-  size_t max_size_;
   std::mutex latch_;
-  using k_time = std::pair<frame_id_t, size_t>;  // record the accessing times
-  using timestamp = std::list<size_t>;           // timestamp
-  std::unordered_map<frame_id_t, timestamp> hist_;
-  std::unordered_map<frame_id_t, size_t> record_cnt_;
-  std::unordered_map<frame_id_t, bool> evictable_;
-  std::list<frame_id_t> new_frames_;
-  std::unordered_map<frame_id_t, std::list<frame_id_t>::iterator> new_pos_;
-  std::list<k_time> k_frames_;
-  std::unordered_map<frame_id_t, std::list<k_time>::iterator> k_pos_;
-  static auto CmpTimestamp(const k_time &f1, const k_time &f2) -> bool;
 };
 }  // namespace bustub
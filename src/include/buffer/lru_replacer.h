@@ -18,11 +18,13 @@
 
 #include "buffer/replacer.h"
 #include "common/config.h"
+#include "common/macros.h"
 
 namespace bustub {
 
 /**
- * LRUReplacer implements the Least Recently Used replacement policy.
+ * LRUReplacer implements the Least Recently Used replacement policy. Evictable frames are kept in a list, most
+ * recently accessed or unpinned first, so every operation is O(1). The access type is ignored.
  */
 class LRUReplacer : public Replacer {
  public:
@@ -32,21 +34,35 @@ class LRUReplacer : public Replacer {
    */
   explicit LRUReplacer(size_t num_pages);
 
+  DISALLOW_COPY_AND_MOVE(LRUReplacer);
+
   /**
    * Destroys the LRUReplacer.
    */
   ~LRUReplacer() override;
 
-  auto Victim(frame_id_t *frame_id) -> bool override;
+  auto Evict(frame_id_t *frame_id) -> bool override;
+
+  void SetEvictable(frame_id_t frame_id, bool set_evictable) override;
 
-  void Pin(frame_id_t frame_id) override;
+  void Remove(frame_id_t frame_id) override;
 
-  void Unpin(frame_id_t frame_id) override;
+  auto EvictionCandidates(size_t max_frames) -> std::vector<frame_id_t> override;
 
   auto Size() -> size_t override;
 
+ protected:
+  void RecordFrameAccess(frame_id_t frame_id, AccessType access_type, page_id_t page_id) override;
+
  private:
-  // TODO(student): implement me!
+  const size_t num_frames_;
+  std::vector<bool> tracked_;
+  std::vector<bool> evictable_;
+  /** Evictable frames, most recently used in front. */
+  std::list<frame_id_t> lru_list_;
+  /** Position of each evictable frame in lru_list_. */
+  std::vector<std::list<frame_id_t>::iterator> lru_pos_;
+  std::mutex latch_;
 };
 
 }  // namespace bustub
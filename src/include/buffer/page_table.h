@@ -0,0 +1,74 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_table.h
+//
+// Identification: src/include/buffer/page_table.h
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "common/config.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+/**
+ * PageTable maps page ids to frame ids with linear probing over a fixed array of atomic slots, each holding a
+ * whole (page id, frame id) pair.
+ *
+ * Insert and Erase must be serialized by the caller, e.g. by the latch of a buffer pool shard. Find can run
+ * concurrently with them without any latch. A racing Find may miss a page that is present, because Erase shifts
+ * later entries back, but it never returns a frame the page was not mapped to at some point. Lock-free callers
+ * therefore validate what they find and retry a miss under the latch.
+ */
+class PageTable {
+ public:
+  /**
+   * @brief Create a table for at most max_entries pages, at most half of the slots are ever used.
+   * @param max_entries the maximum number of pages in the table at any time
+   */
+  explicit PageTable(size_t max_entries);
+
+  DISALLOW_COPY_AND_MOVE(PageTable);
+
+  /** @return the frame the page is mapped to, or -1. Safe to call without the writer's latch. */
+  auto Find(page_id_t page_id) const -> frame_id_t;
+
+  /** Map the page to the frame, replacing an existing mapping of the page. */
+  void Insert(page_id_t page_id, frame_id_t frame_id);
+
+  /** Remove the mapping of the page, if any. */
+  void Erase(page_id_t page_id);
+
+  /** @return all mapped page ids */
+  auto GetPageIds() const -> std::vector<page_id_t>;
+
+ private:
+  static constexpr uint64_t EMPTY = ~static_cast<uint64_t>(0);
+
+  static auto MakeEntry(page_id_t page_id, frame_id_t frame_id) -> uint64_t {
+    return static_cast<uint64_t>(static_cast<uint32_t>(page_id)) << 32 | static_cast<uint32_t>(frame_id);
+  }
+  static auto PageOf(uint64_t entry) -> page_id_t { return static_cast<page_id_t>(entry >> 32); }
+  static auto FrameOf(uint64_t entry) -> frame_id_t { return static_cast<frame_id_t>(entry & 0xFFFFFFFF); }
+  /** @return the first slot probed for the page */
+  auto Home(page_id_t page_id) const -> size_t {
+    // Fibonacci hashing spreads the sequential page ids of a table heap over the whole array
+    return (static_cast<uint64_t>(static_cast<uint32_t>(page_id)) * 0x9E3779B97F4A7C15ULL) >> shift_;
+  }
+
+  std::vector<std::atomic<uint64_t>> slots_;
+  size_t mask_;
+  size_t shift_;
+};
+
+}  // namespace bustub
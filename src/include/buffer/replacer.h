@@ -12,12 +12,28 @@
 
 #pragma once
 
+#include <atomic>
+#include <vector>
+
 #include "common/config.h"
 
 namespace bustub {
 
 /**
- * Replacer is an abstract class that tracks page usage.
+ * How a page is accessed. Scan marks accesses of sequential scans, which should not make a page look hot. Index marks
+ * pages of index structures, like inner nodes, directories and header pages, that are worth keeping resident over
+ * data pages because every lookup goes through them.
+ */
+enum class AccessType { Unknown = 0, Get, Scan, Index };
+
+/** The replacement policies a BufferPoolManager can be built with. */
+enum class ReplacerPolicy { LRUK = 0, LRU, Clock, ARC };
+
+/**
+ * Replacer is an abstract class that tracks frame usage and picks the frames the buffer pool evicts.
+ *
+ * A frame is tracked from its first recorded access, which also makes it evictable, until it is evicted or
+ * removed. Only evictable frames count towards Size() and can be picked as victims.
  */
 class Replacer {
  public:
@@ -26,25 +42,80 @@ class Replacer {
 
   /**
    * Remove the victim frame as defined by the replacement policy.
-   * @param[out] frame_id id of frame that was removed, nullptr if no victim was found
+   * @param[out] frame_id id of frame that was removed
    * @return true if a victim frame was found, false otherwise
    */
-  virtual auto Victim(frame_id_t *frame_id) -> bool = 0;
+  virtual auto Evict(frame_id_t *frame_id) -> bool = 0;
+
+  /**
+   * Record an access to a frame, and start tracking the frame if it is not tracked yet.
+   * @param frame_id the id of the accessed frame
+   * @param access_type the kind of access, policies may give scans less weight
+   * @param page_id the page held by the frame, for policies that remember evicted pages
+   */
+  void RecordAccess(frame_id_t frame_id, AccessType access_type = AccessType::Unknown,
+                    page_id_t page_id = INVALID_PAGE_ID) {
+    RecordFrameAccess(frame_id, access_type, page_id);
+  }
+
+  /**
+   * Track a frame again that Evict just returned but the caller could not evict after all, e.g. because its page was
+   * pinned concurrently. Unlike RecordAccess this is not an access: policies that remember evicted pages forget the
+   * eviction instead of treating the page as recently evicted and loaded again. The frame is evictable afterwards.
+   * @param frame_id the id of the frame Evict returned
+   * @param page_id the page still held by the frame
+   */
+  virtual void Restore(frame_id_t frame_id, page_id_t page_id) {
+    RecordFrameAccess(frame_id, AccessType::Unknown, page_id);
+  }
 
   /**
-   * Pins a frame, indicating that it should not be victimized until it is unpinned.
-   * @param frame_id the id of the frame to pin
+   * Mark a tracked frame as evictable or not, e.g. when the page in it is unpinned or pinned.
+   * @param frame_id the id of the frame
+   * @param set_evictable whether the frame may be evicted
    */
-  virtual void Pin(frame_id_t frame_id) = 0;
+  virtual void SetEvictable(frame_id_t frame_id, bool set_evictable) = 0;
 
   /**
-   * Unpins a frame, indicating that it can now be victimized.
-   * @param frame_id the id of the frame to unpin
+   * Stop tracking an evictable frame, e.g. because its page was deleted. Untracked frames are ignored.
+   * @param frame_id the id of the frame
    */
-  virtual void Unpin(frame_id_t frame_id) = 0;
+  virtual void Remove(frame_id_t frame_id) = 0;
+
+  /**
+   * Peek at the evictable frames in the order Evict would pick them, without evicting anything.
+   * @param max_frames the maximum number of frames to return
+   * @return up to max_frames evictable frame ids, the next victim first
+   */
+  virtual auto EvictionCandidates(size_t max_frames) -> std::vector<frame_id_t> = 0;
 
   /** @return the number of elements in the replacer that can be victimized */
   virtual auto Size() -> size_t = 0;
+
+  /**
+   * Tell the replacer that only the frames [0, num_frames) are in use from now on, e.g. after the buffer pool was
+   * resized. The replacer is still built for its maximum number of frames, but policies that size something by the
+   * number of frames, like the LRU-K scan ring, follow this instead. When shrinking, the buffer pool calls this only
+   * once the frames beyond were removed.
+   */
+  virtual void SetNumFrames(size_t /* num_frames */) {}
+
+  /** @return the number of Evict calls so far */
+  auto GetEvictCalls() const -> size_t { return evict_calls_.load(std::memory_order_relaxed); }
+
+  /**
+   * @return the number of frames Evict looked at to find its victims so far, over all calls. Divided by
+   * GetEvictCalls this is the average scan length of the policy.
+   */
+  auto GetEvictScanLength() const -> size_t { return evict_scan_length_.load(std::memory_order_relaxed); }
+
+ protected:
+  /** Policy-specific part of RecordAccess, kept separate so the public defaults live in one place. */
+  virtual void RecordFrameAccess(frame_id_t frame_id, AccessType access_type, page_id_t page_id) = 0;
+
+  /** Counters behind GetEvictCalls and GetEvictScanLength, bumped by the Evict implementations. */
+  std::atomic<size_t> evict_calls_{0};
+  std::atomic<size_t> evict_scan_length_{0};
 };
 
 }  // namespace bustub
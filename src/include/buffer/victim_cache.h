@@ -0,0 +1,98 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// victim_cache.h
+//
+// Identification: src/include/buffer/victim_cache.h
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <list>
+#include <mutex>  // NOLINT
+#include <string>
+#include <unordered_map>
+
+#include "common/config.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+/**
+ * VictimCache is a second tier behind the buffer pool. It keeps compressed copies of pages evicted from the pool, so
+ * that a page fetched again soon after is decompressed instead of read from disk. The copies take up to a byte
+ * budget, the oldest ones are dropped to make room for new ones. Pages that do not compress are kept as they are.
+ *
+ * A page is either in the pool or in the cache, never in both: Take hands the copy back to the pool and forgets it.
+ * The cache therefore only ever holds pages as they are on disk, as long as the pool keeps evicted dirty pages away
+ * until they are written back, and erases the pages it deletes.
+ */
+class VictimCache {
+ public:
+  /**
+   * @brief Create a victim cache.
+   * @param budget the number of bytes the copies may take, 0 disables the cache
+   */
+  explicit VictimCache(size_t budget = 0);
+
+  DISALLOW_COPY_AND_MOVE(VictimCache);
+
+  /** @return true if the budget is not 0 */
+  auto IsEnabled() const -> bool { return budget_.load(std::memory_order_relaxed) != 0; }
+
+  /** @brief Change the byte budget, dropping the oldest copies if they take more than that now. */
+  void SetBudget(size_t budget);
+
+  /**
+   * @brief Keep a copy of a page that is being evicted from the pool.
+   * @param page_id the id of the page
+   * @param data the BUSTUB_PAGE_SIZE bytes of the page
+   */
+  void Insert(page_id_t page_id, const char *data);
+
+  /**
+   * @brief Copy a page out of the cache and forget it.
+   * @param page_id the id of the page
+   * @param[out] data the BUSTUB_PAGE_SIZE bytes of the page
+   * @return false if the page is not in the cache
+   */
+  auto Take(page_id_t page_id, char *data) -> bool;
+
+  /** @brief Forget the copy of a page, if any. */
+  void Erase(page_id_t page_id);
+
+  /** @return the number of pages in the cache */
+  auto GetNumPages() -> size_t;
+
+  /** @return the number of bytes the copies take */
+  auto GetSize() -> size_t;
+
+ private:
+  struct Entry {
+    /** The compressed page, or the page itself if it did not compress. */
+    std::string data_;
+    bool is_compressed_{false};
+    /** Position in fifo_. */
+    std::list<page_id_t>::iterator pos_;
+  };
+
+  /** Drop the oldest copies until the rest fits into the budget. Caller holds latch_. */
+  void Shrink(size_t budget);
+  /** Forget an entry and return it. Caller holds latch_. */
+  auto Drop(std::unordered_map<page_id_t, Entry>::iterator it) -> Entry;
+
+  std::atomic<size_t> budget_;
+  /** Bytes taken by the copies. */
+  size_t size_{0};
+  /** Cached pages, most recently inserted in front. */
+  std::list<page_id_t> fifo_;
+  std::unordered_map<page_id_t, Entry> entries_;
+  std::mutex latch_;
+};
+
+}  // namespace bustub
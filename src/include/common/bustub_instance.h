@@ -218,10 +218,23 @@ class BustubInstance {
   auto MakeExecutorContext(Transaction *txn, bool is_modify) -> std::unique_ptr<ExecutorContext>;
 
  public:
-  explicit BustubInstance(const std::string &db_file_name);
+  /**
+   * @param db_file_name the database file
+   * @param use_direct_io bypass the kernel's page cache for the database file, see DiskManager
+   */
+  explicit BustubInstance(const std::string &db_file_name, bool use_direct_io = false);
 
+  /** Create an instance backed by an in-memory disk. */
   BustubInstance();
 
+  /**
+   * @param disk_manager the disk to store the database on, e.g. a DiskManagerSimulated. The instance takes ownership.
+   * With a DiskManagerSnapshot the instance is read-only, only queries are accepted. The catalog is not stored in the
+   * database file, so a read-only instance has no tables but the mock tables: it is meant for queries on those and for
+   * reading the pages of the snapshot through the buffer pool.
+   */
+  explicit BustubInstance(DiskManager *disk_manager);
+
   ~BustubInstance();
 
   /**
@@ -279,6 +292,7 @@ class BustubInstance {
   void CmdDisplayTables(ResultWriter &writer);
   void CmdDisplayIndices(ResultWriter &writer);
   void CmdDisplayHelp(ResultWriter &writer);
+  void CmdDisplayBufferPoolStats(ResultWriter &writer);
   void WriteOneCell(const std::string &cell, ResultWriter &writer);
 
   void HandleCreateStatement(Transaction *txn, const CreateStatement &stmt, ResultWriter &writer);
@@ -27,15 +27,37 @@ extern std::atomic<bool> enable_logging;
 /** If ENABLE_LOGGING is true, the log should be flushed to disk every LOG_TIMEOUT. */
 extern std::chrono::duration<int64_t> log_timeout;
 
+/** The buffer pool page cleaner checks the share of dirty frames every PAGE_CLEANER_INTERVAL milliseconds. */
+extern std::chrono::milliseconds page_cleaner_interval;
+
+/** Shrinking the buffer pool gives up if pinned pages keep it from retiring frames for RESIZE_TIMEOUT. */
+extern std::chrono::milliseconds resize_timeout;
+
 static constexpr int INVALID_PAGE_ID = -1;                                           // invalid page id
 static constexpr int INVALID_TXN_ID = -1;                                            // invalid transaction id
 static constexpr int INVALID_LSN = -1;                                               // invalid log sequence number
 static constexpr int HEADER_PAGE_ID = 0;                                             // the header page id
 static constexpr int BUSTUB_PAGE_SIZE = 4096;                                        // size of a data page in byte
 static constexpr int BUFFER_POOL_SIZE = 10;                                          // size of buffer pool
+static constexpr int BUFFER_POOL_MAX_SIZE = 4096;  // largest pool `SET buffer_pool_size` grows an instance to
 static constexpr int LOG_BUFFER_SIZE = ((BUFFER_POOL_SIZE + 1) * BUSTUB_PAGE_SIZE);  // size of a log buffer in byte
 static constexpr int BUCKET_SIZE = 50;                                               // size of extendible hash bucket
 static constexpr int LRUK_REPLACER_K = 10;  // lookback window for lru-k replacer
+static constexpr int LRUK_SCAN_RING_RATIO = 4;  // up to 1/n of the frames may hold pages only touched by scans
+static constexpr int LRUK_INDEX_RESIDENCY_RATIO = 4;  // up to 1/n of the frames may keep index pages over data pages
+static constexpr double PAGE_CLEANER_HIGH_WATERMARK = 0.5;  // dirty frame share that wakes the page cleaner up
+static constexpr double PAGE_CLEANER_LOW_WATERMARK = 0.25;  // dirty frame share the page cleaner cleans down to
+static constexpr int PAGE_CLEANER_BATCH_SIZE = 16;          // frames the page cleaner inspects per shard and round
+static constexpr int READ_AHEAD_WINDOW = 4;                  // pages a sequential scan keeps reading ahead
+static constexpr int READ_AHEAD_QUEUE_SIZE = 32;             // pending read-ahead requests before new ones are dropped
+static constexpr int DISK_SCHEDULER_QUEUE_DEPTH = 64;        // I/Os the disk scheduler keeps in flight via io_uring
+static constexpr int DISK_SCHEDULER_WORKERS = 8;             // threads serving the disk scheduler without io_uring
+static constexpr int FLUSH_BATCH_SIZE = 256;                 // dirty pages FlushAllPages pins and writes back at once
+static constexpr int EXTENT_SIZE = 64;                       // consecutive page ids a table heap reserves at once
+static constexpr int SCRUB_BATCH_SIZE = 32;                  // pages the checksum scrubber reads at once
+static constexpr int SIMULATED_DEVICE_CAPACITY = 1 << 22;     // pages a simulated disk holds by default (16 GB)
+static constexpr int CACHE_LINE_SIZE = 64;                    // frame metadata is padded to this size
+static constexpr int FRAME_ARENA_ALIGNMENT = 2 * 1024 * 1024;  // frame data is aligned to a 2 MB huge page
 
 using frame_id_t = int32_t;    // frame id type
 using page_id_t = int32_t;     // page id type
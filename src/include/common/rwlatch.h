@@ -12,8 +12,11 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <mutex>  // NOLINT
 #include <shared_mutex>
+#include <thread>  // NOLINT
 
 #include "common/macros.h"
 
@@ -21,18 +24,30 @@ namespace bustub {
 
 /**
  * Reader-Writer latch backed by std::mutex.
+ *
+ * The latch also keeps a version counter that writers bump when they acquire and when they release the latch, so it
+ * is odd while a writer holds it. Optimistic readers never touch the mutex: they remember the version, read, and then
+ * check that the version did not change in between.
  */
 class ReaderWriterLatch {
  public:
   /**
    * Acquire a write latch.
    */
-  void WLock() { mutex_.lock(); }
+  void WLock() {
+    mutex_.lock();
+    version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    // order the odd version before the writes it protects
+    std::atomic_thread_fence(std::memory_order_release);
+  }
 
   /**
    * Release a write latch.
    */
-  void WUnlock() { mutex_.unlock(); }
+  void WUnlock() {
+    version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    mutex_.unlock();
+  }
 
   /**
    * Acquire a read latch.
@@ -44,8 +59,32 @@ class ReaderWriterLatch {
    */
   void RUnlock() { mutex_.unlock_shared(); }
 
+  /**
+   * Start an optimistic read, waiting for a writer that currently holds the latch.
+   * @return the version to pass to OptimisticValidate once the read is done
+   */
+  auto OptimisticRLock() const -> uint64_t {
+    auto version = version_.load(std::memory_order_acquire);
+    while ((version & 1) != 0) {
+      std::this_thread::yield();
+      version = version_.load(std::memory_order_acquire);
+    }
+    return version;
+  }
+
+  /**
+   * @return true if no writer acquired the latch since OptimisticRLock returned version, i.e. what was read in
+   * between is consistent
+   */
+  auto OptimisticValidate(uint64_t version) const -> bool {
+    // order the reads of the protected data before the version check
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return version_.load(std::memory_order_relaxed) == version;
+  }
+
  private:
   std::shared_mutex mutex_;
+  std::atomic<uint64_t> version_{0};
 };
 
 }  // namespace bustub
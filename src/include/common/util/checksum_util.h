@@ -0,0 +1,38 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// checksum_util.h
+//
+// Identification: src/include/common/util/checksum_util.h
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bustub {
+
+/**
+ * ChecksumUtil computes CRC32C (Castagnoli) checksums, the polynomial the SSE4.2 crc32 instruction implements. On
+ * CPUs with SSE4.2 a page is checksummed at several GB/s, elsewhere a table-driven implementation gives the same
+ * results.
+ */
+class ChecksumUtil {
+ public:
+  /**
+   * @brief Extend the CRC32C of some data by size bytes of data.
+   * @param crc the checksum of the data before, 0 to start a new checksum
+   * @return the checksum of the data before followed by these bytes, e.g. 0xE3069283 for "123456789"
+   */
+  static auto Crc32c(const char *data, size_t size, uint32_t crc = 0) -> uint32_t;
+
+  /** @return true if Crc32c uses the SSE4.2 instruction */
+  static auto IsHardwareAccelerated() -> bool;
+};
+
+}  // namespace bustub
@@ -0,0 +1,43 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// compression_util.h
+//
+// Identification: src/include/common/util/compression_util.h
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace bustub {
+
+/**
+ * CompressionUtil is a small LZ77 compressor in the spirit of LZ4, fast enough to run on every buffer pool eviction.
+ *
+ * The output is a sequence of (literals, match) pairs. Each pair starts with a token byte, whose high nibble is the
+ * number of literals and whose low nibble is the match length minus 4, the shortest match. A nibble of 15 is
+ * continued by bytes that are added to it, up to and including the first one below 255. The literals follow, then
+ * the match as a 2-byte little-endian offset back into the output. The last pair has literals only.
+ */
+class CompressionUtil {
+ public:
+  /**
+   * @brief Compress src_size bytes of src into dst.
+   * @return false if the data does not compress, dst holds garbage then
+   */
+  static auto Compress(const char *src, size_t src_size, std::string *dst) -> bool;
+
+  /**
+   * @brief Decompress the output of Compress into exactly dst_size bytes of dst.
+   * @return false if the input is corrupt or does not decompress to dst_size bytes
+   */
+  static auto Decompress(const char *src, size_t src_size, char *dst, size_t dst_size) -> bool;
+};
+
+}  // namespace bustub
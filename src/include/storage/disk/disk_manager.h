@@ -13,10 +13,15 @@
 #pragma once
 
 #include <atomic>
+#include <condition_variable>  // NOLINT
+#include <cstdint>
 #include <fstream>
 #include <future>  // NOLINT
 #include <mutex>   // NOLINT
 #include <string>
+#include <thread>  // NOLINT
+#include <unordered_set>
+#include <vector>
 
 #include "common/config.h"
 
@@ -25,19 +30,36 @@ namespace bustub {
 /**
  * DiskManager takes care of the allocation and deallocation of pages within a database. It performs the reading and
  * writing of pages to and from disk, providing a logical file layer within the context of a database management system.
+ *
+ * Pages are accessed with positional reads and writes on a file descriptor, and the file size is tracked in memory, so
+ * concurrent page I/O neither serializes on a latch nor pays for a stat() per read.
+ *
+ * Every page written to the database file is checksummed with CRC32C, and every page read back is verified against
+ * its checksum, so that a torn or corrupted page is reported instead of being handed to the page layouts above. The
+ * checksums live in a side file next to the database file, one 4-byte entry per page id, since the page formats have
+ * no room for them. A page without a checksum, e.g. one written before the side file existed, is not verified. A
+ * background scrubber can verify the whole database file at a bounded bandwidth, see StartScrubber.
+ *
+ * Writes of the same page are serialized together with recording their checksums, so the recorded checksum is the one
+ * of the page last written. The side file is only trusted after a clean shutdown: after a crash, a page may have been
+ * written without its checksum, and a mismatch fails the read only once the page was written again.
  */
 class DiskManager {
+  friend class DiskScheduler;
+
  public:
   /**
    * Creates a new disk manager that writes to the specified database file.
    * @param db_file the file name of the database file to write to
+   * @param use_direct_io open the database file with O_DIRECT, so that its pages are cached by the buffer pool only
+   * instead of also by the kernel. Falls back to buffered I/O if the file system does not support it.
    */
-  explicit DiskManager(const std::string &db_file);
+  explicit DiskManager(const std::string &db_file, bool use_direct_io = false);
 
   /** FOR TEST / LEADERBOARD ONLY, used by DiskManagerMemory */
   DiskManager() = default;
 
-  virtual ~DiskManager() = default;
+  virtual ~DiskManager();
 
   /**
    * Shut down the disk manager and close all the file resources.
@@ -48,15 +70,27 @@ class DiskManager {
    * Write a page to the database file.
    * @param page_id id of the page
    * @param page_data raw page data
+   * @return false on an I/O error
    */
-  virtual void WritePage(page_id_t page_id, const char *page_data);
+  virtual auto WritePage(page_id_t page_id, const char *page_data) -> bool;
+
+  /**
+   * Write a batch of pages to the database file and sync it once at the end. The pages are copied back to back into
+   * one buffer first, and every run of consecutive page ids is written from it with a single pwrite, so a batch of
+   * neighbouring pages goes out at sequential bandwidth.
+   * @param page_ids ids of the pages, in ascending order
+   * @param page_data raw page data, one per page id
+   * @return false on an I/O error or if the copy cannot be allocated, some of the pages may not have been written then
+   */
+  auto WritePages(const std::vector<page_id_t> &page_ids, const std::vector<const char *> &page_data) -> bool;
 
   /**
    * Read a page from the database file.
    * @param page_id id of the page
-   * @param[out] page_data output buffer
+   * @param[out] page_data output buffer, pages beyond the end of the file read as zeros
+   * @return false on an I/O error, or if the page does not match its checksum
    */
-  virtual void ReadPage(page_id_t page_id, char *page_data);
+  virtual auto ReadPage(page_id_t page_id, char *page_data) -> bool;
 
   /**
    * Flush the entire log buffer into disk.
@@ -83,6 +117,63 @@ class DiskManager {
   /** @return the number of disk writes */
   auto GetNumWrites() const -> int;
 
+  /**
+   * Start verifying the checksums of all pages in the database file in the background, one pass over the file after
+   * the other, so that corruption of pages that are rarely read is found early. Does nothing if there is no database
+   * file or the scrubber is running already.
+   * @param bytes_per_second the bandwidth the scrubber reads the database file at, at most
+   */
+  void StartScrubber(size_t bytes_per_second);
+
+  /** Stop the background scrubber, if it is running. */
+  void StopScrubber();
+
+  /** @return the number of pages read whose data did not match their checksum */
+  auto GetNumChecksumFailures() const -> size_t { return num_checksum_failures_; }
+
+  /** @return the number of pages the scrubber verified */
+  auto GetNumScrubbedPages() const -> size_t { return num_scrubbed_pages_; }
+
+  /** @return the number of complete passes of the scrubber over the database file */
+  auto GetNumScrubPasses() const -> size_t { return num_scrub_passes_; }
+
+  /** @return true if the database file bypasses the kernel's page cache */
+  auto IsUsingDirectIo() const -> bool { return use_direct_io_; }
+
+  /**
+   * @return the database file mapped into memory if it is opened as a read-only snapshot, see DiskManagerSnapshot,
+   * nullptr otherwise
+   */
+  auto GetMappedData() const -> const char * { return mapped_data_; }
+
+  /**
+   * Verify a page of the mapped snapshot against its checksum, see GetMappedData.
+   * @param page_id id of the page, it has to be within the mapping
+   * @return false if the page is corrupt
+   */
+  auto VerifyMappedPage(page_id_t page_id) -> bool;
+
+  /** @return the size of the database file in bytes, or -1 if there is no database file */
+  auto GetDbFileSize() const -> int64_t;
+
+  /**
+   * @return the side file in which the buffer pool remembers its resident pages across restarts, or an empty string
+   * if there is no database file. It is deleted whenever the database file is created anew.
+   */
+  auto GetWarmFileName() const -> const std::string & { return warm_name_; }
+
+  /**
+   * @return the side file in which the free-space map of the database file is kept, or an empty string if there is
+   * no database file. It is deleted whenever the database file is created anew.
+   */
+  auto GetFreeSpaceMapFileName() const -> const std::string & { return fsm_name_; }
+
+  /**
+   * @return the side file in which the checksums of the pages are kept, or an empty string if there is no database
+   * file. It is deleted whenever the database file is created anew.
+   */
+  auto GetChecksumFileName() const -> const std::string & { return crc_name_; }
+
   /**
    * Sets the future which is used to check for non-blocking flushes.
    * @param f the non-blocking flush check
@@ -94,18 +185,97 @@ class DiskManager {
 
  protected:
   auto GetFileSize(const std::string &file_name) -> int;
+  /** Record that the db file now reaches at least end bytes. */
+  void GrowDbFileSize(int64_t end);
+  /** @return the CRC32C of a page */
+  static auto PageChecksum(const char *page_data) -> uint32_t;
+  /**
+   * Write pages to the database file, without touching their checksums.
+   * @param first_page_id the id of the first page
+   * @param data the pages back to back, aligned for direct I/O
+   * @param num_pages the number of consecutive pages to write
+   * @return false on an I/O error
+   */
+  auto WriteData(page_id_t first_page_id, const char *data, size_t num_pages) -> bool;
+  /** Wait until no other write of a page is in flight, then start one. Has to be followed by EndWrite. */
+  void BeginWrite(page_id_t page_id);
+  /** Like BeginWrite, but fails instead of waiting. @return false if another write of the page is in flight */
+  auto TryBeginWrite(page_id_t page_id) -> bool;
+  /**
+   * Finish a write started by BeginWrite, and record the checksum of the page.
+   * @param is_written whether the page was written, it has no known checksum otherwise
+   * @param crc the checksum of the bytes written
+   * @return false if the page was not written or its checksum could not be recorded
+   */
+  auto EndWrite(page_id_t page_id, bool is_written, uint32_t crc) -> bool;
+  /**
+   * Check a page that was just read from the database file against its checksum, logging and counting a mismatch.
+   * @return false if the page is corrupt
+   */
+  auto VerifyChecksum(page_id_t page_id, const char *page_data) -> bool;
+  /**
+   * Read the checksums of the database file from crc_name_. Opened for writing, the checksum file is created if there
+   * is none and marked unclean until CloseChecksumFile.
+   * @param is_read_only only load the checksums, and leave the file as it is
+   */
+  void OpenChecksumFile(bool is_read_only);
   // stream to write log file
   std::fstream log_io_;
   std::string log_name_;
-  // stream to write db file
-  std::fstream db_io_;
+  // descriptor of the db file, -1 if there is none or it was shut down
+  int db_fd_{-1};
+  // the db file is opened with O_DIRECT, page transfers need BUSTUB_PAGE_SIZE aligned buffers
+  bool use_direct_io_{false};
   std::string file_name_;
+  std::string warm_name_;
+  std::string fsm_name_;
+  std::string crc_name_;
   int num_flushes_{0};
-  int num_writes_{0};
+  std::atomic<int> num_writes_{0};
   bool flush_log_{false};
   std::future<void> *flush_log_f_{nullptr};
-  // With multiple buffer pool instances, need to protect file access
-  std::mutex db_io_latch_;
+  // size of the db file, grown by WritePage so that reads do not have to ask the file system
+  std::atomic<int64_t> db_file_size_{-1};
+  // the db file mapped read-only, nullptr unless the disk manager serves a snapshot
+  const char *mapped_data_{nullptr};
+
+ private:
+  /** The checksum of a page. */
+  struct Checksum {
+    uint32_t crc_{0};
+    // false if the page has no checksum
+    bool is_set_{false};
+    // false if the checksum was loaded after an unclean shutdown and may be stale, a mismatch is only reported then
+    bool is_trusted_{false};
+  };
+
+  /** @return the stored checksum of a page */
+  auto GetChecksum(page_id_t page_id) -> Checksum;
+  /** Sync the database and the checksum file, then mark the checksum file clean and close it. */
+  void CloseChecksumFile();
+  /** The body of the scrubber thread. */
+  void RunScrubber(size_t bytes_per_second);
+
+  // descriptor of the checksum file, -1 if there is none
+  int crc_fd_{-1};
+  // protects checksums_, which holds the CRC32C of every page written, and writes_in_flight_
+  std::mutex checksum_latch_;
+  std::vector<Checksum> checksums_;
+  // the pages being written between BeginWrite and EndWrite
+  std::unordered_set<page_id_t> writes_in_flight_;
+  // signaled when a write ends
+  std::condition_variable write_cv_;
+  // a checksum could not be written, the checksum file must not be marked clean
+  std::atomic<bool> is_checksum_file_stale_{false};
+  std::atomic<size_t> num_checksum_failures_{0};
+
+  std::thread *scrubber_{nullptr};
+  // protects scrubber_stop_ and wakes the scrubber up to stop it
+  std::mutex scrubber_latch_;
+  std::condition_variable scrubber_cv_;
+  bool scrubber_stop_{false};
+  std::atomic<size_t> num_scrubbed_pages_{0};
+  std::atomic<size_t> num_scrub_passes_{0};
 };
 
 }  // namespace bustub
@@ -44,14 +44,14 @@ class DiskManagerMemory : public DiskManager {
    * @param page_id id of the page
    * @param page_data raw page data
    */
-  void WritePage(page_id_t page_id, const char *page_data) override;
+  auto WritePage(page_id_t page_id, const char *page_data) -> bool override;
 
   /**
    * Read a page from the database file.
    * @param page_id id of the page
    * @param[out] page_data output buffer
    */
-  void ReadPage(page_id_t page_id, char *page_data) override;
+  auto ReadPage(page_id_t page_id, char *page_data) -> bool override;
 
  private:
   char *memory_;
@@ -70,7 +70,7 @@ class DiskManagerUnlimitedMemory : public DiskManager {
    * @param page_id id of the page
    * @param page_data raw page data
    */
-  void WritePage(page_id_t page_id, const char *page_data) override {
+  auto WritePage(page_id_t page_id, const char *page_data) -> bool override {
     if (latency_ > 0) {
       std::this_thread::sleep_for(std::chrono::milliseconds(latency_));
     }
@@ -87,6 +87,7 @@ class DiskManagerUnlimitedMemory : public DiskManager {
     l.unlock();
 
     memcpy(ptr->first.data(), page_data, BUSTUB_PAGE_SIZE);
+    return true;
   }
 
   /**
@@ -94,7 +95,7 @@ class DiskManagerUnlimitedMemory : public DiskManager {
    * @param page_id id of the page
    * @param[out] page_data output buffer
    */
-  void ReadPage(page_id_t page_id, char *page_data) override {
+  auto ReadPage(page_id_t page_id, char *page_data) -> bool override {
     if (latency_ > 0) {
       std::this_thread::sleep_for(std::chrono::milliseconds(latency_));
     }
@@ -102,17 +103,18 @@ class DiskManagerUnlimitedMemory : public DiskManager {
     std::unique_lock<std::mutex> l(mutex_);
     if (page_id >= static_cast<int>(data_.size()) || page_id < 0) {
       LOG_WARN("page not exist");
-      return;
+      return true;
     }
     if (data_[page_id] == nullptr) {
       LOG_WARN("page not exist");
-      return;
+      return true;
     }
     std::shared_ptr<ProtectedPage> ptr = data_[page_id];
     std::shared_lock<std::shared_mutex> l_page(ptr->second);
     l.unlock();
 
     memcpy(page_data, ptr->first.data(), BUSTUB_PAGE_SIZE);
+    return true;
   }
 
   void SetLatency(size_t latency_ms) { latency_ = latency_ms; }
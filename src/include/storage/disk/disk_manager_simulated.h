@@ -0,0 +1,170 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// disk_manager_simulated.h
+//
+// Identification: src/include/storage/disk/disk_manager_simulated.h
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <optional>
+#include <string>
+
+#include "common/config.h"
+#include "common/macros.h"
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+/**
+ * The timing behavior of a simulated storage device. All latencies are means in microseconds, zero disables the
+ * respective part of the model.
+ */
+struct DeviceProfile {
+  /** Time from submitting a page read until the device starts transferring it. */
+  uint64_t read_latency_us_{0};
+  /** Time from submitting a page write until the device starts accepting it. */
+  uint64_t write_latency_us_{0};
+  /** Extra latency of an access that does not continue where the previous one ended, e.g. a disk head seek. */
+  uint64_t seek_latency_us_{0};
+  /** Spread of the latencies, the sigma of a log-normal distribution around the mean. */
+  double latency_sigma_{0};
+  /** Probability that an I/O is stalled, e.g. by garbage collection inside an SSD. */
+  double stall_probability_{0};
+  /** Extra latency of a stalled I/O. */
+  uint64_t stall_latency_us_{0};
+  /** Transfer bandwidth shared by all I/Os in MB/s. */
+  uint64_t bandwidth_mb_s_{0};
+  /** I/Os the device works on at once, further ones wait for a slot. Zero means unbounded. */
+  size_t queue_depth_{0};
+
+  /** @return a device that completes every I/O instantly */
+  static auto Instant() -> DeviceProfile { return {}; }
+
+  /** @return a datacenter NVMe SSD */
+  static auto Nvme() -> DeviceProfile { return {80, 20, 0, 0.3, 0.001, 1000, 3000, 64}; }
+
+  /** @return a SATA SSD */
+  static auto Ssd() -> DeviceProfile { return {150, 60, 0, 0.4, 0.005, 5000, 500, 32}; }
+
+  /** @return a 7200 rpm hard disk, sequential accesses skip the seek */
+  static auto Hdd() -> DeviceProfile { return {4000, 4000, 8000, 0.5, 0, 0, 150, 1}; }
+
+  /** @return a device with a fixed latency per I/O, like DiskManagerUnlimitedMemory::SetLatency */
+  static auto FixedLatency(uint64_t latency_us) -> DeviceProfile {
+    DeviceProfile profile;
+    profile.read_latency_us_ = latency_us;
+    profile.write_latency_us_ = latency_us;
+    return profile;
+  }
+
+  /** @return the profile with the given name: instant, nvme, ssd or hdd, std::nullopt for anything else */
+  static auto FromName(const std::string &name) -> std::optional<DeviceProfile>;
+};
+
+/**
+ * DiskManagerSimulated keeps the database in memory and delays every page I/O the way a storage device would, so that
+ * benchmarks of I/O scheduling give reproducible results without a real disk.
+ *
+ * Each I/O waits for a slot in the device queue, then for its sampled latency, and then for its turn on the transfer
+ * bandwidth it shares with all other I/Os. Latencies are drawn from a pseudo-random sequence seeded at construction,
+ * the n-th I/O of a run always gets the same sample.
+ *
+ * Pages are stored sparsely in chunks of FRAME_ARENA_ALIGNMENT bytes that are mapped on the first write and backed by
+ * transparent huge pages where the OS supports them. Only the chunk directory is allocated up front, so the device can
+ * hold a multi-GB dataset while memory is only spent on the pages actually written. Pages that were never written
+ * read as zeros, pages beyond the capacity can be neither read nor written.
+ */
+class DiskManagerSimulated : public DiskManager {
+ public:
+  /**
+   * @param profile the timing of the device, see SetProfile
+   * @param capacity_pages the number of pages the device can hold
+   * @param seed the seed of the latency samples
+   */
+  explicit DiskManagerSimulated(const DeviceProfile &profile = DeviceProfile::Instant(),
+                                size_t capacity_pages = SIMULATED_DEVICE_CAPACITY, uint64_t seed = 0);
+
+  DISALLOW_COPY_AND_MOVE(DiskManagerSimulated);
+
+  ~DiskManagerSimulated() override;
+
+  /**
+   * Write a page to the device.
+   * @param page_id id of the page, below the capacity
+   * @param page_data raw page data
+   * @return false if page_id is beyond the capacity
+   */
+  auto WritePage(page_id_t page_id, const char *page_data) -> bool override;
+
+  /**
+   * Read a page from the device.
+   * @param page_id id of the page, below the capacity
+   * @param[out] page_data output buffer
+   * @return false if page_id is beyond the capacity
+   */
+  auto ReadPage(page_id_t page_id, char *page_data) -> bool override;
+
+  /** Change the timing of the device, e.g. to load a dataset instantly before a benchmark starts. */
+  void SetProfile(const DeviceProfile &profile);
+
+  /** @return the number of page reads */
+  auto GetNumReads() const -> int { return num_reads_; }
+
+  /** @return the bytes of memory mapped for written pages */
+  auto GetMemoryUsage() const -> size_t { return num_chunks_ * FRAME_ARENA_ALIGNMENT; }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  /** @return the data of a page, nullptr if its chunk was never written. Maps the chunk if create is set. */
+  auto GetPageData(page_id_t page_id, bool create) -> char *;
+
+  /**
+   * Take a slot in the device queue, blocking while it is full.
+   * @return the time at which the I/O of the page completes
+   */
+  auto BeginIo(page_id_t page_id, bool is_write) -> Clock::time_point;
+
+  /** Give the queue slot of a completed I/O back. */
+  void EndIo();
+
+  /** Block until the given time, with microsecond precision. */
+  static void WaitUntil(Clock::time_point done);
+
+  /** @return the latency of the seq-th I/O in microseconds */
+  auto SampleLatency(uint64_t seq, uint64_t mean_us, bool is_seek) const -> double;
+
+  size_t capacity_pages_;
+  uint64_t seed_;
+  /** One entry per chunk of FRAME_ARENA_ALIGNMENT bytes. */
+  std::unique_ptr<std::atomic<char *>[]> chunks_;
+  size_t num_directory_entries_;
+  std::atomic<size_t> num_chunks_{0};
+
+  /** Protects the device state below. */
+  std::mutex latch_;
+  std::condition_variable queue_cv_;
+  DeviceProfile profile_;
+  size_t in_flight_{0};
+  /** The time at which the transfer bandwidth is available again. */
+  Clock::time_point bandwidth_free_at_;
+  /** The page after the one accessed last, an access to it needs no seek. */
+  page_id_t next_sequential_page_id_{INVALID_PAGE_ID};
+  uint64_t num_ios_{0};
+
+  std::atomic<int> num_reads_{0};
+};
+
+}  // namespace bustub
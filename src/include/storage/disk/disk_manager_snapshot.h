@@ -0,0 +1,63 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// disk_manager_snapshot.h
+//
+// Identification: src/include/storage/disk/disk_manager_snapshot.h
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <string>
+
+#include "common/config.h"
+#include "common/macros.h"
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+/**
+ * DiskManagerSnapshot opens an existing database file read-only and maps it into memory as a whole.
+ *
+ * A buffer pool on top of it does not copy pages into frames: it hands out guards that point straight into the
+ * mapping, see GetMappedData. Pages are then cached by the kernel only, and reading one costs no replacer bookkeeping.
+ * Nothing can be written, the file must not be modified by anyone while the snapshot is open. Pages are verified
+ * against the checksum file next to the database file, which is read once when the snapshot is opened.
+ */
+class DiskManagerSnapshot : public DiskManager {
+ public:
+  /**
+   * Map the database file.
+   * @param db_file the file name of the database file, it has to exist
+   */
+  explicit DiskManagerSnapshot(const std::string &db_file);
+
+  DISALLOW_COPY_AND_MOVE(DiskManagerSnapshot);
+
+  ~DiskManagerSnapshot() override;
+
+  /** Always fails, the snapshot is read-only. @return false */
+  auto WritePage(page_id_t page_id, const char *page_data) -> bool override;
+
+  /**
+   * Copy a page out of the mapping.
+   * @param page_id id of the page, pages beyond the end of the file read as zeros
+   * @param[out] page_data output buffer
+   * @return false if the page does not match its checksum
+   */
+  auto ReadPage(page_id_t page_id, char *page_data) -> bool override;
+
+  /** @return the number of pages in the database file */
+  auto GetNumPages() const -> page_id_t { return num_pages_; }
+
+ private:
+  /** Length of the mapping, at least one page even for an empty file. */
+  size_t mapped_size_{0};
+  page_id_t num_pages_{0};
+};
+
+}  // namespace bustub
@@ -0,0 +1,127 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// disk_scheduler.h
+//
+// Identification: src/include/storage/disk/disk_scheduler.h
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <future>  // NOLINT
+#include <memory>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "common/config.h"
+#include "common/macros.h"
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+class IoUring;
+
+/**
+ * @brief Represents a Write or Read request for the DiskManager to execute.
+ */
+struct DiskRequest {
+  /** Flag indicating whether the request is a write or a read. */
+  bool is_write_;
+
+  /**
+   * Pointer to the start of the memory location where a page is either:
+   *   1. being read into from disk (on a read).
+   *   2. being written out to disk (on a write).
+   */
+  char *data_;
+
+  /** ID of the page being read from / written to disk. */
+  page_id_t page_id_;
+
+  /** Callback used to signal to the request issuer when the request has been completed, false on an I/O error. */
+  std::promise<bool> callback_;
+};
+
+/**
+ * DiskScheduler takes page reads and writes off the caller's thread, so that a caller can keep many of them in flight
+ * at once and wait for their futures later.
+ *
+ * If the kernel supports io_uring and the disk manager has a database file, the requests are batched into an
+ * io_uring submission queue, with up to DISK_SCHEDULER_QUEUE_DEPTH of them in flight. Otherwise a pool of
+ * DISK_SCHEDULER_WORKERS threads hands them to the disk manager's ReadPage/WritePage. With a direct-I/O database file,
+ * requests for buffers that are not BUSTUB_PAGE_SIZE aligned are executed right away on the caller's thread instead.
+ * Either way, written pages are checksummed and read pages verified just like by the disk manager itself.
+ *
+ * Requests may complete in any order, except that writes of the same page are executed one after the other. A caller
+ * must not have a read and a write of the same page in flight at once.
+ */
+class DiskScheduler {
+ public:
+  /**
+   * @brief Start the scheduler's threads.
+   * @param disk_manager the disk manager executing the requests
+   * @param use_io_uring false to always use the thread pool
+   */
+  explicit DiskScheduler(DiskManager *disk_manager, bool use_io_uring = true);
+
+  /** @brief Finish the pending requests and stop the threads. */
+  ~DiskScheduler();
+
+  DISALLOW_COPY_AND_MOVE(DiskScheduler);
+
+  /**
+   * @brief Schedule a request for the DiskManager to execute.
+   * @param r the request to be scheduled, its callback is fulfilled once it completed
+   */
+  void Schedule(DiskRequest r);
+
+  /** @brief Schedule reading a page into data, which has to stay valid until the future is ready. */
+  auto ScheduleRead(page_id_t page_id, char *data) -> std::future<bool>;
+
+  /** @brief Schedule writing data to a page, data has to stay unchanged until the future is ready. */
+  auto ScheduleWrite(page_id_t page_id, char *data) -> std::future<bool>;
+
+  /** @return a promise to be put into a DiskRequest */
+  auto CreatePromise() -> std::promise<bool> { return {}; }
+
+  /** @return true if the requests go through io_uring rather than the thread pool */
+  auto IsUsingIoUring() const -> bool { return ring_ != nullptr; }
+
+ private:
+  /** @brief Body of the thread pool's threads, executes requests until the scheduler is destroyed. */
+  void RunWorker();
+
+  /** @brief Execute a request through the disk manager on the calling thread. */
+  void Execute(DiskRequest *r);
+
+  /** @brief Body of the submission thread, moves requests into the submission queue as slots free up. */
+  void RunSubmitter();
+
+  /** @brief Body of the completion thread, fulfills the callbacks of completed requests. */
+  void RunCompleter();
+
+  DiskManager *disk_manager_;
+  /** Requests that were not handed to a worker or the submission queue yet. */
+  std::deque<DiskRequest> queue_;
+  bool stop_{false};
+  std::mutex latch_;
+  std::condition_variable cv_;
+
+  /** The io_uring instance, nullptr if the thread pool is used. */
+  std::unique_ptr<IoUring> ring_;
+  /** Requests in the submission queue or in flight, protected by latch_. */
+  size_t num_in_flight_{0};
+  /** Signaled when requests complete and free their slots. */
+  std::condition_variable slot_cv_;
+
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace bustub
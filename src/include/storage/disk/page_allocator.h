@@ -0,0 +1,106 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_allocator.h
+//
+// Identification: src/include/storage/disk/page_allocator.h
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "common/config.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+/**
+ * PageAllocator hands out the page ids of a database file and takes deallocated ones back for reuse.
+ *
+ * The page ids [0, GetNumPages()) have been handed out at some point. A free-space bitmap over them marks the ones
+ * that were deallocated since, and Allocate recycles the lowest of those before growing the file. The bitmap can be
+ * saved to a side file and loaded again, so that freed pages are still reused after a restart.
+ *
+ * The saved bitmap must never mark a page free that is in use, or a restart after a crash would hand it out a second
+ * time. A page freed after the save only leaks until the next save, but a page recycled after the save is still free
+ * in the file. So before Allocate hands out the first recycled page after a Save or Load, it deletes the file. Until
+ * the next Save, a crash then loses the free pages, rather than corrupting live ones.
+ */
+class PageAllocator {
+ public:
+  PageAllocator() = default;
+
+  DISALLOW_COPY_AND_MOVE(PageAllocator);
+
+  /**
+   * @brief Restore the state written by Save.
+   * @param file_name the file written by Save
+   * @param num_pages_on_disk the number of pages in the database file. They are never handed out as new pages, even
+   * if the file is older than some of them.
+   * @return false if there is no valid file, all pages on disk count as allocated then
+   */
+  auto Load(const std::string &file_name, page_id_t num_pages_on_disk) -> bool;
+
+  /**
+   * @brief Write the state to a file, replacing it atomically.
+   * @return false on an I/O error, or if a page was recycled meanwhile. There is no file then.
+   */
+  auto Save(const std::string &file_name) -> bool;
+
+  /**
+   * @brief Hand out a page id, the lowest free one if there is any, otherwise one past the end of the file.
+   * @param[out] is_recycled whether the page was allocated and deallocated before, its old content may be on disk
+   * @return the page id
+   */
+  auto Allocate(bool *is_recycled) -> page_id_t;
+
+  /**
+   * @brief Hand out a run of consecutive page ids past the end of the file. Free ids are not considered, as they are
+   * rarely contiguous.
+   * @param num_pages the length of the run, at least 1
+   * @return the first page id of the run
+   */
+  auto AllocateExtent(page_id_t num_pages) -> page_id_t;
+
+  /**
+   * @brief Take back a page id returned by Allocate whose page was never used, e.g. because no frame was available.
+   * @param page_id the page id
+   * @param is_recycled what Allocate reported for it
+   */
+  void Unallocate(page_id_t page_id, bool is_recycled);
+
+  /** @brief Mark a page as free for reuse. Pages that are free already or were never allocated are ignored. */
+  void Deallocate(page_id_t page_id);
+
+  /** @return whether the page id was handed out and not deallocated since */
+  auto IsAllocated(page_id_t page_id) -> bool;
+
+  /** @return the number of page ids handed out so far, including the free ones */
+  auto GetNumPages() -> page_id_t;
+
+  /** @return the number of free page ids */
+  auto GetNumFreePages() -> size_t;
+
+ private:
+  /** One past the highest page id handed out so far. */
+  page_id_t num_pages_{0};
+  /** The free-space bitmap, one entry per page id below num_pages_. */
+  std::vector<bool> is_free_;
+  size_t num_free_{0};
+  /** No page below this one is free. */
+  page_id_t first_free_{0};
+  /** The file saved or loaded last, empty if it was deleted since or there is none. */
+  std::string file_name_;
+  /** The number of pages Allocate recycled, to tell whether the bitmap Save writes is still current. */
+  size_t num_recycled_{0};
+  std::mutex latch_;
+};
+
+}  // namespace bustub
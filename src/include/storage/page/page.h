@@ -12,6 +12,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>  // NOLINT
 #include <cstring>
 #include <iostream>
 
@@ -24,8 +26,10 @@ namespace bustub {
  * Page is the basic unit of storage within the database system. Page provides a wrapper for actual data pages being
  * held in main memory. Page also contains book-keeping information that is used by the buffer pool manager, e.g.
  * pin count, dirty flag, page id, etc.
+ *
+ * Pages are padded to a cache line, so the metadata of neighbouring frames in the buffer pool never share one.
  */
-class Page {
+class alignas(CACHE_LINE_SIZE) Page {
   // There is book-keeping information inside the page that should only be relevant to the buffer pool manager.
   friend class BufferPoolManager;
 
@@ -36,8 +40,19 @@ class Page {
     ResetMemory();
   }
 
+  /** Constructor for a page whose data lives elsewhere, e.g. in the frame arena of a buffer pool. Zeros it out. */
+  explicit Page(char *data) : data_(data), owns_data_(false) { ResetMemory(); }
+
+  /** Constructor for a page mapped read-only from the database file. The data is left as it is. */
+  Page(const char *data, page_id_t page_id)
+      : data_(const_cast<char *>(data)), owns_data_(false), is_read_only_(true), page_id_(page_id) {}
+
   /** Default destructor. */
-  ~Page() { delete[] data_; }
+  ~Page() {
+    if (owns_data_) {
+      delete[] data_;
+    }
+  }
 
   /** @return the actual data contained within this page */
   inline auto GetData() -> char * { return data_; }
@@ -46,7 +61,14 @@ class Page {
   inline auto GetPageId() -> page_id_t { return page_id_; }
 
   /** @return the pin count of this page */
-  inline auto GetPinCount() -> int { return pin_count_; }
+  inline auto GetPinCount() -> int {
+    // a negative count marks a frame the buffer pool is evicting or keeps in its free list
+    auto pin_count = pin_count_.load();
+    return pin_count < 0 ? 0 : pin_count;
+  }
+
+  /** @return true if the page is mapped read-only, writing to its data crashes then */
+  inline auto IsReadOnly() -> bool { return is_read_only_; }
 
   /** @return true if the page in memory has been modified from the page on disk, false otherwise */
   inline auto IsDirty() -> bool { return is_dirty_; }
@@ -63,6 +85,12 @@ class Page {
   /** Release the page read latch. */
   inline void RUnlatch() { rwlatch_.RUnlock(); }
 
+  /** Start an optimistic read of the page, see ReaderWriterLatch. @return the version to validate against */
+  inline auto OptimisticRLatch() -> uint64_t { return rwlatch_.OptimisticRLock(); }
+
+  /** @return true if the page was not write latched since OptimisticRLatch returned version */
+  inline auto OptimisticValidate(uint64_t version) -> bool { return rwlatch_.OptimisticValidate(version); }
+
   /** @return the page LSN. */
   inline auto GetLSN() -> lsn_t { return *reinterpret_cast<lsn_t *>(GetData() + OFFSET_LSN); }
 
@@ -85,12 +113,21 @@ class Page {
   // Usually this should be stored as `char data_[BUSTUB_PAGE_SIZE]{};`. But to enable ASAN to detect page overflow,
   // we store it as a ptr.
   char *data_;
+  /** True if data_ was allocated by this page. */
+  bool owns_data_ = true;
+  /** True if data_ points into a read-only mapping. */
+  bool is_read_only_ = false;
+  // The metadata below is atomic because buffer pool hits read and pin frames without holding any latch.
   /** The ID of this page. */
-  page_id_t page_id_ = INVALID_PAGE_ID;
+  std::atomic<page_id_t> page_id_{INVALID_PAGE_ID};
   /** The pin count of this page. */
-  int pin_count_ = 0;
+  std::atomic<int> pin_count_{0};
   /** True if the page is dirty, i.e. it is different from its corresponding page on disk. */
-  bool is_dirty_ = false;
+  std::atomic<bool> is_dirty_{false};
+  /** True while the buffer pool manager reads this page in or writes the previous page of the frame back. */
+  std::atomic<bool> io_in_progress_{false};
+  /** Notified when the in-flight I/O on this frame completes. Waits on it use the latch of the owning shard. */
+  std::condition_variable io_cv_;
   /** Page latch. */
   ReaderWriterLatch rwlatch_;
 };
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "common/exception.h"
 #include "storage/page/page.h"
 
 namespace bustub {
@@ -59,7 +60,8 @@ class BasicPageGuard {
    */
   ~BasicPageGuard();
 
-  auto PageId() -> page_id_t { return page_->GetPageId(); }
+  /** @return the id of the guarded page, INVALID_PAGE_ID if the guard holds no page, e.g. because the fetch failed */
+  auto PageId() -> page_id_t { return page_ == nullptr ? INVALID_PAGE_ID : page_->GetPageId(); }
 
   auto GetData() -> const char * { return page_->GetData(); }
 
@@ -68,7 +70,11 @@ class BasicPageGuard {
     return reinterpret_cast<const T *>(GetData());
   }
 
+  /** @return the data of the page for modifying it, throws if the page belongs to a read-only snapshot */
   auto GetDataMut() -> char * {
+    if (page_->IsReadOnly()) {
+      throw ExecutionException("can't modify a page of a read-only snapshot");
+    }
     is_dirty_ = true;
     return page_->GetData();
   }
@@ -81,6 +87,7 @@ class BasicPageGuard {
  private:
   friend class ReadPageGuard;
   friend class WritePageGuard;
+  friend class OptimisticReadPageGuard;
 
   [[maybe_unused]] BufferPoolManager *bpm_{nullptr};
   Page *page_{nullptr};
@@ -214,4 +221,49 @@ class WritePageGuard {
   BasicPageGuard guard_;
 };
 
+/**
+ * OptimisticReadPageGuard pins a page like BasicPageGuard, but instead of the read latch it only remembers the version
+ * of the page latch. Readers do not write to the latch, so hot pages read by many threads at once, like the upper
+ * levels of an index, do not bounce its cache line between cores.
+ *
+ * Writers may modify the page while it is being read. Whatever was read through the guard is only consistent if
+ * Validate() succeeds afterwards, otherwise it has to be read again after Restart(). Copy values out of the page and
+ * validate before acting on them, e.g. before following an offset read from the page.
+ */
+class OptimisticReadPageGuard {
+ public:
+  OptimisticReadPageGuard() = default;
+  OptimisticReadPageGuard(BufferPoolManager *bpm, Page *page);
+  OptimisticReadPageGuard(const OptimisticReadPageGuard &) = delete;
+  auto operator=(const OptimisticReadPageGuard &) -> OptimisticReadPageGuard & = delete;
+
+  OptimisticReadPageGuard(OptimisticReadPageGuard &&that) noexcept;
+  auto operator=(OptimisticReadPageGuard &&that) noexcept -> OptimisticReadPageGuard &;
+
+  /** @brief Unpin the page. There is no latch to release. */
+  void Drop();
+
+  ~OptimisticReadPageGuard();
+
+  /** @return true if no writer latched the page since the guard was created or last restarted */
+  auto Validate() -> bool;
+
+  /** @brief Wait until no writer holds the page latch and take a new version, to read the page again. */
+  void Restart();
+
+  auto PageId() -> page_id_t { return guard_.PageId(); }
+
+  auto GetData() -> const char * { return guard_.GetData(); }
+
+  template <class T>
+  auto As() -> const T * {
+    return guard_.As<T>();
+  }
+
+ private:
+  BasicPageGuard guard_;
+  /** Version of the page latch the reads are validated against. */
+  uint64_t version_{0};
+};
+
 }  // namespace bustub
@@ -29,13 +29,15 @@ namespace bustub {
 
 /**
  * TableHeap represents a physical table on disk.
- * This is just a doubly-linked list of pages.
+ * This is just a doubly-linked list of pages. The pages are allocated in extents of EXTENT_SIZE consecutive page ids,
+ * so that scans read contiguous ranges of the file even when several tables grow at the same time.
  */
 class TableHeap {
   friend class TableIterator;
 
  public:
-  ~TableHeap() = default;
+  /** Hand the page ids of the current extent that were never used back to the buffer pool. */
+  ~TableHeap();
 
   /**
    * Create a table heap without a transaction. (open table)
@@ -63,9 +65,10 @@ class TableHeap {
   /**
    * Read a tuple from the table.
    * @param rid rid of the tuple to read
+   * @param access_type how the page is accessed, sequential scans pass AccessType::Scan
    * @return the meta and tuple
    */
-  auto GetTuple(RID rid) -> std::pair<TupleMeta, Tuple>;
+  auto GetTuple(RID rid, AccessType access_type = AccessType::Unknown) -> std::pair<TupleMeta, Tuple>;
 
   /**
    * Read a tuple meta from the table. Note: if you want to get tuple and meta together, use `GetTuple` insead
@@ -96,8 +99,17 @@ class TableHeap {
   BufferPoolManager *bpm_;
   page_id_t first_page_id_{INVALID_PAGE_ID};
 
+  /**
+   * Create the next page of the table, from the current extent or else from a newly reserved one.
+   * @return the pinned new page, or nullptr if there is no frame for it
+   */
+  auto NewTablePage(page_id_t *page_id) -> Page *;
+
   std::mutex latch_;
   page_id_t last_page_id_{INVALID_PAGE_ID}; /* protected by latch_ */
+  /** The unused page ids [next_extent_page_id_, extent_end_page_id_) of the current extent, protected by latch_. */
+  page_id_t next_extent_page_id_{INVALID_PAGE_ID};
+  page_id_t extent_end_page_id_{INVALID_PAGE_ID};
 };
 
 }  // namespace bustub
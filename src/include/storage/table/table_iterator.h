@@ -48,6 +48,9 @@ class TableIterator {
   auto operator++() -> TableIterator &;
 
  private:
+  /** Read the pages of the table starting at page_id into the buffer pool in the background. */
+  void ReadAhead(page_id_t page_id);
+
   TableHeap *table_heap_;
   RID rid_;
 
@@ -10,8 +10,16 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <mutex>  // NOLINT
@@ -20,23 +28,107 @@
 
 #include "common/exception.h"
 #include "common/logger.h"
+#include "common/util/checksum_util.h"
 #include "storage/disk/disk_manager.h"
 
 namespace bustub {
 
 static char *buffer_used;
 
+/** @return true if data can take part in an O_DIRECT transfer as it is */
+static auto IsAligned(const char *data) -> bool { return reinterpret_cast<uintptr_t>(data) % BUSTUB_PAGE_SIZE == 0; }
+
+/** @return an aligned page to bounce O_DIRECT transfers of unaligned buffers through, one per thread */
+static auto BouncePage() -> char * {
+  alignas(BUSTUB_PAGE_SIZE) static thread_local char page[BUSTUB_PAGE_SIZE];
+  return page;
+}
+
+/**
+ * Read up to size bytes at offset, retrying short reads and interrupts.
+ * @return the number of bytes read, less than size only at the end of the file, or -1 on an I/O error
+ */
+static auto PreadFully(int fd, char *data, size_t size, size_t offset) -> ssize_t {
+  size_t done = 0;
+  while (done < size) {
+    auto rc = pread(fd, data + done, size - done, static_cast<off_t>(offset + done));
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    if (rc < 0) {
+      return -1;
+    }
+    if (rc == 0) {
+      break;
+    }
+    done += rc;
+  }
+  return static_cast<ssize_t>(done);
+}
+
+/**
+ * Write size bytes at offset, retrying short writes and interrupts.
+ * @return false on an I/O error
+ */
+static auto PwriteFully(int fd, const char *data, size_t size, size_t offset) -> bool {
+  size_t done = 0;
+  while (done < size) {
+    auto rc = pwrite(fd, data + done, size - done, static_cast<off_t>(offset + done));
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    if (rc < 0) {
+      return false;
+    }
+    done += rc;
+  }
+  return true;
+}
+
+/** The first entry of the checksum file. */
+struct ChecksumFileHeader {
+  uint32_t magic_;
+  // set by a clean shutdown, cleared on open: the checksums match the pages only if the file was closed cleanly
+  uint32_t is_clean_;
+};
+
+/** The entries of the checksum file after the header, one per page id. */
+struct ChecksumFileEntry {
+  uint32_t crc_;
+  // 0 if the page has no checksum, every CRC is a valid one
+  uint32_t is_set_;
+};
+
+static constexpr uint32_t CHECKSUM_FILE_MAGIC = 0x4B435442;  // "BTCK"
+
+static_assert(sizeof(ChecksumFileHeader) == sizeof(ChecksumFileEntry));
+
+/** @return the offset of the entry of a page in the checksum file */
+static auto ChecksumOffset(page_id_t page_id) -> size_t {
+  return (static_cast<size_t>(page_id) + 1) * sizeof(ChecksumFileEntry);
+}
+
+/** How long the scrubber waits before it looks at an empty database file again. */
+static constexpr auto SCRUBBER_IDLE_INTERVAL = std::chrono::milliseconds(100);
+
+auto DiskManager::PageChecksum(const char *page_data) -> uint32_t {
+  return ChecksumUtil::Crc32c(page_data, BUSTUB_PAGE_SIZE);
+}
+
 /**
  * Constructor: open/create a single database file & log file
  * @input db_file: database file name
  */
-DiskManager::DiskManager(const std::string &db_file) : file_name_(db_file) {
+DiskManager::DiskManager(const std::string &db_file, bool use_direct_io) : file_name_(db_file) {
   std::string::size_type n = file_name_.rfind('.');
   if (n == std::string::npos) {
     LOG_DEBUG("wrong file format");
     return;
   }
   log_name_ = file_name_.substr(0, n) + ".log";
+  warm_name_ = file_name_.substr(0, n) + ".warm";
+  fsm_name_ = file_name_.substr(0, n) + ".fsm";
+  crc_name_ = file_name_.substr(0, n) + ".crc";
 
   log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
   // directory or file does not exist
@@ -49,27 +141,53 @@ DiskManager::DiskManager(const std::string &db_file) : file_name_(db_file) {
     }
   }
 
-  std::scoped_lock scoped_db_io_latch(db_io_latch_);
-  db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
+  db_fd_ = open(db_file.c_str(), O_RDWR);
   // directory or file does not exist
-  if (!db_io_.is_open()) {
-    db_io_.clear();
+  if (db_fd_ < 0) {
     // create a new file
-    db_io_.open(db_file, std::ios::binary | std::ios::trunc | std::ios::out | std::ios::in);
-    if (!db_io_.is_open()) {
+    db_fd_ = open(db_file.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (db_fd_ < 0) {
       throw Exception("can't open db file");
     }
+    // the side files of an earlier database with the same name mean nothing for this one
+    std::remove(warm_name_.c_str());
+    std::remove(fsm_name_.c_str());
+    std::remove(crc_name_.c_str());
   }
+  struct stat stat_buf;
+  if (fstat(db_fd_, &stat_buf) != 0) {
+    close(db_fd_);
+    throw Exception("can't stat db file");
+  }
+  db_file_size_ = stat_buf.st_size;
+  if (use_direct_io) {
+    // the buffer pool caches the pages already, keep the kernel from caching them a second time
+    use_direct_io_ = fcntl(db_fd_, F_SETFL, fcntl(db_fd_, F_GETFL) | O_DIRECT) == 0;
+    if (!use_direct_io_) {
+      LOG_WARN("the file system does not support direct I/O, using buffered I/O");
+    }
+  }
+  OpenChecksumFile(false);
   buffer_used = nullptr;
 }
 
+DiskManager::~DiskManager() {
+  StopScrubber();
+  CloseChecksumFile();
+  if (db_fd_ >= 0) {
+    close(db_fd_);
+  }
+}
+
 /**
  * Close all file streams
  */
 void DiskManager::ShutDown() {
-  {
-    std::scoped_lock scoped_db_io_latch(db_io_latch_);
-    db_io_.close();
+  StopScrubber();
+  CloseChecksumFile();
+  if (db_fd_ >= 0) {
+    close(db_fd_);
+    db_fd_ = -1;
   }
   log_io_.close();
 }
@@ -77,49 +195,301 @@ void DiskManager::ShutDown() {
 /**
  * Write the contents of the specified page into disk file
  */
-void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
-  std::scoped_lock scoped_db_io_latch(db_io_latch_);
-  size_t offset = static_cast<size_t>(page_id) * BUSTUB_PAGE_SIZE;
-  // set write cursor to offset
-  num_writes_ += 1;
-  db_io_.seekp(offset);
-  db_io_.write(page_data, BUSTUB_PAGE_SIZE);
-  // check for I/O error
-  if (db_io_.bad()) {
+auto DiskManager::WritePage(page_id_t page_id, const char *page_data) -> bool {
+  // The caller may keep changing the page while it is written, checksum a copy and write exactly that. The copy is
+  // aligned for direct I/O as well.
+  auto *copy = static_cast<char *>(memcpy(BouncePage(), page_data, BUSTUB_PAGE_SIZE));
+  auto crc = PageChecksum(copy);
+  BeginWrite(page_id);
+  bool is_written = WriteData(page_id, copy, 1);
+  return EndWrite(page_id, is_written, crc);
+}
+
+auto DiskManager::WriteData(page_id_t first_page_id, const char *data, size_t num_pages) -> bool {
+  auto offset = static_cast<size_t>(first_page_id) * BUSTUB_PAGE_SIZE;
+  num_writes_ += static_cast<int>(num_pages);
+  if (!PwriteFully(db_fd_, data, num_pages * BUSTUB_PAGE_SIZE, offset)) {
     LOG_DEBUG("I/O error while writing");
-    return;
+    return false;
   }
-  // needs to flush to keep disk file in sync
-  db_io_.flush();
+  GrowDbFileSize(static_cast<int64_t>(offset + num_pages * BUSTUB_PAGE_SIZE));
+  return true;
+}
+
+/**
+ * Write a batch of pages, coalescing runs of consecutive page ids, and sync the file once
+ */
+auto DiskManager::WritePages(const std::vector<page_id_t> &page_ids, const std::vector<const char *> &page_data)
+    -> bool {
+  if (db_fd_ < 0) {
+    // an in-memory disk manager overrides WritePage only
+    bool ok = true;
+    for (size_t i = 0; i < page_ids.size(); i++) {
+      ok = WritePage(page_ids[i], page_data[i]) && ok;
+    }
+    return ok;
+  }
+  if (page_ids.empty()) {
+    return true;
+  }
+  // Like WritePage, write and checksum a copy of the batch. Laid out back to back, a run of consecutive page ids is
+  // written with a single call, and the copy is aligned for direct I/O.
+  auto *copy = static_cast<char *>(std::aligned_alloc(BUSTUB_PAGE_SIZE, page_ids.size() * BUSTUB_PAGE_SIZE));
+  if (copy == nullptr) {
+    LOG_DEBUG("cannot allocate a copy of %zu pages to write", page_ids.size());
+    return false;
+  }
+  std::vector<uint32_t> crcs(page_ids.size());
+  for (size_t i = 0; i < page_ids.size(); i++) {
+    memcpy(copy + i * BUSTUB_PAGE_SIZE, page_data[i], BUSTUB_PAGE_SIZE);
+    crcs[i] = PageChecksum(copy + i * BUSTUB_PAGE_SIZE);
+  }
+  bool ok = true;
+  for (size_t begin = 0; ok && begin < page_ids.size();) {
+    auto end = begin + 1;
+    while (end < page_ids.size() && page_ids[end] == page_ids[end - 1] + 1) {
+      end++;
+    }
+    // in ascending order, like any other batch, so that two batches never wait for each other's pages
+    for (auto i = begin; i < end; i++) {
+      BeginWrite(page_ids[i]);
+    }
+    bool is_written = WriteData(page_ids[begin], copy + begin * BUSTUB_PAGE_SIZE, end - begin);
+    for (auto i = begin; i < end; i++) {
+      ok = EndWrite(page_ids[i], is_written, crcs[i]) && ok;
+    }
+    begin = end;
+  }
+  std::free(copy);
+  // the checksums are synced with the pages they belong to
+  if (ok && (fdatasync(db_fd_) != 0 || (crc_fd_ >= 0 && fdatasync(crc_fd_) != 0))) {
+    LOG_DEBUG("I/O error while syncing");
+    ok = false;
+  }
+  return ok;
 }
 
 /**
  * Read the contents of the specified page into the given memory area
  */
-void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
-  std::scoped_lock scoped_db_io_latch(db_io_latch_);
-  int offset = page_id * BUSTUB_PAGE_SIZE;
+auto DiskManager::ReadPage(page_id_t page_id, char *page_data) -> bool {
+  size_t offset = static_cast<size_t>(page_id) * BUSTUB_PAGE_SIZE;
   // check if read beyond file length
-  if (offset > GetFileSize(file_name_)) {
+  if (static_cast<int64_t>(offset) >= db_file_size_.load()) {
     LOG_DEBUG("I/O error reading past end of file");
-    // std::cerr << "I/O error while reading" << std::endl;
-  } else {
-    // set read cursor to offset
-    db_io_.seekp(offset);
-    db_io_.read(page_data, BUSTUB_PAGE_SIZE);
-    if (db_io_.bad()) {
-      LOG_DEBUG("I/O error while reading");
-      return;
+    memset(page_data, 0, BUSTUB_PAGE_SIZE);
+    return true;
+  }
+  char *target = use_direct_io_ && !IsAligned(page_data) ? BouncePage() : page_data;
+  auto read_count = PreadFully(db_fd_, target, BUSTUB_PAGE_SIZE, offset);
+  if (read_count < 0) {
+    LOG_DEBUG("I/O error while reading");
+    return false;
+  }
+  if (target != page_data) {
+    memcpy(page_data, target, read_count);
+  }
+  // if file ends before reading BUSTUB_PAGE_SIZE
+  if (read_count < BUSTUB_PAGE_SIZE) {
+    LOG_DEBUG("Read less than a page");
+    memset(page_data + read_count, 0, BUSTUB_PAGE_SIZE - read_count);
+  }
+  return VerifyChecksum(page_id, page_data);
+}
+
+void DiskManager::BeginWrite(page_id_t page_id) {
+  std::unique_lock<std::mutex> lock(checksum_latch_);
+  write_cv_.wait(lock, [&] { return writes_in_flight_.count(page_id) == 0; });
+  writes_in_flight_.insert(page_id);
+}
+
+auto DiskManager::TryBeginWrite(page_id_t page_id) -> bool {
+  std::lock_guard<std::mutex> lock(checksum_latch_);
+  return writes_in_flight_.insert(page_id).second;
+}
+
+auto DiskManager::EndWrite(page_id_t page_id, bool is_written, uint32_t crc) -> bool {
+  // a failed write may have left any part of the page on disk, it has no known checksum then
+  ChecksumFileEntry entry{crc, is_written ? 1U : 0U};
+  bool is_recorded = crc_fd_ < 0 || PwriteFully(crc_fd_, reinterpret_cast<const char *>(&entry), sizeof(entry),
+                                                ChecksumOffset(page_id));
+  if (!is_recorded) {
+    // the file may keep a stale checksum for the page, it must not be trusted on the next start
+    LOG_DEBUG("I/O error while writing checksum");
+    is_checksum_file_stale_ = true;
+  }
+  {
+    std::lock_guard<std::mutex> lock(checksum_latch_);
+    if (checksums_.size() <= static_cast<size_t>(page_id)) {
+      checksums_.resize(page_id + 1);
     }
-    // if file ends before reading BUSTUB_PAGE_SIZE
-    int read_count = db_io_.gcount();
-    if (read_count < BUSTUB_PAGE_SIZE) {
-      LOG_DEBUG("Read less than a page");
-      db_io_.clear();
-      // std::cerr << "Read less than a page" << std::endl;
-      memset(page_data + read_count, 0, BUSTUB_PAGE_SIZE - read_count);
+    checksums_[page_id] = {crc, is_written, true};
+    writes_in_flight_.erase(page_id);
+  }
+  write_cv_.notify_all();
+  return is_written && is_recorded;
+}
+
+auto DiskManager::VerifyChecksum(page_id_t page_id, const char *page_data) -> bool {
+  auto checksum = GetChecksum(page_id);
+  if (!checksum.is_set_ || checksum.crc_ == PageChecksum(page_data)) {
+    return true;
+  }
+  num_checksum_failures_++;
+  if (!checksum.is_trusted_) {
+    LOG_WARN("page %d does not match its checksum, which may be stale since the db was not shut down cleanly", page_id);
+    return true;
+  }
+  LOG_WARN("page %d does not match its checksum, it is corrupt", page_id);
+  return false;
+}
+
+auto DiskManager::VerifyMappedPage(page_id_t page_id) -> bool {
+  return VerifyChecksum(page_id, mapped_data_ + static_cast<size_t>(page_id) * BUSTUB_PAGE_SIZE);
+}
+
+auto DiskManager::GetChecksum(page_id_t page_id) -> Checksum {
+  std::lock_guard<std::mutex> lock(checksum_latch_);
+  return static_cast<size_t>(page_id) < checksums_.size() ? checksums_[page_id] : Checksum{};
+}
+
+void DiskManager::OpenChecksumFile(bool is_read_only) {
+  crc_fd_ = is_read_only ? open(crc_name_.c_str(), O_RDONLY) : open(crc_name_.c_str(), O_RDWR | O_CREAT, 0666);
+  struct stat stat_buf;
+  if (crc_fd_ < 0 || fstat(crc_fd_, &stat_buf) != 0) {
+    LOG_WARN("can't open checksum file, pages are not verified");
+    if (crc_fd_ >= 0) {
+      close(crc_fd_);
+      crc_fd_ = -1;
     }
+    return;
+  }
+  ChecksumFileHeader header{0, 0};
+  auto size = static_cast<size_t>(stat_buf.st_size);
+  if (size > 0) {
+    if (PreadFully(crc_fd_, reinterpret_cast<char *>(&header), sizeof(header), 0) != sizeof(header) ||
+        header.magic_ != CHECKSUM_FILE_MAGIC) {
+      LOG_WARN("can't read checksum file, pages are not verified");
+      size = 0;
+    } else if (header.is_clean_ == 0) {
+      // A crash may have come between writing a page and its checksum, a mismatch only fails the read of a page
+      // that was written again since.
+      LOG_WARN("the db was not shut down cleanly, its checksums are advisory");
+    }
+  }
+  std::vector<ChecksumFileEntry> entries(size / sizeof(ChecksumFileEntry) - (size > 0 ? 1 : 0));
+  auto entries_size = entries.size() * sizeof(ChecksumFileEntry);
+  if (PreadFully(crc_fd_, reinterpret_cast<char *>(entries.data()), entries_size, ChecksumOffset(0)) !=
+      static_cast<ssize_t>(entries_size)) {
+    LOG_WARN("can't read checksum file, pages are not verified");
+    entries.clear();
+  }
+  checksums_.resize(entries.size());
+  for (size_t i = 0; i < entries.size(); i++) {
+    checksums_[i] = {entries[i].crc_, entries[i].is_set_ != 0, header.is_clean_ != 0};
+  }
+  if (is_read_only) {
+    close(crc_fd_);
+    crc_fd_ = -1;
+    return;
   }
+
+  // until the next clean shutdown, the checksums in the file may fall behind the pages
+  header = {CHECKSUM_FILE_MAGIC, 0};
+  if (!PwriteFully(crc_fd_, reinterpret_cast<const char *>(&header), sizeof(header), 0) || fdatasync(crc_fd_) != 0) {
+    LOG_WARN("can't write checksum file, pages are not verified");
+    close(crc_fd_);
+    crc_fd_ = -1;
+    checksums_.clear();
+  }
+}
+
+void DiskManager::CloseChecksumFile() {
+  if (crc_fd_ < 0) {
+    return;
+  }
+  // the pages have to be on disk before their checksums are declared valid
+  if (!is_checksum_file_stale_ && db_fd_ >= 0 && fdatasync(db_fd_) == 0 && fdatasync(crc_fd_) == 0) {
+    ChecksumFileHeader header{CHECKSUM_FILE_MAGIC, 1};
+    if (PwriteFully(crc_fd_, reinterpret_cast<const char *>(&header), sizeof(header), 0)) {
+      fdatasync(crc_fd_);
+    }
+  }
+  close(crc_fd_);
+  crc_fd_ = -1;
+}
+
+void DiskManager::StartScrubber(size_t bytes_per_second) {
+  if (db_fd_ < 0 || scrubber_ != nullptr || bytes_per_second == 0) {
+    return;
+  }
+  scrubber_stop_ = false;
+  scrubber_ = new std::thread(&DiskManager::RunScrubber, this, bytes_per_second);
+}
+
+void DiskManager::StopScrubber() {
+  if (scrubber_ == nullptr) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(scrubber_latch_);
+    scrubber_stop_ = true;
+  }
+  scrubber_cv_.notify_all();
+  scrubber_->join();
+  delete scrubber_;
+  scrubber_ = nullptr;
+}
+
+void DiskManager::RunScrubber(size_t bytes_per_second) {
+  // aligned, so that the scrubber can read a direct-I/O file as well
+  auto *buffer = static_cast<char *>(std::aligned_alloc(BUSTUB_PAGE_SIZE, SCRUB_BATCH_SIZE * BUSTUB_PAGE_SIZE));
+  if (buffer == nullptr) {
+    LOG_WARN("cannot allocate the scrubber's buffer, not scrubbing %s", file_name_.c_str());
+    return;
+  }
+  // wait until the bandwidth budget allows the next read, or the scrubber is stopped
+  auto throttle = [&](std::chrono::steady_clock::time_point until) {
+    std::unique_lock<std::mutex> lock(scrubber_latch_);
+    return !scrubber_cv_.wait_until(lock, until, [&] { return scrubber_stop_; });
+  };
+
+  bool is_running = true;
+  while (is_running) {
+    // the bandwidth budget starts over with every pass, so that idle time does not turn into a burst later
+    auto start = std::chrono::steady_clock::now();
+    size_t bytes_read = 0;
+    auto num_pages = static_cast<page_id_t>(db_file_size_.load() / BUSTUB_PAGE_SIZE);
+    for (page_id_t first = 0; is_running && first < num_pages; first += SCRUB_BATCH_SIZE) {
+      auto count = std::min(SCRUB_BATCH_SIZE, num_pages - first);
+      auto offset = static_cast<size_t>(first) * BUSTUB_PAGE_SIZE;
+      auto read_count = PreadFully(db_fd_, buffer, count * BUSTUB_PAGE_SIZE, offset);
+      if (read_count < 0) {
+        LOG_DEBUG("I/O error while scrubbing");
+        read_count = 0;
+      }
+      for (page_id_t i = 0; i < read_count / BUSTUB_PAGE_SIZE; i++) {
+        char *page_data = buffer + i * BUSTUB_PAGE_SIZE;
+        auto checksum = GetChecksum(first + i);
+        // the page may have been read while a write of it was in flight, only a mismatch that persists counts
+        if (checksum.is_set_ && checksum.crc_ != PageChecksum(page_data) &&
+            PreadFully(db_fd_, page_data, BUSTUB_PAGE_SIZE, offset + i * BUSTUB_PAGE_SIZE) == BUSTUB_PAGE_SIZE) {
+          VerifyChecksum(first + i, page_data);
+        }
+        num_scrubbed_pages_++;
+      }
+      bytes_read += count * BUSTUB_PAGE_SIZE;
+      auto budget = std::chrono::duration<double>(static_cast<double>(bytes_read) / bytes_per_second);
+      is_running = throttle(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(budget));
+    }
+    if (is_running) {
+      num_scrub_passes_++;
+      if (num_pages == 0) {
+        is_running = throttle(std::chrono::steady_clock::now() + SCRUBBER_IDLE_INTERVAL);
+      }
+    }
+  }
+  std::free(buffer);
 }
 
 /**
@@ -200,8 +570,17 @@ auto DiskManager::GetNumWrites() const -> int { return num_writes_; }
 auto DiskManager::GetFlushState() const -> bool { return flush_log_; }
 
 /**
- * Private helper function to get disk file size
+ * Returns the tracked size of the database file
  */
+auto DiskManager::GetDbFileSize() const -> int64_t { return db_file_size_; }
+
+void DiskManager::GrowDbFileSize(int64_t end) {
+  // concurrent writes past the end race to grow the file, the size only ever moves up
+  auto size = db_file_size_.load();
+  while (size < end && !db_file_size_.compare_exchange_weak(size, end)) {
+  }
+}
+
 auto DiskManager::GetFileSize(const std::string &file_name) -> int {
   struct stat stat_buf;
   int rc = stat(file_name.c_str(), &stat_buf);
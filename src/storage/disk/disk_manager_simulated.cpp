@@ -0,0 +1,225 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// disk_manager_simulated.cpp
+//
+// Identification: src/storage/disk/disk_manager_simulated.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/disk_manager_simulated.h"
+
+#include <sys/mman.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>  // NOLINT
+
+#include "common/exception.h"
+#include "common/logger.h"
+
+namespace bustub {
+
+namespace {
+
+constexpr size_t PAGES_PER_CHUNK = FRAME_ARENA_ALIGNMENT / BUSTUB_PAGE_SIZE;
+
+/** Sleeping overshoots by tens of microseconds, so the last stretch of a wait is spent yielding instead. */
+constexpr auto SPIN_THRESHOLD = std::chrono::microseconds(100);
+
+/** @return a well-mixed 64-bit value for x, the splitmix64 finalizer */
+auto Mix(uint64_t x) -> uint64_t {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+/** @return a uniform sample in (0, 1] */
+auto ToUniform(uint64_t x) -> double { return static_cast<double>((x >> 11) + 1) * 0x1.0p-53; }
+
+/** @return a zeroed chunk aligned to FRAME_ARENA_ALIGNMENT, committed only as it is touched */
+auto MapChunk() -> char * {
+  // mmap only guarantees OS page alignment, so map an extra chunk and cut off what is not needed
+  auto mapped_size = 2 * FRAME_ARENA_ALIGNMENT;
+  void *mapped = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (mapped == MAP_FAILED) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot map simulated device storage");
+  }
+  auto begin = reinterpret_cast<uintptr_t>(mapped);
+  auto aligned = (begin + FRAME_ARENA_ALIGNMENT - 1) / FRAME_ARENA_ALIGNMENT * FRAME_ARENA_ALIGNMENT;
+  if (aligned > begin) {
+    munmap(mapped, aligned - begin);
+  }
+  if (begin + mapped_size > aligned + FRAME_ARENA_ALIGNMENT) {
+    munmap(reinterpret_cast<void *>(aligned + FRAME_ARENA_ALIGNMENT),
+           begin + mapped_size - aligned - FRAME_ARENA_ALIGNMENT);
+  }
+  auto *chunk = reinterpret_cast<char *>(aligned);
+#ifdef MADV_HUGEPAGE
+  // best effort, the device works the same with regular pages
+  madvise(chunk, FRAME_ARENA_ALIGNMENT, MADV_HUGEPAGE);
+#endif
+  return chunk;
+}
+
+}  // namespace
+
+auto DeviceProfile::FromName(const std::string &name) -> std::optional<DeviceProfile> {
+  if (name == "instant") {
+    return Instant();
+  }
+  if (name == "nvme") {
+    return Nvme();
+  }
+  if (name == "ssd") {
+    return Ssd();
+  }
+  if (name == "hdd") {
+    return Hdd();
+  }
+  return std::nullopt;
+}
+
+DiskManagerSimulated::DiskManagerSimulated(const DeviceProfile &profile, size_t capacity_pages, uint64_t seed)
+    : capacity_pages_(capacity_pages),
+      seed_(seed),
+      num_directory_entries_((capacity_pages + PAGES_PER_CHUNK - 1) / PAGES_PER_CHUNK),
+      profile_(profile) {
+  chunks_ = std::make_unique<std::atomic<char *>[]>(num_directory_entries_);
+  for (size_t i = 0; i < num_directory_entries_; i++) {
+    chunks_[i] = nullptr;
+  }
+}
+
+DiskManagerSimulated::~DiskManagerSimulated() {
+  for (size_t i = 0; i < num_directory_entries_; i++) {
+    if (chunks_[i] != nullptr) {
+      munmap(chunks_[i], FRAME_ARENA_ALIGNMENT);
+    }
+  }
+}
+
+auto DiskManagerSimulated::WritePage(page_id_t page_id, const char *page_data) -> bool {
+  if (page_id < 0 || static_cast<size_t>(page_id) >= capacity_pages_) {
+    LOG_DEBUG("page id %d beyond the capacity of the simulated device", page_id);
+    return false;
+  }
+  auto done = BeginIo(page_id, true);
+  WaitUntil(done);
+  memcpy(GetPageData(page_id, true), page_data, BUSTUB_PAGE_SIZE);
+  num_writes_++;
+  EndIo();
+  return true;
+}
+
+auto DiskManagerSimulated::ReadPage(page_id_t page_id, char *page_data) -> bool {
+  if (page_id < 0 || static_cast<size_t>(page_id) >= capacity_pages_) {
+    LOG_DEBUG("page id %d beyond the capacity of the simulated device", page_id);
+    return false;
+  }
+  auto done = BeginIo(page_id, false);
+  WaitUntil(done);
+  auto *data = GetPageData(page_id, false);
+  if (data == nullptr) {
+    memset(page_data, 0, BUSTUB_PAGE_SIZE);
+  } else {
+    memcpy(page_data, data, BUSTUB_PAGE_SIZE);
+  }
+  num_reads_++;
+  EndIo();
+  return true;
+}
+
+void DiskManagerSimulated::SetProfile(const DeviceProfile &profile) {
+  {
+    std::lock_guard<std::mutex> lock(latch_);
+    profile_ = profile;
+  }
+  // a deeper queue may let waiting I/Os in
+  queue_cv_.notify_all();
+}
+
+auto DiskManagerSimulated::GetPageData(page_id_t page_id, bool create) -> char * {
+  if (page_id < 0 || static_cast<size_t>(page_id) >= capacity_pages_) {
+    return nullptr;
+  }
+  auto &chunk = chunks_[page_id / PAGES_PER_CHUNK];
+  auto *data = chunk.load();
+  if (data == nullptr) {
+    if (!create) {
+      return nullptr;
+    }
+    auto *new_data = MapChunk();
+    if (chunk.compare_exchange_strong(data, new_data)) {
+      data = new_data;
+      num_chunks_++;
+    } else {
+      // another writer mapped the chunk first, data holds its mapping now
+      munmap(new_data, FRAME_ARENA_ALIGNMENT);
+    }
+  }
+  return data + (page_id % PAGES_PER_CHUNK) * BUSTUB_PAGE_SIZE;
+}
+
+auto DiskManagerSimulated::BeginIo(page_id_t page_id, bool is_write) -> Clock::time_point {
+  std::unique_lock<std::mutex> lock(latch_);
+  queue_cv_.wait(lock, [&] { return profile_.queue_depth_ == 0 || in_flight_ < profile_.queue_depth_; });
+  in_flight_++;
+  bool is_seek = page_id != next_sequential_page_id_;
+  next_sequential_page_id_ = page_id + 1;
+  auto mean_us = is_write ? profile_.write_latency_us_ : profile_.read_latency_us_;
+  auto latency_us = SampleLatency(num_ios_++, mean_us, is_seek);
+  auto done = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                                 std::chrono::duration<double, std::micro>(latency_us));
+  if (profile_.bandwidth_mb_s_ > 0) {
+    // the transfer starts once the data is ready and the bandwidth is not taken by an earlier transfer
+    auto transfer = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::micro>(
+        static_cast<double>(BUSTUB_PAGE_SIZE) / static_cast<double>(profile_.bandwidth_mb_s_)));
+    done = std::max(done, bandwidth_free_at_) + transfer;
+    bandwidth_free_at_ = done;
+  }
+  return done;
+}
+
+void DiskManagerSimulated::EndIo() {
+  {
+    std::lock_guard<std::mutex> lock(latch_);
+    in_flight_--;
+  }
+  queue_cv_.notify_one();
+}
+
+void DiskManagerSimulated::WaitUntil(Clock::time_point done) {
+  if (done - Clock::now() > SPIN_THRESHOLD) {
+    std::this_thread::sleep_until(done - SPIN_THRESHOLD);
+  }
+  while (Clock::now() < done) {
+    std::this_thread::yield();
+  }
+}
+
+auto DiskManagerSimulated::SampleLatency(uint64_t seq, uint64_t mean_us, bool is_seek) const -> double {
+  auto latency_us = static_cast<double>(mean_us);
+  if (is_seek) {
+    latency_us += static_cast<double>(profile_.seek_latency_us_);
+  }
+  auto random = Mix(seed_ ^ Mix(seq));
+  if (profile_.latency_sigma_ > 0 && latency_us > 0) {
+    // Box-Muller on two uniforms, scaled so that the log-normal factor has a mean of 1
+    auto u1 = ToUniform(random);
+    auto u2 = ToUniform(Mix(random));
+    auto z = std::sqrt(-2 * std::log(u1)) * std::cos(2 * M_PI * u2);
+    auto sigma = profile_.latency_sigma_;
+    latency_us *= std::exp(sigma * z - sigma * sigma / 2);
+  }
+  if (profile_.stall_probability_ > 0 && ToUniform(Mix(Mix(random))) <= profile_.stall_probability_) {
+    latency_us += static_cast<double>(profile_.stall_latency_us_);
+  }
+  return latency_us;
+}
+
+}  // namespace bustub
@@ -0,0 +1,73 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// disk_manager_snapshot.cpp
+//
+// Identification: src/storage/disk/disk_manager_snapshot.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/disk_manager_snapshot.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+
+#include "common/exception.h"
+#include "common/logger.h"
+
+namespace bustub {
+
+DiskManagerSnapshot::DiskManagerSnapshot(const std::string &db_file) {
+  file_name_ = db_file;
+  int fd = open(db_file.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw Exception("can't open db file");
+  }
+  struct stat stat_buf;
+  if (fstat(fd, &stat_buf) != 0) {
+    close(fd);
+    throw Exception("can't stat db file");
+  }
+  db_file_size_ = stat_buf.st_size;
+  num_pages_ = static_cast<page_id_t>((stat_buf.st_size + BUSTUB_PAGE_SIZE - 1) / BUSTUB_PAGE_SIZE);
+  // mmap rejects an empty mapping, the page beyond the end of an empty file is never touched
+  mapped_size_ = std::max<size_t>(stat_buf.st_size, BUSTUB_PAGE_SIZE);
+  void *mapped = mmap(nullptr, mapped_size_, PROT_READ, MAP_SHARED, fd, 0);
+  // the mapping keeps the file open
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    throw Exception("can't map db file");
+  }
+  mapped_data_ = static_cast<const char *>(mapped);
+
+  auto n = file_name_.rfind('.');
+  if (n != std::string::npos) {
+    crc_name_ = file_name_.substr(0, n) + ".crc";
+    OpenChecksumFile(true);
+  }
+}
+
+DiskManagerSnapshot::~DiskManagerSnapshot() { munmap(const_cast<char *>(mapped_data_), mapped_size_); }
+
+auto DiskManagerSnapshot::WritePage(page_id_t page_id, const char *page_data) -> bool {
+  LOG_DEBUG("can't write to a read-only snapshot of the db file");
+  return false;
+}
+
+auto DiskManagerSnapshot::ReadPage(page_id_t page_id, char *page_data) -> bool {
+  if (page_id < 0 || page_id >= num_pages_) {
+    memset(page_data, 0, BUSTUB_PAGE_SIZE);
+    return true;
+  }
+  memcpy(page_data, mapped_data_ + static_cast<size_t>(page_id) * BUSTUB_PAGE_SIZE, BUSTUB_PAGE_SIZE);
+  return VerifyChecksum(page_id, page_data);
+}
+
+}  // namespace bustub
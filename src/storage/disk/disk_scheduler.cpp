@@ -0,0 +1,354 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// disk_scheduler.cpp
+//
+// Identification: src/storage/disk/disk_scheduler.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/disk_scheduler.h"
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "common/logger.h"
+
+namespace bustub {
+
+/**
+ * A minimal io_uring instance on top of the raw system calls. Submission and completion side are each used by one
+ * thread only, which may run concurrently.
+ */
+class IoUring {
+ public:
+  /** @return a ring with room for entries submissions, or nullptr if the kernel does not support io_uring */
+  static auto Create(unsigned entries) -> std::unique_ptr<IoUring> {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (fd < 0) {
+      return nullptr;
+    }
+    std::unique_ptr<IoUring> ring(new IoUring(fd));
+    // IORING_OP_READ/WRITE came with the same kernel as this feature
+    if ((params.features & IORING_FEAT_RW_CUR_POS) == 0 || !ring->Map(params)) {
+      return nullptr;
+    }
+    return ring;
+  }
+
+  ~IoUring() {
+    if (sqes_ != MAP_FAILED) {
+      munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_ != MAP_FAILED) {
+      munmap(sq_ring_, sq_ring_size_);
+    }
+    close(fd_);
+  }
+
+  DISALLOW_COPY_AND_MOVE(IoUring);
+
+  /** @brief Queue an operation for the next Submit. The caller makes sure that the submission queue has room. */
+  void Prepare(uint8_t opcode, int fd, char *data, unsigned size, uint64_t offset, uint64_t user_data) {
+    unsigned tail = *sq_tail_;
+    unsigned index = tail & *sq_mask_;
+    io_uring_sqe *sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(data);
+    sqe->len = size;
+    sqe->off = offset;
+    sqe->user_data = user_data;
+    sq_array_[index] = index;
+    // the kernel must see the entry before the new tail
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    num_prepared_++;
+  }
+
+  /** @brief Hand the prepared operations to the kernel. */
+  void Submit() {
+    while (num_prepared_ > 0) {
+      auto rc = syscall(__NR_io_uring_enter, fd_, num_prepared_, 0, 0, nullptr, 0);
+      if (rc < 0) {
+        BUSTUB_ENSURE(errno == EINTR || errno == EAGAIN || errno == EBUSY, "io_uring_enter failed");
+        continue;
+      }
+      num_prepared_ -= static_cast<unsigned>(rc);
+    }
+  }
+
+  /** @brief Block until an operation completed, and return its user data and result. */
+  void WaitCompletion(uint64_t *user_data, int32_t *res) {
+    while (true) {
+      unsigned head = *cq_head_;
+      if (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+        io_uring_cqe *cqe = &cqes_[head & *cq_mask_];
+        *user_data = cqe->user_data;
+        *res = cqe->res;
+        // the kernel may reuse the entry once it sees the new head
+        __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+        return;
+      }
+      auto rc = syscall(__NR_io_uring_enter, fd_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+      BUSTUB_ENSURE(rc >= 0 || errno == EINTR || errno == EAGAIN || errno == EBUSY, "io_uring_enter failed");
+    }
+  }
+
+ private:
+  explicit IoUring(int fd) : fd_(fd) {}
+
+  auto Map(const io_uring_params &params) -> bool {
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+      sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+      return false;
+    }
+    cq_ring_ = single_mmap ? sq_ring_
+                           : mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                                  IORING_OFF_CQ_RING);
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    auto *sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+    sqes_ = static_cast<io_uring_sqe *>(sqes);
+    if (cq_ring_ == MAP_FAILED || sqes == MAP_FAILED) {
+      return false;
+    }
+
+    auto *sq = static_cast<char *>(sq_ring_);
+    sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    auto *cq = static_cast<char *>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    return true;
+  }
+
+  int fd_;
+  void *sq_ring_{MAP_FAILED};
+  void *cq_ring_{MAP_FAILED};
+  io_uring_sqe *sqes_{static_cast<io_uring_sqe *>(MAP_FAILED)};
+  size_t sq_ring_size_{0};
+  size_t cq_ring_size_{0};
+  size_t sqes_size_{0};
+  unsigned *sq_tail_{nullptr};
+  unsigned *sq_mask_{nullptr};
+  unsigned *sq_array_{nullptr};
+  unsigned *cq_head_{nullptr};
+  unsigned *cq_tail_{nullptr};
+  unsigned *cq_mask_{nullptr};
+  io_uring_cqe *cqes_{nullptr};
+  unsigned num_prepared_{0};
+};
+
+/**
+ * A request in the io_uring. A write transfers a private copy of the page, so that the checksum recorded for it is the
+ * one of the bytes written even if the caller changes the page meanwhile.
+ */
+struct RingRequest {
+  explicit RingRequest(DiskRequest r) : request_(std::move(r)) {
+    if (!request_.is_write_) {
+      return;
+    }
+    copy_ = static_cast<char *>(std::aligned_alloc(BUSTUB_PAGE_SIZE, BUSTUB_PAGE_SIZE));
+    memcpy(copy_, request_.data_, BUSTUB_PAGE_SIZE);
+  }
+
+  ~RingRequest() { std::free(copy_); }
+
+  DISALLOW_COPY_AND_MOVE(RingRequest);
+
+  /** @return the buffer to transfer */
+  auto Data() -> char * { return copy_ != nullptr ? copy_ : request_.data_; }
+
+  DiskRequest request_;
+  /** The page data written, nullptr for a read. */
+  char *copy_{nullptr};
+  /** The checksum of copy_, computed by the submission thread. */
+  uint32_t checksum_{0};
+};
+
+DiskScheduler::DiskScheduler(DiskManager *disk_manager, bool use_io_uring) : disk_manager_(disk_manager) {
+  if (use_io_uring && disk_manager_->db_fd_ >= 0) {
+    ring_ = IoUring::Create(DISK_SCHEDULER_QUEUE_DEPTH);
+  }
+  if (ring_ != nullptr) {
+    threads_.emplace_back(&DiskScheduler::RunSubmitter, this);
+    threads_.emplace_back(&DiskScheduler::RunCompleter, this);
+    return;
+  }
+  for (int i = 0; i < DISK_SCHEDULER_WORKERS; i++) {
+    threads_.emplace_back(&DiskScheduler::RunWorker, this);
+  }
+}
+
+DiskScheduler::~DiskScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(latch_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  for (auto &thread : threads_) {
+    thread.join();
+  }
+}
+
+void DiskScheduler::Schedule(DiskRequest r) {
+  if (ring_ != nullptr && disk_manager_->use_direct_io_ &&
+      reinterpret_cast<uintptr_t>(r.data_) % BUSTUB_PAGE_SIZE != 0) {
+    // io_uring cannot transfer an unaligned buffer from an O_DIRECT file, the disk manager bounces it
+    Execute(&r);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(latch_);
+    queue_.push_back(std::move(r));
+  }
+  cv_.notify_one();
+}
+
+auto DiskScheduler::ScheduleRead(page_id_t page_id, char *data) -> std::future<bool> {
+  auto promise = CreatePromise();
+  auto future = promise.get_future();
+  Schedule({false, data, page_id, std::move(promise)});
+  return future;
+}
+
+auto DiskScheduler::ScheduleWrite(page_id_t page_id, char *data) -> std::future<bool> {
+  auto promise = CreatePromise();
+  auto future = promise.get_future();
+  Schedule({true, data, page_id, std::move(promise)});
+  return future;
+}
+
+void DiskScheduler::RunWorker() {
+  while (true) {
+    std::unique_lock<std::mutex> lock(latch_);
+    cv_.wait(lock, [&] { return stop_ || !queue_.empty(); });
+    if (queue_.empty()) {
+      return;
+    }
+    auto r = std::move(queue_.front());
+    queue_.pop_front();
+    lock.unlock();
+    Execute(&r);
+  }
+}
+
+void DiskScheduler::Execute(DiskRequest *r) {
+  bool ok = r->is_write_ ? disk_manager_->WritePage(r->page_id_, r->data_)
+                         : disk_manager_->ReadPage(r->page_id_, r->data_);
+  r->callback_.set_value(ok);
+}
+
+void DiskScheduler::RunSubmitter() {
+  while (true) {
+    std::vector<DiskRequest> batch;
+    {
+      std::unique_lock<std::mutex> lock(latch_);
+      cv_.wait(lock, [&] { return stop_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        break;
+      }
+      slot_cv_.wait(lock, [&] { return num_in_flight_ < static_cast<size_t>(DISK_SCHEDULER_QUEUE_DEPTH); });
+      // everything that queued up meanwhile goes into one system call
+      while (!queue_.empty() && num_in_flight_ < static_cast<size_t>(DISK_SCHEDULER_QUEUE_DEPTH)) {
+        batch.push_back(std::move(queue_.front()));
+        queue_.pop_front();
+        num_in_flight_++;
+      }
+    }
+    // the pages to write are copied and checksummed here, off the latch
+    for (auto &request : batch) {
+      auto *r = new RingRequest(std::move(request));
+      if (r->copy_ != nullptr) {
+        r->checksum_ = DiskManager::PageChecksum(r->copy_);
+        if (!disk_manager_->TryBeginWrite(r->request_.page_id_)) {
+          // Another write of the page is in flight, maybe one prepared above: submit those before waiting for it.
+          ring_->Submit();
+          disk_manager_->BeginWrite(r->request_.page_id_);
+        }
+      }
+      auto offset = static_cast<uint64_t>(r->request_.page_id_) * BUSTUB_PAGE_SIZE;
+      ring_->Prepare(r->request_.is_write_ ? IORING_OP_WRITE : IORING_OP_READ, disk_manager_->db_fd_, r->Data(),
+                     BUSTUB_PAGE_SIZE, offset, reinterpret_cast<uint64_t>(r));
+    }
+    ring_->Submit();
+  }
+
+  // All requests are submitted, a no-op without user data tells the completion thread to finish once they complete.
+  {
+    std::unique_lock<std::mutex> lock(latch_);
+    slot_cv_.wait(lock, [&] { return num_in_flight_ < static_cast<size_t>(DISK_SCHEDULER_QUEUE_DEPTH); });
+    num_in_flight_++;
+  }
+  ring_->Prepare(IORING_OP_NOP, -1, nullptr, 0, 0, 0);
+  ring_->Submit();
+}
+
+void DiskScheduler::RunCompleter() {
+  bool is_stopping = false;
+  while (true) {
+    uint64_t user_data;
+    int32_t res;
+    ring_->WaitCompletion(&user_data, &res);
+    if (user_data == 0) {
+      is_stopping = true;
+    } else {
+      std::unique_ptr<RingRequest> ring_request(reinterpret_cast<RingRequest *>(user_data));
+      auto *r = &ring_request->request_;
+      bool ok = res >= 0;
+      if (!ok) {
+        LOG_DEBUG("I/O error while %s page %d", r->is_write_ ? "writing" : "reading", r->page_id_);
+      }
+      if (r->is_write_) {
+        if (ok && res < BUSTUB_PAGE_SIZE) {
+          // the kernel stopped early, the disk manager writes the whole copy again, retrying until it is complete
+          ok = disk_manager_->WriteData(r->page_id_, ring_request->copy_, 1);
+        } else if (ok) {
+          disk_manager_->num_writes_ += 1;
+          disk_manager_->GrowDbFileSize((static_cast<int64_t>(r->page_id_) + 1) * BUSTUB_PAGE_SIZE);
+        }
+        ok = disk_manager_->EndWrite(r->page_id_, ok, ring_request->checksum_);
+      } else if (ok && res < BUSTUB_PAGE_SIZE) {
+        // A short read, because the file ends before the page does or the kernel stopped early. The disk manager
+        // redoes it on this thread, retrying until it is complete and zero-filling past the end of the file.
+        ok = disk_manager_->ReadPage(r->page_id_, r->data_);
+      } else if (ok) {
+        ok = disk_manager_->VerifyChecksum(r->page_id_, r->data_);
+      }
+      r->callback_.set_value(ok);
+    }
+
+    std::lock_guard<std::mutex> lock(latch_);
+    num_in_flight_--;
+    slot_cv_.notify_one();
+    if (is_stopping && num_in_flight_ == 0) {
+      return;
+    }
+  }
+}
+
+}  // namespace bustub
@@ -0,0 +1,174 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_allocator.cpp
+//
+// Identification: src/storage/disk/page_allocator.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/page_allocator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+
+#include "common/logger.h"
+
+namespace bustub {
+
+namespace {
+
+/** Header of the free-space map file, followed by the bitmap with one bit per page, least significant bit first. */
+struct FreeSpaceMapHeader {
+  uint32_t magic_;
+  page_id_t num_pages_;
+};
+
+constexpr uint32_t FREE_SPACE_MAP_MAGIC = 0x4d505346;  // "FSPM"
+
+}  // namespace
+
+auto PageAllocator::Load(const std::string &file_name, page_id_t num_pages_on_disk) -> bool {
+  std::lock_guard<std::mutex> lock(latch_);
+  num_pages_ = std::max(0, num_pages_on_disk);
+  is_free_.assign(num_pages_, false);
+  num_free_ = 0;
+  first_free_ = 0;
+
+  std::ifstream in(file_name, std::ios::binary);
+  FreeSpaceMapHeader header;
+  if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)) || header.magic_ != FREE_SPACE_MAP_MAGIC ||
+      header.num_pages_ < 0) {
+    return false;
+  }
+  std::vector<char> bitmap((header.num_pages_ + 7) / 8);
+  if (!in.read(bitmap.data(), static_cast<std::streamsize>(bitmap.size()))) {
+    return false;
+  }
+  // pages beyond the map made it to disk after it was saved, they are allocated
+  num_pages_ = std::max(num_pages_, header.num_pages_);
+  is_free_.assign(num_pages_, false);
+  for (page_id_t page_id = 0; page_id < header.num_pages_; ++page_id) {
+    is_free_[page_id] = ((bitmap[page_id / 8] >> (page_id % 8)) & 1) != 0;
+  }
+  num_free_ = std::count(is_free_.begin(), is_free_.end(), true);
+  file_name_ = file_name;
+  return true;
+}
+
+auto PageAllocator::Save(const std::string &file_name) -> bool {
+  std::vector<char> bitmap;
+  FreeSpaceMapHeader header{FREE_SPACE_MAP_MAGIC, 0};
+  size_t num_recycled;
+  {
+    std::lock_guard<std::mutex> lock(latch_);
+    num_recycled = num_recycled_;
+    header.num_pages_ = num_pages_;
+    bitmap.assign((num_pages_ + 7) / 8, 0);
+    for (page_id_t page_id = first_free_; page_id < num_pages_; ++page_id) {
+      if (is_free_[page_id]) {
+        bitmap[page_id / 8] = static_cast<char>(bitmap[page_id / 8] | 1 << (page_id % 8));
+      }
+    }
+  }
+
+  // Write a new file and rename it over the old one, so that a crash never leaves a torn map behind.
+  auto tmp_file_name = file_name + ".tmp";
+  std::ofstream out(tmp_file_name, std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  out.write(bitmap.data(), static_cast<std::streamsize>(bitmap.size()));
+  out.close();
+  if (out.fail()) {
+    LOG_DEBUG("I/O error while writing the free-space map");
+    std::remove(tmp_file_name.c_str());
+    return false;
+  }
+  if (std::rename(tmp_file_name.c_str(), file_name.c_str()) != 0) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(latch_);
+  if (num_recycled_ != num_recycled) {
+    // a page free in the bitmap was handed out while it was written
+    std::remove(file_name.c_str());
+    return false;
+  }
+  file_name_ = file_name;
+  return true;
+}
+
+auto PageAllocator::Allocate(bool *is_recycled) -> page_id_t {
+  std::lock_guard<std::mutex> lock(latch_);
+  if (num_free_ == 0) {
+    *is_recycled = false;
+    is_free_.push_back(false);
+    return num_pages_++;
+  }
+  while (!is_free_[first_free_]) {
+    first_free_++;
+  }
+  if (!file_name_.empty()) {
+    // the saved bitmap marks the page free, it must not be found again after a crash
+    std::remove(file_name_.c_str());
+    file_name_.clear();
+  }
+  auto page_id = first_free_++;
+  is_free_[page_id] = false;
+  num_free_--;
+  num_recycled_++;
+  *is_recycled = true;
+  return page_id;
+}
+
+auto PageAllocator::AllocateExtent(page_id_t num_pages) -> page_id_t {
+  BUSTUB_ASSERT(num_pages > 0, "an extent holds at least one page");
+  std::lock_guard<std::mutex> lock(latch_);
+  auto first_page_id = num_pages_;
+  num_pages_ += num_pages;
+  is_free_.resize(num_pages_, false);
+  return first_page_id;
+}
+
+void PageAllocator::Unallocate(page_id_t page_id, bool is_recycled) {
+  {
+    std::lock_guard<std::mutex> lock(latch_);
+    if (!is_recycled && page_id == num_pages_ - 1) {
+      // nothing was allocated since, the file does not have to grow after all
+      is_free_.pop_back();
+      num_pages_--;
+      return;
+    }
+  }
+  Deallocate(page_id);
+}
+
+void PageAllocator::Deallocate(page_id_t page_id) {
+  std::lock_guard<std::mutex> lock(latch_);
+  if (page_id < 0 || page_id >= num_pages_ || is_free_[page_id]) {
+    return;
+  }
+  is_free_[page_id] = true;
+  num_free_++;
+  first_free_ = std::min(first_free_, page_id);
+}
+
+auto PageAllocator::IsAllocated(page_id_t page_id) -> bool {
+  std::lock_guard<std::mutex> lock(latch_);
+  return page_id >= 0 && page_id < num_pages_ && !is_free_[page_id];
+}
+
+auto PageAllocator::GetNumPages() -> page_id_t {
+  std::lock_guard<std::mutex> lock(latch_);
+  return num_pages_;
+}
+
+auto PageAllocator::GetNumFreePages() -> size_t {
+  std::lock_guard<std::mutex> lock(latch_);
+  return num_free_;
+}
+
+}  // namespace bustub
@@ -102,4 +102,27 @@ void WritePageGuard::Drop() {
 }
 
 WritePageGuard::~WritePageGuard() { Drop(); }  // NOLINT
+
+OptimisticReadPageGuard::OptimisticReadPageGuard(BufferPoolManager *bpm, Page *page) : guard_(bpm, page) {
+  if (page != nullptr) {
+    version_ = page->OptimisticRLatch();
+  }
+}
+
+OptimisticReadPageGuard::OptimisticReadPageGuard(OptimisticReadPageGuard &&that) noexcept
+    : guard_(std::move(that.guard_)), version_(that.version_) {}
+
+auto OptimisticReadPageGuard::operator=(OptimisticReadPageGuard &&that) noexcept -> OptimisticReadPageGuard & {
+  guard_ = std::move(that.guard_);
+  version_ = that.version_;
+  return *this;
+}
+
+void OptimisticReadPageGuard::Drop() { guard_.Drop(); }
+
+auto OptimisticReadPageGuard::Validate() -> bool { return guard_.page_->OptimisticValidate(version_); }
+
+void OptimisticReadPageGuard::Restart() { version_ = guard_.page_->OptimisticRLatch(); }
+
+OptimisticReadPageGuard::~OptimisticReadPageGuard() { Drop(); }  // NOLINT
 }  // namespace bustub
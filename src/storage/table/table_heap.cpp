@@ -28,7 +28,7 @@ namespace bustub {
 
 TableHeap::TableHeap(BufferPoolManager *bpm) : bpm_(bpm) {
   // Initialize the first table page.
-  auto guard = bpm->NewPageGuarded(&first_page_id_);
+  auto guard = BasicPageGuard{bpm, NewTablePage(&first_page_id_)};
   last_page_id_ = first_page_id_;
   auto first_page = guard.AsMut<TablePage>();
   BUSTUB_ASSERT(first_page != nullptr,
@@ -36,6 +36,27 @@ TableHeap::TableHeap(BufferPoolManager *bpm) : bpm_(bpm) {
   first_page->Init();
 }
 
+TableHeap::~TableHeap() {
+  if (next_extent_page_id_ < extent_end_page_id_) {
+    bpm_->ReleaseExtent(next_extent_page_id_, extent_end_page_id_ - next_extent_page_id_);
+  }
+}
+
+auto TableHeap::NewTablePage(page_id_t *page_id) -> Page * {
+  if (next_extent_page_id_ == extent_end_page_id_) {
+    next_extent_page_id_ = bpm_->AllocateExtent(EXTENT_SIZE);
+    extent_end_page_id_ = next_extent_page_id_ + EXTENT_SIZE;
+  }
+  auto *page = bpm_->NewPageInExtent(next_extent_page_id_);
+  if (page == nullptr) {
+    // keep the id for the next attempt
+    *page_id = INVALID_PAGE_ID;
+    return nullptr;
+  }
+  *page_id = next_extent_page_id_++;
+  return page;
+}
+
 auto TableHeap::InsertTuple(const TupleMeta &meta, const Tuple &tuple, LockManager *lock_mgr, Transaction *txn,
                             table_oid_t oid) -> std::optional<RID> {
   std::unique_lock<std::mutex> guard(latch_);
@@ -50,7 +71,7 @@ auto TableHeap::InsertTuple(const TupleMeta &meta, const Tuple &tuple, LockManag
     BUSTUB_ENSURE(page->GetNumTuples() != 0, "tuple is too large, cannot insert");
 
     page_id_t next_page_id = INVALID_PAGE_ID;
-    auto npg = bpm_->NewPage(&next_page_id);
+    auto npg = NewTablePage(&next_page_id);
     BUSTUB_ENSURE(next_page_id != INVALID_PAGE_ID, "cannot allocate page");
 
     page->SetNextPageId(next_page_id);
@@ -91,8 +112,8 @@ void TableHeap::UpdateTupleMeta(const TupleMeta &meta, RID rid) {
   page->UpdateTupleMeta(meta, rid);
 }
 
-auto TableHeap::GetTuple(RID rid) -> std::pair<TupleMeta, Tuple> {
-  auto page_guard = bpm_->FetchPageRead(rid.GetPageId());
+auto TableHeap::GetTuple(RID rid, AccessType access_type) -> std::pair<TupleMeta, Tuple> {
+  auto page_guard = bpm_->FetchPageRead(rid.GetPageId(), access_type);
   auto page = page_guard.As<TablePage>();
   auto [meta, tuple] = page->GetTuple(rid);
   tuple.rid_ = rid;
@@ -0,0 +1,102 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// arc_replacer_test.cpp
+//
+// Identification: test/buffer/arc_replacer_test.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <vector>
+
+#include "buffer/arc_replacer.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+TEST(ARCReplacerTest, SampleTest) {
+  ARCReplacer arc_replacer(4);
+
+  // Scenario: frames 0-3 hold pages 10-13, all of them go to T1. Page 10 is used again and moves to T2.
+  for (frame_id_t i = 0; i < 4; i++) {
+    arc_replacer.RecordAccess(i, AccessType::Get, 10 + i);
+  }
+  arc_replacer.RecordAccess(0, AccessType::Get, 10);
+  EXPECT_EQ(4, arc_replacer.Size());
+  EXPECT_EQ(0, arc_replacer.GetTarget());
+
+  // Scenario: T1 is above its target, so the victims come from its LRU end. Pages 11 and 12 become B1 ghosts.
+  int value;
+  ASSERT_TRUE(arc_replacer.Evict(&value));
+  EXPECT_EQ(1, value);
+  ASSERT_TRUE(arc_replacer.Evict(&value));
+  EXPECT_EQ(2, value);
+
+  // Scenario: page 11 comes back while it is a B1 ghost. T1 was too small, the target grows and the page goes to T2.
+  arc_replacer.RecordAccess(1, AccessType::Get, 11);
+  EXPECT_EQ(1, arc_replacer.GetTarget());
+
+  // Scenario: T1 (frame 3) is at its target, so the victim is the LRU frame of T2, and page 10 becomes a B2 ghost.
+  EXPECT_EQ((std::vector<frame_id_t>{0, 1, 3}), arc_replacer.EvictionCandidates(4));
+  ASSERT_TRUE(arc_replacer.Evict(&value));
+  EXPECT_EQ(0, value);
+
+  // Scenario: page 10 comes back while it is a B2 ghost. T2 was too small, the target shrinks again.
+  arc_replacer.RecordAccess(0, AccessType::Get, 10);
+  EXPECT_EQ(0, arc_replacer.GetTarget());
+  ASSERT_TRUE(arc_replacer.Evict(&value));
+  EXPECT_EQ(3, value);
+
+  // Scenario: a scan bringing back the B1 ghost page 12 neither adapts the target nor goes to T2.
+  arc_replacer.RecordAccess(2, AccessType::Scan, 12);
+  EXPECT_EQ(0, arc_replacer.GetTarget());
+  EXPECT_EQ((std::vector<frame_id_t>{2, 1, 0}), arc_replacer.EvictionCandidates(4));
+
+  // Scenario: with frame 2 pinned, T1 has nothing to evict and the victim comes from T2.
+  arc_replacer.SetEvictable(2, false);
+  EXPECT_EQ(2, arc_replacer.Size());
+  ASSERT_TRUE(arc_replacer.Evict(&value));
+  EXPECT_EQ(1, value);
+  arc_replacer.Remove(0);
+  EXPECT_FALSE(arc_replacer.Evict(&value));
+  arc_replacer.SetEvictable(2, true);
+  ASSERT_TRUE(arc_replacer.Evict(&value));
+  EXPECT_EQ(2, value);
+  EXPECT_EQ(0, arc_replacer.Size());
+}
+
+TEST(ARCReplacerTest, RestoreTest) {
+  ARCReplacer arc_replacer(4);
+  for (frame_id_t i = 0; i < 3; i++) {
+    arc_replacer.RecordAccess(i, AccessType::Get, 10 + i);
+  }
+  arc_replacer.RecordAccess(2, AccessType::Get, 12);
+
+  // Scenario: an eviction the caller takes back is no ghost hit, the target stays and the frame returns to the LRU
+  // end of T1.
+  int value;
+  ASSERT_TRUE(arc_replacer.Evict(&value));
+  EXPECT_EQ(0, value);
+  arc_replacer.Restore(0, 10);
+  EXPECT_EQ(0, arc_replacer.GetTarget());
+  EXPECT_EQ(3, arc_replacer.Size());
+  EXPECT_EQ((std::vector<frame_id_t>{0, 1, 2}), arc_replacer.EvictionCandidates(4));
+
+  // Scenario: the page is no ghost anymore, evicting it for real and loading it again counts once.
+  ASSERT_TRUE(arc_replacer.Evict(&value));
+  EXPECT_EQ(0, value);
+  arc_replacer.RecordAccess(0, AccessType::Get, 10);
+  EXPECT_EQ(1, arc_replacer.GetTarget());
+
+  // Scenario: T1 is at its target, a frame taken back from T2 goes back to the LRU end of T2.
+  ASSERT_TRUE(arc_replacer.Evict(&value));
+  EXPECT_EQ(2, value);
+  arc_replacer.Restore(2, 12);
+  EXPECT_EQ(1, arc_replacer.GetTarget());
+  EXPECT_EQ((std::vector<frame_id_t>{2, 0, 1}), arc_replacer.EvictionCandidates(4));
+}
+
+}  // namespace bustub
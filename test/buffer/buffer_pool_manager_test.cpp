@@ -12,11 +12,23 @@
 
 #include "buffer/buffer_pool_manager.h"
 
+#include <atomic>
+#include <chrono>  // NOLINT
 #include <cstdio>
+#include <fstream>
+#include <map>
 #include <random>
+#include <sstream>
 #include <string>
+#include <thread>  // NOLINT
+#include <vector>
 
+#include "buffer/page_table.h"
+#include "common/bustub_instance.h"
+#include "common/util/compression_util.h"
 #include "gtest/gtest.h"
+#include "storage/disk/disk_manager_memory.h"
+#include "storage/disk/disk_manager_snapshot.h"
 
 namespace bustub {
 
@@ -82,6 +94,7 @@ TEST(BufferPoolManagerTest, BinaryDataTest) {
   // Shutdown the disk manager and remove the temporary file we created.
   disk_manager->ShutDown();
   remove("test.db");
+  remove(disk_manager->GetChecksumFileName().c_str());
 
   delete bpm;
   delete disk_manager;
@@ -139,9 +152,994 @@ TEST(BufferPoolManagerTest, SampleTest) {
   // Shutdown the disk manager and remove the temporary file we created.
   disk_manager->ShutDown();
   remove("test.db");
+  remove(disk_manager->GetChecksumFileName().c_str());
 
   delete bpm;
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, ShardedTest) {
+  const size_t buffer_pool_size = 16;
+  const size_t num_shards = 4;
+  const size_t num_pages = 64;
+  const size_t num_threads = 4;
+  const size_t k = 2;
+
+  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get(), k, nullptr, num_shards);
+  EXPECT_EQ(num_shards, bpm->GetNumShards());
+
+  // Scenario: page ids are still handed out sequentially, and pages spill over all shards.
+  for (size_t i = 0; i < num_pages; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(static_cast<page_id_t>(i), page_id);
+    snprintf(page->GetData(), BUSTUB_PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+
+  // Scenario: concurrent readers on different shards always see the content of the page they asked for.
+  std::vector<std::thread> threads;
+  for (size_t tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([&bpm, tid] {
+      for (size_t round = 0; round < 10; ++round) {
+        for (size_t i = tid; i < num_pages; i += num_threads) {
+          auto page_id = static_cast<page_id_t>(i);
+          auto guard = bpm->FetchPageRead(page_id);
+          EXPECT_EQ(page_id, guard.PageId());
+          EXPECT_EQ("page " + std::to_string(page_id), std::string(guard.GetData()));
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // Scenario: a shard only has buffer_pool_size / num_shards frames, pinning them all makes new pages in it fail.
+  std::vector<page_id_t> pinned;
+  for (size_t i = 0; i < buffer_pool_size / num_shards; ++i) {
+    auto page_id = static_cast<page_id_t>(i * num_shards);
+    ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+    pinned.push_back(page_id);
+  }
+  page_id_t page_id_temp;
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id_temp));
+  EXPECT_TRUE(bpm->UnpinPage(pinned.back(), false));
+  EXPECT_NE(nullptr, bpm->NewPage(&page_id_temp));
+  EXPECT_EQ(static_cast<page_id_t>(num_pages), page_id_temp);
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, PageTableTest) {
+  const size_t max_entries = 64;
+  PageTable page_table(max_entries);
+  std::map<page_id_t, frame_id_t> expected;
+
+  // Scenario: random inserts and erases over a small key range, so probe chains collide and get shifted back.
+  std::mt19937 gen(15445);
+  std::uniform_int_distribution<page_id_t> page_dist(0, 2 * max_entries);
+  for (size_t i = 0; i < 10000; ++i) {
+    auto page_id = page_dist(gen);
+    if (expected.count(page_id) == 0 && expected.size() < max_entries) {
+      auto frame_id = static_cast<frame_id_t>(i % max_entries);
+      page_table.Insert(page_id, frame_id);
+      expected[page_id] = frame_id;
+    } else if (expected.count(page_id) != 0) {
+      page_table.Erase(page_id);
+      expected.erase(page_id);
+    }
+    for (page_id_t probe = 0; probe <= static_cast<page_id_t>(2 * max_entries); ++probe) {
+      auto it = expected.find(probe);
+      ASSERT_EQ(it == expected.end() ? -1 : it->second, page_table.Find(probe));
+    }
+  }
+  EXPECT_EQ(expected.size(), page_table.GetPageIds().size());
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, LatchFreeHitTest) {
+  const size_t buffer_pool_size = 16;
+  const size_t num_shards = 2;
+  const size_t num_pages = 32;
+  const size_t num_threads = 8;
+
+  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get(), 2, nullptr, num_shards);
+  for (size_t i = 0; i < num_pages; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), BUSTUB_PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+
+  // Scenario: hits race with evictions of the same frames, a lookup must never hand out a frame that holds another
+  // page, and every pin must be dropped again.
+  std::vector<std::thread> threads;
+  for (size_t tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([&bpm, tid] {
+      std::mt19937 gen(tid);
+      std::uniform_int_distribution<page_id_t> page_dist(0, num_pages - 1);
+      for (size_t round = 0; round < 2000; ++round) {
+        auto page_id = page_dist(gen);
+        auto *page = bpm->FetchPage(page_id);
+        if (page == nullptr) {
+          continue;
+        }
+        EXPECT_EQ(page_id, page->GetPageId());
+        page->RLatch();
+        EXPECT_EQ("page " + std::to_string(page_id), std::string(page->GetData()));
+        page->RUnlatch();
+        EXPECT_TRUE(bpm->UnpinPage(page_id, round % 4 == 0));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // every frame is unpinned again, so all pages can be deleted
+  for (size_t i = 0; i < num_pages; ++i) {
+    auto *page = bpm->FetchPage(static_cast<page_id_t>(i));
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(1, page->GetPinCount());
+    EXPECT_TRUE(bpm->UnpinPage(static_cast<page_id_t>(i), false));
+    EXPECT_FALSE(bpm->UnpinPage(static_cast<page_id_t>(i), false));
+    EXPECT_TRUE(bpm->DeletePage(static_cast<page_id_t>(i)));
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, ResizeTest) {
+  const size_t buffer_pool_size = 8;
+  const size_t max_pool_size = 32;
+  const size_t num_shards = 2;
+
+  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get(), 2, nullptr, num_shards,
+                                                 ReplacerPolicy::LRUK, max_pool_size);
+  EXPECT_EQ(max_pool_size, bpm->GetMaxPoolSize());
+  EXPECT_FALSE(bpm->Resize(max_pool_size + 1));
+  EXPECT_FALSE(bpm->Resize(num_shards - 1));
+
+  // Scenario: after growing, more pages can be pinned at once.
+  ASSERT_TRUE(bpm->Resize(max_pool_size));
+  EXPECT_EQ(max_pool_size, bpm->GetPoolSize());
+  std::vector<page_id_t> page_ids;
+  for (size_t i = 0; i < max_pool_size; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), BUSTUB_PAGE_SIZE, "page %d", page_id);
+    page_ids.push_back(page_id);
+  }
+  page_id_t page_id_temp;
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id_temp));
+
+  // Scenario: shrinking waits for pinned pages and writes dirty pages back, nothing is lost.
+  std::thread unpinner([&bpm, &page_ids] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    for (auto page_id : page_ids) {
+      EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+    }
+  });
+  ASSERT_TRUE(bpm->Resize(buffer_pool_size));
+  unpinner.join();
+  EXPECT_EQ(buffer_pool_size, bpm->GetPoolSize());
+  for (auto page_id : page_ids) {
+    auto guard = bpm->FetchPageRead(page_id);
+    EXPECT_EQ("page " + std::to_string(page_id), std::string(guard.GetData()));
+  }
+  std::vector<page_id_t> pinned;
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    auto page_id = page_ids[i];
+    ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+    pinned.push_back(page_id);
+  }
+  EXPECT_EQ(nullptr, bpm->FetchPage(page_ids.back()));
+  for (auto page_id : pinned) {
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+
+  // Scenario: shrinking gives up if pages stay pinned. The frames it retired in the meantime come back, so the pool
+  // keeps its size and can hold every page at once again.
+  ASSERT_TRUE(bpm->Resize(max_pool_size));
+  for (size_t i = 0; i < max_pool_size; i += 2) {
+    ASSERT_NE(nullptr, bpm->FetchPage(page_ids[i]));
+  }
+  auto old_resize_timeout = resize_timeout;
+  resize_timeout = std::chrono::milliseconds(20);
+  EXPECT_FALSE(bpm->Resize(buffer_pool_size));
+  resize_timeout = old_resize_timeout;
+  EXPECT_EQ(max_pool_size, bpm->GetPoolSize());
+  for (size_t i = 0; i < max_pool_size; ++i) {
+    auto *page = bpm->FetchPage(page_ids[i]);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ("page " + std::to_string(page_ids[i]), std::string(page->GetData()));
+  }
+  for (size_t i = 0; i < max_pool_size; ++i) {
+    EXPECT_TRUE(bpm->UnpinPage(page_ids[i], false));
+    if (i % 2 == 0) {
+      EXPECT_TRUE(bpm->UnpinPage(page_ids[i], false));
+    }
+  }
+  ASSERT_TRUE(bpm->Resize(buffer_pool_size));
+
+  // Scenario: readers keep going while the pool grows and shrinks under them.
+  std::atomic<bool> stop{false};
+  std::vector<std::thread> readers;
+  for (size_t tid = 0; tid < 4; ++tid) {
+    readers.emplace_back([&bpm, &page_ids, &stop, tid] {
+      std::mt19937 gen(tid);
+      std::uniform_int_distribution<size_t> dist(0, page_ids.size() - 1);
+      while (!stop) {
+        auto page_id = page_ids[dist(gen)];
+        auto *page = bpm->FetchPage(page_id);
+        if (page == nullptr) {
+          continue;
+        }
+        page->RLatch();
+        EXPECT_EQ("page " + std::to_string(page_id), std::string(page->GetData()));
+        page->RUnlatch();
+        EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+      }
+    });
+  }
+  for (size_t round = 0; round < 20; ++round) {
+    ASSERT_TRUE(bpm->Resize(round % 2 == 0 ? max_pool_size : buffer_pool_size));
+  }
+  stop = true;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, BatchFetchTest) {
+  const size_t buffer_pool_size = 16;
+  const size_t num_pages = 32;
+  const size_t latency_ms = 20;
+
+  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get());
+  for (size_t i = 0; i < num_pages; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), BUSTUB_PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  bpm->FlushAllPages();
+
+  // Scenario: pages 0-7 were evicted long ago, pages 24-31 are buffered. The misses are read concurrently, so the
+  // batch takes about one device latency instead of eight. Page 0 shows up twice, but is pinned and latched once.
+  disk_manager->SetLatency(latency_ms);
+  std::vector<page_id_t> page_ids{0, 1, 2, 3, 24, 25, 4, 5, 6, 7, 0};
+  auto start = std::chrono::steady_clock::now();
+  auto guards = bpm->FetchPagesRead(page_ids);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  disk_manager->SetLatency(0);
+  EXPECT_LT(elapsed, std::chrono::milliseconds(4 * latency_ms));
+  ASSERT_EQ(page_ids.size(), guards.size());
+  for (size_t i = 0; i + 1 < page_ids.size(); ++i) {
+    EXPECT_EQ(page_ids[i], guards[i].PageId());
+    EXPECT_EQ("page " + std::to_string(page_ids[i]), std::string(guards[i].GetData()));
+  }
+  EXPECT_EQ(INVALID_PAGE_ID, guards.back().PageId());
+  EXPECT_EQ(1, bpm->FetchPage(0)->GetPinCount() - 1);
+  EXPECT_TRUE(bpm->UnpinPage(0, false));
+
+  // Scenario: a batch larger than the pool gets frames for as many pages as fit, the rest of the guards are empty.
+  guards.clear();
+  std::vector<page_id_t> all_page_ids;
+  for (size_t i = 0; i < num_pages; ++i) {
+    all_page_ids.push_back(static_cast<page_id_t>(i));
+  }
+  guards = bpm->FetchPagesRead(all_page_ids);
+  size_t fetched = 0;
+  for (size_t i = 0; i < num_pages; ++i) {
+    if (guards[i].PageId() != INVALID_PAGE_ID) {
+      EXPECT_EQ("page " + std::to_string(i), std::string(guards[i].GetData()));
+      fetched++;
+    }
+  }
+  EXPECT_EQ(buffer_pool_size, fetched);
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, StatsTest) {
+  const size_t buffer_pool_size = 4;
+  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get());
+
+  // Scenario: creating twice as many dirty pages as fit evicts and writes back the first half, without any fetches.
+  for (size_t i = 0; i < 2 * buffer_pool_size; ++i) {
+    page_id_t page_id;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  auto stats = bpm->GetStats();
+  EXPECT_EQ(0, stats.TotalHits());
+  EXPECT_EQ(0, stats.TotalMisses());
+  EXPECT_EQ(buffer_pool_size, stats.evictions_);
+  EXPECT_EQ(buffer_pool_size, stats.foreground_write_backs_);
+  // the LRU-K victim is always the top of a heap
+  EXPECT_EQ(buffer_pool_size, stats.evict_calls_);
+  EXPECT_EQ(buffer_pool_size, stats.evict_scan_length_);
+
+  // Scenario: hits and misses are counted per access type.
+  ASSERT_NE(nullptr, bpm->FetchPage(7, AccessType::Get));
+  ASSERT_NE(nullptr, bpm->FetchPage(0, AccessType::Scan));
+  EXPECT_TRUE(bpm->UnpinPage(7, false));
+  EXPECT_TRUE(bpm->UnpinPage(0, false));
+  auto guards = bpm->FetchPagesRead({0, 1}, AccessType::Index);
+  guards.clear();
+  stats = bpm->GetStats();
+  EXPECT_EQ(1, stats.hits_[static_cast<size_t>(AccessType::Get)]);
+  EXPECT_EQ(1, stats.misses_[static_cast<size_t>(AccessType::Scan)]);
+  EXPECT_EQ(1, stats.hits_[static_cast<size_t>(AccessType::Index)]);
+  EXPECT_EQ(1, stats.misses_[static_cast<size_t>(AccessType::Index)]);
+  EXPECT_EQ(2, stats.TotalHits());
+  EXPECT_EQ(2, stats.TotalMisses());
+  EXPECT_EQ(buffer_pool_size + 2, stats.evictions_);
+  EXPECT_NE(std::string::npos, stats.ToString().find("hits_get=1\n"));
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, WarmRestartTest) {
+  const std::string db_name = "warm_restart_test.db";
+  const size_t buffer_pool_size = 8;
+  const size_t restart_pool_size = 4;
+  const size_t num_pages = 32;
+  const std::vector<page_id_t> hot_pages{3, 7, 11, 15};
+
+  remove(db_name.c_str());
+  auto disk_manager = std::make_unique<DiskManager>(db_name);
+  auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get());
+  for (size_t i = 0; i < num_pages; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), BUSTUB_PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  bpm->FlushAllPages();
+  // every hot page gets a full K-history, which makes it hotter than the pages that were only created
+  for (auto page_id : hot_pages) {
+    for (size_t i = 0; i < LRUK_REPLACER_K; ++i) {
+      ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+      EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+    }
+  }
+
+  // Scenario: after a restart with a smaller pool, the hottest pages are read back in without being asked for.
+  bpm.reset();
+  disk_manager->ShutDown();
+  disk_manager = std::make_unique<DiskManager>(db_name);
+  bpm = std::make_unique<BufferPoolManager>(restart_pool_size, disk_manager.get());
+  for (size_t i = 0; i < 1000 && bpm->GetStats().warm_up_loads_ < restart_pool_size; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(restart_pool_size, bpm->GetStats().warm_up_loads_);
+  for (auto page_id : hot_pages) {
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ("page " + std::to_string(page_id), std::string(page->GetData()));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  EXPECT_EQ(hot_pages.size(), bpm->GetStats().TotalHits());
+  EXPECT_EQ(0, bpm->GetStats().TotalMisses());
+
+  // Scenario: new pages are allocated after the ones on disk instead of overwriting them.
+  page_id_t page_id;
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_EQ(num_pages, page_id);
+  EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+
+  bpm.reset();
+  disk_manager->ShutDown();
+  remove(db_name.c_str());
+  remove("warm_restart_test.log");
+  remove(disk_manager->GetWarmFileName().c_str());
+  remove(disk_manager->GetFreeSpaceMapFileName().c_str());
+  remove(disk_manager->GetChecksumFileName().c_str());
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, FlushAllPagesTest) {
+  const std::string db_name = "flush_all_pages_test.db";
+  const size_t buffer_pool_size = 16;
+  const size_t num_shards = 4;
+
+  remove(db_name.c_str());
+  auto disk_manager = std::make_unique<DiskManager>(db_name);
+  auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get(), LRUK_REPLACER_K, nullptr,
+                                                 num_shards);
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), BUSTUB_PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+
+  // Scenario: the dirty pages of all shards are written back, in batches that do not pin the whole pool.
+  bpm->FlushAllPages();
+  EXPECT_EQ(static_cast<int>(buffer_pool_size), disk_manager->GetNumWrites());
+  EXPECT_EQ(static_cast<int64_t>(buffer_pool_size) * BUSTUB_PAGE_SIZE, disk_manager->GetDbFileSize());
+
+  // Scenario: clean pages are not written again, and pinned dirty pages are written too.
+  auto *page = bpm->FetchPage(3);
+  ASSERT_NE(nullptr, page);
+  snprintf(page->GetData(), BUSTUB_PAGE_SIZE, "page 3 again");
+  EXPECT_TRUE(bpm->UnpinPage(3, true));
+  page = bpm->FetchPage(7);
+  ASSERT_NE(nullptr, page);
+  snprintf(page->GetData(), BUSTUB_PAGE_SIZE, "page 7 again");
+  EXPECT_TRUE(bpm->UnpinPage(7, true));
+  ASSERT_NE(nullptr, bpm->FetchPage(7));
+  bpm->FlushAllPages();
+  EXPECT_EQ(static_cast<int>(buffer_pool_size) + 2, disk_manager->GetNumWrites());
+  EXPECT_TRUE(bpm->UnpinPage(7, false));
+
+  std::vector<char> data(BUSTUB_PAGE_SIZE);
+  disk_manager->ReadPage(3, data.data());
+  EXPECT_EQ("page 3 again", std::string(data.data()));
+  disk_manager->ReadPage(7, data.data());
+  EXPECT_EQ("page 7 again", std::string(data.data()));
+  disk_manager->ReadPage(12, data.data());
+  EXPECT_EQ("page 12", std::string(data.data()));
+
+  bpm.reset();
+  disk_manager->ShutDown();
+  remove(db_name.c_str());
+  remove("flush_all_pages_test.log");
+  remove(disk_manager->GetWarmFileName().c_str());
+  remove(disk_manager->GetFreeSpaceMapFileName().c_str());
+  remove(disk_manager->GetChecksumFileName().c_str());
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, PageRecyclingTest) {
+  const std::string db_name = "page_recycling_test.db";
+  const size_t buffer_pool_size = 4;
+  const size_t num_pages = 8;
+
+  remove(db_name.c_str());
+  auto disk_manager = std::make_unique<DiskManager>(db_name);
+  auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get());
+  for (size_t i = 0; i < num_pages; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(static_cast<page_id_t>(i), page_id);
+    snprintf(page->GetData(), BUSTUB_PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  bpm->FlushAllPages();
+
+  // Scenario: the ids of deleted pages are handed out again, lowest first, and start out zeroed instead of being
+  // read back from disk.
+  EXPECT_TRUE(bpm->DeletePage(5));
+  EXPECT_TRUE(bpm->DeletePage(2));
+  EXPECT_TRUE(bpm->DeletePage(6));
+  page_id_t page_id;
+  auto *page = bpm->NewPage(&page_id);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(2, page_id);
+  EXPECT_EQ(std::string(BUSTUB_PAGE_SIZE, '\0'), std::string(page->GetData(), BUSTUB_PAGE_SIZE));
+  EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+
+  // Scenario: a failed NewPage does not use up a page id.
+  std::vector<page_id_t> pinned_pages;
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    pinned_pages.push_back(page_id);
+  }
+  EXPECT_EQ((std::vector<page_id_t>{5, 6, 8, 9}), pinned_pages);
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id));
+  for (auto pinned_page_id : pinned_pages) {
+    EXPECT_TRUE(bpm->UnpinPage(pinned_page_id, false));
+  }
+  EXPECT_TRUE(bpm->DeletePage(9));
+  EXPECT_TRUE(bpm->DeletePage(3));
+
+  // Scenario: the free pages survive a restart, and recycled pages overwrite their old content on disk.
+  bpm.reset();
+  disk_manager->ShutDown();
+  disk_manager = std::make_unique<DiskManager>(db_name);
+  bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get());
+  page = bpm->FetchPage(2);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ("", std::string(page->GetData()));
+  EXPECT_TRUE(bpm->UnpinPage(2, false));
+  page = bpm->FetchPage(7);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ("page 7", std::string(page->GetData()));
+  EXPECT_TRUE(bpm->UnpinPage(7, false));
+  for (auto expected_page_id : {3, 9, 10}) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_EQ(expected_page_id, page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+
+  // Scenario: the saved map is deleted before a page it marks free is handed out, so that a crash cannot hand the
+  // page out a second time.
+  const auto &fsm_file_name = disk_manager->GetFreeSpaceMapFileName();
+  EXPECT_TRUE(bpm->DeletePage(4));
+  bpm->FlushAllPages();
+  EXPECT_TRUE(std::ifstream(fsm_file_name).good());
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_EQ(4, page_id);
+  EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  EXPECT_FALSE(std::ifstream(fsm_file_name).good());
+
+  bpm.reset();
+  disk_manager->ShutDown();
+  remove(db_name.c_str());
+  remove("page_recycling_test.log");
+  remove(disk_manager->GetWarmFileName().c_str());
+  remove(disk_manager->GetFreeSpaceMapFileName().c_str());
+  remove(disk_manager->GetChecksumFileName().c_str());
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, ExtentAllocationTest) {
+  const size_t buffer_pool_size = 8;
+  const page_id_t extent_size = 4;
+
+  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get());
+
+  // Scenario: extents are runs of consecutive ids that single-page allocations do not interleave with.
+  page_id_t page_id;
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_EQ(0, page_id);
+  EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  auto first_extent = bpm->AllocateExtent(extent_size);
+  EXPECT_EQ(1, first_extent);
+  auto second_extent = bpm->AllocateExtent(extent_size);
+  EXPECT_EQ(first_extent + extent_size, second_extent);
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_EQ(second_extent + extent_size, page_id);
+  EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+
+  // Scenario: pages created in an extent keep their reserved ids and start out zeroed.
+  for (page_id_t i = 0; i < extent_size; ++i) {
+    auto *page = bpm->NewPageInExtent(first_extent + i);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(first_extent + i, page->GetPageId());
+    EXPECT_EQ(std::string(BUSTUB_PAGE_SIZE, '\0'), std::string(page->GetData(), BUSTUB_PAGE_SIZE));
+    snprintf(page->GetData(), BUSTUB_PAGE_SIZE, "page %d", first_extent + i);
+    EXPECT_TRUE(bpm->UnpinPage(first_extent + i, true));
+  }
+  bpm->FlushAllPages();
+  auto *page = bpm->FetchPage(first_extent + 2);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ("page " + std::to_string(first_extent + 2), std::string(page->GetData()));
+  EXPECT_TRUE(bpm->UnpinPage(first_extent + 2, false));
+
+  // Scenario: the unused ids of a released extent are recycled by NewPage, lowest first.
+  auto *second_page = bpm->NewPageInExtent(second_extent);
+  ASSERT_NE(nullptr, second_page);
+  EXPECT_TRUE(bpm->UnpinPage(second_extent, false));
+  bpm->ReleaseExtent(second_extent + 1, extent_size - 1);
+  for (page_id_t i = 1; i < extent_size; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_EQ(second_extent + i, page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+
+  // Scenario: a reserved id stays usable when no frame is available for it.
+  std::vector<page_id_t> pinned_pages;
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    pinned_pages.push_back(page_id);
+  }
+  auto third_extent = bpm->AllocateExtent(extent_size);
+  EXPECT_EQ(nullptr, bpm->NewPageInExtent(third_extent));
+  EXPECT_TRUE(bpm->UnpinPage(pinned_pages[0], false));
+  ASSERT_NE(nullptr, bpm->NewPageInExtent(third_extent));
+  EXPECT_TRUE(bpm->UnpinPage(third_extent, false));
+  for (auto pinned_page_id : pinned_pages) {
+    bpm->UnpinPage(pinned_page_id, false);
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, ReadOnlySnapshotTest) {
+  const std::string db_name = "read_only_snapshot_test.db";
+  const size_t buffer_pool_size = 4;
+  const size_t num_pages = 16;
+
+  remove(db_name.c_str());
+  auto disk_manager = std::make_unique<DiskManager>(db_name);
+  auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get());
+  for (size_t i = 0; i < num_pages; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), BUSTUB_PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  bpm->FlushAllPages();
+  bpm.reset();
+  disk_manager->ShutDown();
+  // the last page is corrupted on disk
+  {
+    std::fstream file(db_name, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(static_cast<std::streamoff>(num_pages - 1) * BUSTUB_PAGE_SIZE);
+    file.put('X');
+  }
+
+  // Scenario: fetches point straight into the mapping, more pages than there are frames can be held at once.
+  auto snapshot = std::make_unique<DiskManagerSnapshot>(db_name);
+  bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, snapshot.get());
+  EXPECT_TRUE(bpm->IsReadOnly());
+  EXPECT_EQ(static_cast<page_id_t>(num_pages), snapshot->GetNumPages());
+  std::vector<ReadPageGuard> guards;
+  for (page_id_t page_id = 0; page_id < static_cast<page_id_t>(num_pages) - 1; ++page_id) {
+    guards.push_back(bpm->FetchPageRead(page_id));
+    EXPECT_EQ(snapshot->GetMappedData() + static_cast<size_t>(page_id) * BUSTUB_PAGE_SIZE, guards.back().GetData());
+    EXPECT_EQ("page " + std::to_string(page_id), std::string(guards.back().GetData()));
+  }
+  guards.clear();
+  auto batch = bpm->FetchPagesRead({3, 1, 3});
+  EXPECT_EQ("page 1", std::string(batch[1].GetData()));
+  EXPECT_EQ("page 3", std::string(batch[0].GetData()));
+  EXPECT_EQ(INVALID_PAGE_ID, batch[2].PageId());
+  batch.clear();
+  EXPECT_EQ(0U, bpm->GetStats().TotalMisses());
+
+  // Scenario: a page that does not match its checksum is not handed out.
+  EXPECT_EQ(nullptr, bpm->FetchPage(static_cast<page_id_t>(num_pages) - 1));
+  EXPECT_EQ(1, snapshot->GetNumChecksumFailures());
+
+  // Scenario: nothing can be created, modified or deleted, and pages beyond the file do not exist.
+  page_id_t page_id;
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id));
+  EXPECT_EQ(INVALID_PAGE_ID, bpm->FetchPageWrite(0).PageId());
+  EXPECT_THROW(bpm->FetchPageBasic(0).GetDataMut(), ExecutionException);
+  EXPECT_EQ(nullptr, bpm->FetchPage(static_cast<page_id_t>(num_pages)));
+  EXPECT_FALSE(bpm->DeletePage(0));
+  EXPECT_FALSE(bpm->UnpinPage(0, true));
+  EXPECT_FALSE(snapshot->WritePage(0, std::string(BUSTUB_PAGE_SIZE, 'x').data()));
+  bpm.reset();
+
+  // Scenario: a read-only instance answers queries on the mock tables, and rejects everything else.
+  auto instance = std::make_unique<BustubInstance>(new DiskManagerSnapshot(db_name));
+  instance->GenerateMockTable();
+  std::stringstream result;
+  SimpleStreamWriter writer(result, true);
+  instance->ExecuteSql("SELECT colA FROM __mock_table_1 WHERE colA = 1;", writer);
+  EXPECT_EQ("1\t\n", result.str());
+  EXPECT_THROW(instance->ExecuteSql("CREATE TABLE t (a INT);", writer), Exception);
+  instance.reset();
+
+  bpm.reset();
+  snapshot.reset();
+  remove(db_name.c_str());
+  remove("read_only_snapshot_test.log");
+  remove(disk_manager->GetWarmFileName().c_str());
+  remove(disk_manager->GetFreeSpaceMapFileName().c_str());
+  remove(disk_manager->GetChecksumFileName().c_str());
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, VictimCacheTest) {
+  // Scenario: pages compress without loss, random data does not compress at all.
+  std::vector<char> data(BUSTUB_PAGE_SIZE, 0);
+  std::vector<char> decompressed(BUSTUB_PAGE_SIZE);
+  std::string compressed;
+  EXPECT_TRUE(CompressionUtil::Compress(data.data(), data.size(), &compressed));
+  EXPECT_LT(compressed.size(), 64);
+  EXPECT_TRUE(CompressionUtil::Decompress(compressed.data(), compressed.size(), decompressed.data(), data.size()));
+  EXPECT_EQ(data, decompressed);
+  for (size_t i = 0; i < data.size() / 16; ++i) {
+    snprintf(&data[i * 16], 16, "tuple %zu", i * 7919 % 1000);
+  }
+  EXPECT_TRUE(CompressionUtil::Compress(data.data(), data.size(), &compressed));
+  EXPECT_TRUE(CompressionUtil::Decompress(compressed.data(), compressed.size(), decompressed.data(), data.size()));
+  EXPECT_EQ(data, decompressed);
+  EXPECT_FALSE(CompressionUtil::Decompress(compressed.data(), compressed.size() / 2, decompressed.data(), data.size()));
+  std::mt19937 gen(42);
+  for (auto &byte : data) {
+    byte = static_cast<char>(gen());
+  }
+  EXPECT_FALSE(CompressionUtil::Compress(data.data(), data.size(), &compressed));
+
+  const size_t buffer_pool_size = 4;
+  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get());
+  bpm->SetVictimCacheBudget(16 * BUSTUB_PAGE_SIZE);
+  for (size_t i = 0; i < 2 * buffer_pool_size; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), BUSTUB_PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+
+  // Scenario: the evicted pages come back from the victim cache, and their fetches push the others into it.
+  for (page_id_t page_id = 0; page_id < static_cast<page_id_t>(buffer_pool_size); ++page_id) {
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ("page " + std::to_string(page_id), std::string(page->GetData()));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  auto stats = bpm->GetStats();
+  EXPECT_EQ(buffer_pool_size, stats.victim_cache_hits_);
+  EXPECT_EQ(buffer_pool_size, stats.victim_cache_pages_);
+  EXPECT_LT(stats.victim_cache_bytes_, buffer_pool_size * BUSTUB_PAGE_SIZE);
+
+  // Scenario: deleted pages are dropped from the cache, and a zero budget drops everything.
+  EXPECT_TRUE(bpm->DeletePage(5));
+  EXPECT_EQ(buffer_pool_size - 1, bpm->GetStats().victim_cache_pages_);
+  bpm->SetVictimCacheBudget(0);
+  EXPECT_EQ(0, bpm->GetStats().victim_cache_pages_);
+  auto *page = bpm->FetchPage(4);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ("page 4", std::string(page->GetData()));
+  EXPECT_TRUE(bpm->UnpinPage(4, false));
+  EXPECT_EQ(buffer_pool_size, bpm->GetStats().victim_cache_hits_);
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, ReplacerPolicyTest) {
+  const size_t buffer_pool_size = 8;
+  const size_t num_pages = 32;
+
+  for (auto policy : {ReplacerPolicy::LRUK, ReplacerPolicy::LRU, ReplacerPolicy::Clock, ReplacerPolicy::ARC}) {
+    auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+    auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get(), 2, nullptr, 2, policy);
+
+    // Scenario: every policy evicts and writes back pages correctly when the pool overflows.
+    for (size_t i = 0; i < num_pages; ++i) {
+      page_id_t page_id;
+      auto *page = bpm->NewPage(&page_id);
+      ASSERT_NE(nullptr, page);
+      snprintf(page->GetData(), BUSTUB_PAGE_SIZE, "page %d", page_id);
+      EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+    }
+    for (size_t round = 0; round < 3; ++round) {
+      for (size_t i = 0; i < num_pages; ++i) {
+        auto page_id = static_cast<page_id_t>(i);
+        auto guard = bpm->FetchPageRead(page_id, round % 2 == 0 ? AccessType::Get : AccessType::Scan);
+        EXPECT_EQ("page " + std::to_string(page_id), std::string(guard.GetData()));
+      }
+    }
+
+    // Scenario: pinned frames are never picked as victims.
+    std::vector<BasicPageGuard> pinned;
+    for (size_t i = 0; i < buffer_pool_size; ++i) {
+      pinned.push_back(bpm->FetchPageBasic(static_cast<page_id_t>(i)));
+    }
+    page_id_t page_id_temp;
+    EXPECT_EQ(nullptr, bpm->NewPage(&page_id_temp));
+    pinned.clear();
+    EXPECT_NE(nullptr, bpm->NewPage(&page_id_temp));
+  }
+}
+
+TEST(BufferPoolManagerTest, FrameArenaTest) {
+  const size_t buffer_pool_size = 600;
+
+  // Scenario: the frames are one huge-page-aligned region, unless the build allocates them one by one for ASAN.
+  FrameArena arena(buffer_pool_size);
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    auto *data = arena.GetFrameData(static_cast<frame_id_t>(i));
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(data) % BUSTUB_PAGE_SIZE);
+    if (arena.IsContiguous()) {
+      EXPECT_EQ(arena.GetFrameData(0) + i * BUSTUB_PAGE_SIZE, data);
+    }
+  }
+  if (arena.IsContiguous()) {
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(arena.GetFrameData(0)) % FRAME_ARENA_ALIGNMENT);
+  }
+
+  // Scenario: every page's metadata starts on its own cache line, and frames start out zeroed.
+  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get());
+  EXPECT_EQ(0, sizeof(Page) % CACHE_LINE_SIZE);
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    auto *page = &bpm->GetPages()[i];
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(page) % CACHE_LINE_SIZE);
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(page->GetData()) % BUSTUB_PAGE_SIZE);
+    EXPECT_EQ(0, page->GetData()[i % BUSTUB_PAGE_SIZE]);
+  }
+}
+
+TEST(BufferPoolManagerTest, MissDoesNotBlockHitTest) {
+  const size_t buffer_pool_size = 3;
+  const size_t k = 2;
+  const size_t latency_ms = 500;
+
+  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get(), k);
+
+  page_id_t page_ids[4];
+  for (auto &page_id : page_ids) {
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), BUSTUB_PAGE_SIZE, "page %d", page_id);
+    bpm->UnpinPage(page_id, true);
+  }
+  disk_manager->SetLatency(latency_ms);
+
+  // Page 0 was evicted by page 3. Two threads miss on it, which writes back a dirty victim and reads page 0.
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 2; i++) {
+    threads.emplace_back([&bpm, &page_ids] {
+      auto guard = bpm->FetchPageRead(page_ids[0]);
+      EXPECT_EQ("page " + std::to_string(page_ids[0]), std::string(guard.GetData()));
+    });
+  }
+
+  // Scenario: while the miss is waiting for the disk, a hit on a resident page is served right away.
+  std::this_thread::sleep_for(std::chrono::milliseconds(latency_ms / 5));
+  auto start = std::chrono::steady_clock::now();
+  {
+    auto guard = bpm->FetchPageRead(page_ids[3]);
+    EXPECT_EQ("page " + std::to_string(page_ids[3]), std::string(guard.GetData()));
+  }
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(latency_ms / 2));
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // Scenario: both requesters shared the single copy of page 0 that was read in.
+  auto *page0 = bpm->FetchPage(page_ids[0]);
+  EXPECT_EQ(1, page0->GetPinCount());
+  EXPECT_TRUE(bpm->UnpinPage(page_ids[0], false));
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, PageCleanerTest) {
+  const size_t buffer_pool_size = 10;
+  const size_t k = 2;
+
+  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get(), k);
+  bpm->StartPageCleaner(0.5, 0.2);
+
+  // Scenario: dirtying the whole pool wakes the cleaner up, which cleans it down to the low watermark.
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), BUSTUB_PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  for (int i = 0; i < 100 && bpm->GetBackgroundWriteBacks() < buffer_pool_size - 2; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_GE(bpm->GetBackgroundWriteBacks(), buffer_pool_size - 2);
+
+  // Scenario: replacing the whole pool now mostly finds clean victims.
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    page_id_t page_id;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  EXPECT_LE(bpm->GetForegroundWriteBacks(), 2);
+  bpm->StopPageCleaner();
+
+  // Scenario: what the cleaner wrote back can be read again.
+  for (page_id_t page_id = 0; page_id < static_cast<page_id_t>(buffer_pool_size); ++page_id) {
+    auto guard = bpm->FetchPageRead(page_id);
+    EXPECT_EQ("page " + std::to_string(page_id), std::string(guard.GetData()));
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, ReadAheadTest) {
+  const size_t buffer_pool_size = 64;
+  const size_t num_pages = 2 * buffer_pool_size;
+  const size_t window = 8;
+  const size_t k = 2;
+  const size_t latency_ms = 20;
+
+  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get(), k);
+
+  // Build a chain of pages, every page stores the id of its successor in its first bytes.
+  for (size_t i = 0; i < num_pages; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    *reinterpret_cast<page_id_t *>(page->GetData()) = i + 1 < num_pages ? page_id + 1 : INVALID_PAGE_ID;
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  bpm->FlushAllPages();
+  disk_manager->SetLatency(latency_ms);
+
+  // Scenario: the first pages of the chain were evicted, reading ahead brings the next window in the background.
+  bpm->ReadAhead(0, window, [](const char *data) { return *reinterpret_cast<const page_id_t *>(data); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(4 * window * latency_ms));
+
+  auto start = std::chrono::steady_clock::now();
+  for (page_id_t page_id = 0; page_id < static_cast<page_id_t>(window); ++page_id) {
+    auto guard = bpm->FetchPageRead(page_id);
+    EXPECT_EQ(page_id + 1, *guard.As<page_id_t>());
+  }
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(latency_ms));
+
+  // Scenario: with every frame dirty, reading ahead stops instead of writing pages back on its own.
+  disk_manager->SetLatency(0);
+  for (page_id_t page_id = num_pages - buffer_pool_size; page_id < static_cast<page_id_t>(num_pages); ++page_id) {
+    ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  auto num_writes = disk_manager->GetNumWrites();
+  auto scan_misses = bpm->GetStats().misses_[static_cast<size_t>(AccessType::Scan)];
+  bpm->ReadAhead(0, window, [](const char *data) { return *reinterpret_cast<const page_id_t *>(data); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(num_writes, disk_manager->GetNumWrites());
+  EXPECT_EQ(scan_misses, bpm->GetStats().misses_[static_cast<size_t>(AccessType::Scan)]);
+}
+
+/** A disk manager whose writes fail while fail_writes_ is set, and whose reads fail while fail_reads_ is. */
+class FailingDiskManager : public DiskManagerUnlimitedMemory {
+ public:
+  auto WritePage(page_id_t page_id, const char *page_data) -> bool override {
+    return !fail_writes_ && DiskManagerUnlimitedMemory::WritePage(page_id, page_data);
+  }
+
+  auto ReadPage(page_id_t page_id, char *page_data) -> bool override {
+    return DiskManagerUnlimitedMemory::ReadPage(page_id, page_data) && !fail_reads_;
+  }
+
+  std::atomic<bool> fail_writes_{false};
+  std::atomic<bool> fail_reads_{false};
+};
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, FailedWriteTest) {
+  const size_t buffer_pool_size = 1;
+  const size_t k = 2;
+
+  auto disk_manager = std::make_unique<FailingDiskManager>();
+  auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get(), k);
+
+  page_id_t page_id0;
+  auto *page0 = bpm->NewPage(&page_id0);
+  ASSERT_NE(nullptr, page0);
+  snprintf(page0->GetData(), BUSTUB_PAGE_SIZE, "page 0");
+  EXPECT_TRUE(bpm->UnpinPage(page_id0, true));
+  disk_manager->fail_writes_ = true;
+
+  // Scenario: a flush that fails reports it and leaves the page dirty.
+  EXPECT_FALSE(bpm->FlushPage(page_id0));
+  EXPECT_TRUE(page0->IsDirty());
+
+  // Scenario: a dirty page that cannot be written back is not evicted, the page that needed its frame is not created.
+  page_id_t page_id1;
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id1));
+  {
+    auto guard = bpm->FetchPageRead(page_id0);
+    EXPECT_EQ("page 0", std::string(guard.GetData()));
+  }
+  EXPECT_TRUE(page0->IsDirty());
+
+  // Scenario: once the disk works again, the page is written back and its frame can be reused.
+  disk_manager->fail_writes_ = false;
+  bpm->FlushAllPages();
+  EXPECT_FALSE(page0->IsDirty());
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id1));
+  EXPECT_TRUE(bpm->UnpinPage(page_id1, false));
+
+  // Scenario: a page that cannot be read, e.g. one that does not match its checksum, is not fetched, and its frame
+  // is not lost.
+  disk_manager->fail_reads_ = true;
+  EXPECT_EQ(nullptr, bpm->FetchPage(page_id0));
+  EXPECT_EQ(INVALID_PAGE_ID, bpm->FetchPagesRead({page_id0})[0].PageId());
+  disk_manager->fail_reads_ = false;
+  auto guard = bpm->FetchPageRead(page_id0);
+  EXPECT_EQ("page 0", std::string(guard.GetData()));
+}
+
 }  // namespace bustub
@@ -11,6 +11,7 @@
 //===----------------------------------------------------------------------===//
 
 #include <cstdio>
+#include <set>
 #include <thread>  // NOLINT
 #include <vector>
 
@@ -19,44 +20,90 @@
 
 namespace bustub {
 
-TEST(ClockReplacerTest, DISABLED_SampleTest) {
+TEST(ClockReplacerTest, SampleTest) {
   ClockReplacer clock_replacer(7);
 
-  // Scenario: unpin six elements, i.e. add them to the replacer.
-  clock_replacer.Unpin(1);
-  clock_replacer.Unpin(2);
-  clock_replacer.Unpin(3);
-  clock_replacer.Unpin(4);
-  clock_replacer.Unpin(5);
-  clock_replacer.Unpin(6);
-  clock_replacer.Unpin(1);
+  // Scenario: access six frames, i.e. add them to the replacer with their reference bit set.
+  for (frame_id_t i = 1; i <= 6; i++) {
+    clock_replacer.RecordAccess(i);
+  }
   EXPECT_EQ(6, clock_replacer.Size());
 
-  // Scenario: get three victims from the clock.
+  // Scenario: get three victims from the clock. The first sweep only clears reference bits.
   int value;
-  clock_replacer.Victim(&value);
+  clock_replacer.Evict(&value);
   EXPECT_EQ(1, value);
-  clock_replacer.Victim(&value);
+  clock_replacer.Evict(&value);
   EXPECT_EQ(2, value);
-  clock_replacer.Victim(&value);
+  clock_replacer.Evict(&value);
   EXPECT_EQ(3, value);
 
-  // Scenario: pin elements in the replacer.
-  // Note that 3 has already been victimized, so pinning 3 should have no effect.
-  clock_replacer.Pin(3);
-  clock_replacer.Pin(4);
+  // Scenario: pin frames in the replacer.
+  // Note that 3 has already been evicted, so pinning 3 should have no effect.
+  clock_replacer.SetEvictable(3, false);
+  clock_replacer.SetEvictable(4, false);
   EXPECT_EQ(2, clock_replacer.Size());
 
-  // Scenario: unpin 4. We expect that the reference bit of 4 will be set to 1.
-  clock_replacer.Unpin(4);
-
-  // Scenario: continue looking for victims. We expect these victims.
-  clock_replacer.Victim(&value);
-  EXPECT_EQ(5, value);
-  clock_replacer.Victim(&value);
+  // Scenario: access 5. We expect that the reference bit of 5 will be set to 1, so it gets a second chance.
+  clock_replacer.RecordAccess(5);
+  clock_replacer.Evict(&value);
   EXPECT_EQ(6, value);
-  clock_replacer.Victim(&value);
+
+  // Scenario: unpin 4. Its reference bit was cleared by the first sweep.
+  clock_replacer.SetEvictable(4, true);
+  clock_replacer.Evict(&value);
   EXPECT_EQ(4, value);
+  clock_replacer.Evict(&value);
+  EXPECT_EQ(5, value);
+
+  // Scenario: a scan does not set the reference bit, so the scanned frame goes before the accessed one.
+  clock_replacer.RecordAccess(3, AccessType::Get);
+  clock_replacer.RecordAccess(2, AccessType::Scan);
+  EXPECT_EQ((std::vector<frame_id_t>{2, 3}), clock_replacer.EvictionCandidates(7));
+  clock_replacer.Evict(&value);
+  EXPECT_EQ(2, value);
+  clock_replacer.Remove(3);
+  EXPECT_FALSE(clock_replacer.Evict(&value));
+  EXPECT_EQ(0, clock_replacer.Size());
+}
+
+TEST(ClockReplacerTest, ConcurrentAccessTest) {
+  const size_t num_frames = 64;
+  ClockReplacer clock_replacer(num_frames);
+  for (size_t i = 0; i < num_frames; i++) {
+    clock_replacer.RecordAccess(static_cast<frame_id_t>(i));
+  }
+
+  // Scenario: threads keep pinning, accessing and unpinning their own frames while one thread evicts.
+  std::vector<std::thread> threads;
+  for (size_t tid = 0; tid < 4; tid++) {
+    threads.emplace_back([&clock_replacer, tid] {
+      for (size_t round = 0; round < 1000; round++) {
+        auto frame_id = static_cast<frame_id_t>(tid * 8 + round % 8);
+        clock_replacer.SetEvictable(frame_id, false);
+        clock_replacer.RecordAccess(frame_id);
+        clock_replacer.SetEvictable(frame_id, true);
+      }
+    });
+  }
+  int value;
+  for (size_t i = 0; i < num_frames / 2; i++) {
+    // frames 32-63 are never touched by the threads, so there is always something to evict
+    ASSERT_TRUE(clock_replacer.Evict(&value));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // Scenario: the size still matches the frames that can actually be evicted, and no frame is evicted twice.
+  auto size = clock_replacer.Size();
+  EXPECT_EQ(size, clock_replacer.EvictionCandidates(num_frames).size());
+  std::set<frame_id_t> victims;
+  while (clock_replacer.Evict(&value)) {
+    EXPECT_TRUE(victims.insert(value).second);
+  }
+  EXPECT_EQ(size, victims.size());
+  EXPECT_EQ(0, clock_replacer.Size());
 }
 
 }  // namespace bustub
@@ -95,4 +95,124 @@ TEST(LRUKReplacerTest, SampleTest) {
   ASSERT_EQ(false, lru_replacer.Evict(&value));
   ASSERT_EQ(0, lru_replacer.Size());
 }
+TEST(LRUKReplacerTest, ScanResistanceTest) {
+  LRUKReplacer lru_replacer(8, 2);
+
+  // Scenario: frames 0-3 are hot pages of point lookups with a full K-history.
+  for (int i = 0; i < 4; i++) {
+    lru_replacer.RecordAccess(i, AccessType::Get);
+    lru_replacer.RecordAccess(i, AccessType::Get);
+    lru_replacer.SetEvictable(i, true);
+  }
+
+  // Scenario: a scan runs over frames 4-7. Scanning frame 0 too does not refresh its history.
+  for (int i = 4; i < 8; i++) {
+    lru_replacer.RecordAccess(i, AccessType::Scan);
+    lru_replacer.RecordAccess(i, AccessType::Scan);
+    lru_replacer.SetEvictable(i, true);
+  }
+  lru_replacer.RecordAccess(0, AccessType::Scan);
+  ASSERT_EQ(8, lru_replacer.Size());
+
+  // Scenario: a point lookup on frame 5 takes it out of the scan ring. The ring of the remaining scan frames is
+  // larger than 8 / LRUK_SCAN_RING_RATIO = 2 frames, so it recycles its own frames first, oldest first, although
+  // they were accessed more recently than the hot frames.
+  lru_replacer.RecordAccess(5, AccessType::Get);
+  int value;
+  ASSERT_TRUE(lru_replacer.Evict(&value));
+  ASSERT_EQ(4, value);
+  ASSERT_TRUE(lru_replacer.Evict(&value));
+  ASSERT_EQ(6, value);
+
+  // Scenario: frame 7 alone is below the ring size, so frame 5 with its single regular access goes next, then the
+  // hot frames in LRU-K order.
+  ASSERT_TRUE(lru_replacer.Evict(&value));
+  ASSERT_EQ(5, value);
+  ASSERT_TRUE(lru_replacer.Evict(&value));
+  ASSERT_EQ(0, value);
+  ASSERT_EQ(4, lru_replacer.Size());
+
+  // Scenario: a pinned scan frame is skipped, and removing it works like for any other frame.
+  lru_replacer.RecordAccess(4, AccessType::Scan);
+  lru_replacer.SetEvictable(4, false);
+  ASSERT_EQ(4, lru_replacer.Size());
+  ASSERT_TRUE(lru_replacer.Evict(&value));
+  ASSERT_EQ(7, value);
+  ASSERT_TRUE(lru_replacer.Evict(&value));
+  ASSERT_EQ(1, value);
+  lru_replacer.SetEvictable(4, true);
+  lru_replacer.Remove(4);
+  ASSERT_EQ(2, lru_replacer.Size());
+}
+
+TEST(LRUKReplacerTest, IndexResidencyTest) {
+  LRUKReplacer lru_replacer(8, 2);
+
+  // Scenario: frames 0 and 1 hold index pages, frames 2 and 3 data pages with a full K-history. Index frames are
+  // evicted after the data frames, least recently used first.
+  lru_replacer.RecordAccess(0, AccessType::Index);
+  lru_replacer.RecordAccess(1, AccessType::Index);
+  for (int i = 2; i < 4; i++) {
+    lru_replacer.RecordAccess(i, AccessType::Get);
+    lru_replacer.RecordAccess(i, AccessType::Get);
+  }
+  lru_replacer.RecordAccess(1, AccessType::Index);
+  ASSERT_EQ(4, lru_replacer.Size());
+  ASSERT_EQ((std::vector<frame_id_t>{2, 3, 0, 1}), lru_replacer.EvictionCandidates(8));
+  int value;
+  for (int expected : {2, 3, 0, 1}) {
+    ASSERT_TRUE(lru_replacer.Evict(&value));
+    ASSERT_EQ(expected, value);
+  }
+
+  // Scenario: three index frames exceed the cap of 8 / LRUK_INDEX_RESIDENCY_RATIO = 2 frames, so the least recently
+  // used one goes before the data frame. An index access also takes frame 6 out of the scan ring.
+  lru_replacer.RecordAccess(4, AccessType::Index);
+  lru_replacer.RecordAccess(5, AccessType::Index);
+  lru_replacer.RecordAccess(6, AccessType::Scan);
+  lru_replacer.RecordAccess(6, AccessType::Index);
+  lru_replacer.RecordAccess(7, AccessType::Get);
+  ASSERT_EQ((std::vector<frame_id_t>{4, 7, 5, 6}), lru_replacer.EvictionCandidates(8));
+  for (int expected : {4, 7, 5, 6}) {
+    ASSERT_TRUE(lru_replacer.Evict(&value));
+    ASSERT_EQ(expected, value);
+  }
+  ASSERT_FALSE(lru_replacer.Evict(&value));
+}
+
+TEST(LRUKReplacerTest, LargeReplacerTest) {
+  const size_t num_frames = 1000;
+  LRUKReplacer lru_replacer(num_frames, 3);
+
+  // Scenario: access every frame three times in a shuffled order. The victim order is the order of the
+  // third most recent accesses, i.e. the order of the first round.
+  std::vector<std::vector<frame_id_t>> rounds(3);
+  std::mt19937 gen(15445);
+  for (auto &round : rounds) {
+    for (size_t i = 0; i < num_frames; i++) {
+      round.push_back(static_cast<frame_id_t>(i));
+    }
+    std::shuffle(round.begin(), round.end(), gen);
+    for (auto frame_id : round) {
+      lru_replacer.RecordAccess(frame_id);
+    }
+  }
+  ASSERT_EQ(num_frames, lru_replacer.Size());
+
+  // Scenario: pin every other frame of the first round, the others still go in order.
+  for (size_t i = 0; i < num_frames; i += 2) {
+    lru_replacer.SetEvictable(rounds[0][i], false);
+  }
+  ASSERT_EQ(num_frames / 2, lru_replacer.Size());
+  auto candidates = lru_replacer.EvictionCandidates(num_frames);
+  ASSERT_EQ(num_frames / 2, candidates.size());
+  int value;
+  for (size_t i = 1; i < num_frames; i += 2) {
+    ASSERT_EQ(rounds[0][i], candidates[i / 2]);
+    ASSERT_TRUE(lru_replacer.Evict(&value));
+    ASSERT_EQ(rounds[0][i], value);
+  }
+  ASSERT_FALSE(lru_replacer.Evict(&value));
+}
+
 }  // namespace bustub
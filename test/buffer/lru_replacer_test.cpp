@@ -19,44 +19,43 @@
 
 namespace bustub {
 
-TEST(LRUReplacerTest, DISABLED_SampleTest) {
+TEST(LRUReplacerTest, SampleTest) {
   LRUReplacer lru_replacer(7);
 
-  // Scenario: unpin six elements, i.e. add them to the replacer.
-  lru_replacer.Unpin(1);
-  lru_replacer.Unpin(2);
-  lru_replacer.Unpin(3);
-  lru_replacer.Unpin(4);
-  lru_replacer.Unpin(5);
-  lru_replacer.Unpin(6);
-  lru_replacer.Unpin(1);
+  // Scenario: access six frames, i.e. add them to the replacer. Frames start out evictable.
+  for (frame_id_t i = 1; i <= 6; i++) {
+    lru_replacer.RecordAccess(i);
+  }
+  lru_replacer.RecordAccess(1);
   EXPECT_EQ(6, lru_replacer.Size());
 
-  // Scenario: get three victims from the lru.
+  // Scenario: get three victims from the lru. Frame 1 was used again, so it went to the front.
   int value;
-  lru_replacer.Victim(&value);
-  EXPECT_EQ(1, value);
-  lru_replacer.Victim(&value);
+  lru_replacer.Evict(&value);
   EXPECT_EQ(2, value);
-  lru_replacer.Victim(&value);
+  lru_replacer.Evict(&value);
   EXPECT_EQ(3, value);
+  lru_replacer.Evict(&value);
+  EXPECT_EQ(4, value);
 
-  // Scenario: pin elements in the replacer.
-  // Note that 3 has already been victimized, so pinning 3 should have no effect.
-  lru_replacer.Pin(3);
-  lru_replacer.Pin(4);
+  // Scenario: pin frames in the replacer.
+  // Note that 4 has already been evicted, so pinning 4 should have no effect.
+  lru_replacer.SetEvictable(4, false);
+  lru_replacer.SetEvictable(5, false);
   EXPECT_EQ(2, lru_replacer.Size());
 
-  // Scenario: unpin 4. We expect that the reference bit of 4 will be set to 1.
-  lru_replacer.Unpin(4);
+  // Scenario: unpin 5. It is now the most recently used frame.
+  lru_replacer.SetEvictable(5, true);
+  EXPECT_EQ((std::vector<frame_id_t>{6, 1, 5}), lru_replacer.EvictionCandidates(7));
 
   // Scenario: continue looking for victims. We expect these victims.
-  lru_replacer.Victim(&value);
-  EXPECT_EQ(5, value);
-  lru_replacer.Victim(&value);
+  lru_replacer.Evict(&value);
   EXPECT_EQ(6, value);
-  lru_replacer.Victim(&value);
-  EXPECT_EQ(4, value);
+  lru_replacer.Remove(1);
+  lru_replacer.Evict(&value);
+  EXPECT_EQ(5, value);
+  EXPECT_FALSE(lru_replacer.Evict(&value));
+  EXPECT_EQ(0, lru_replacer.Size());
 }
 
 }  // namespace bustub
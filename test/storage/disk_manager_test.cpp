@@ -10,11 +10,21 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <chrono>  // NOLINT
 #include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
 
 #include "common/exception.h"
+#include "common/util/checksum_util.h"
 #include "gtest/gtest.h"
 #include "storage/disk/disk_manager.h"
+#include "storage/disk/disk_manager_simulated.h"
 
 namespace bustub {
 
@@ -24,12 +34,14 @@ class DiskManagerTest : public ::testing::Test {
   void SetUp() override {
     remove("test.db");
     remove("test.log");
+    remove("test.crc");
   }
 
   // This function is called after every test.
   void TearDown() override {
     remove("test.db");
     remove("test.log");
+    remove("test.crc");
   };
 };
 
@@ -55,6 +67,88 @@ TEST_F(DiskManagerTest, ReadWritePageTest) {
   dm.ShutDown();
 }
 
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, LargeOffsetTest) {
+  char buf[BUSTUB_PAGE_SIZE] = {0};
+  char data[BUSTUB_PAGE_SIZE] = {0};
+  std::string db_file("test.db");
+  auto dm = DiskManager(db_file);
+  std::strncpy(data, "A test string.", sizeof(data));
+  EXPECT_EQ(0, dm.GetDbFileSize());
+
+  // a page beyond 2 GB, the file stays sparse
+  const page_id_t page_id = (1 << 19) + 1;
+  dm.WritePage(page_id, data);
+  EXPECT_EQ(static_cast<int64_t>(page_id + 1) * BUSTUB_PAGE_SIZE, dm.GetDbFileSize());
+  dm.ReadPage(page_id, buf);
+  EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+  dm.ReadPage(page_id + 1, buf);  // past the end reads zeros
+  EXPECT_EQ(0, buf[0]);
+
+  // smaller writes do not shrink the tracked size, and a reopened file reports the same size
+  dm.WritePage(0, data);
+  EXPECT_EQ(static_cast<int64_t>(page_id + 1) * BUSTUB_PAGE_SIZE, dm.GetDbFileSize());
+  dm.ShutDown();
+  auto reopened = DiskManager(db_file);
+  EXPECT_EQ(static_cast<int64_t>(page_id + 1) * BUSTUB_PAGE_SIZE, reopened.GetDbFileSize());
+  reopened.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, DirectIoTest) {
+  alignas(BUSTUB_PAGE_SIZE) char aligned[BUSTUB_PAGE_SIZE] = {0};
+  char buf[BUSTUB_PAGE_SIZE + 1] = {0};
+  char data[BUSTUB_PAGE_SIZE] = {0};
+  std::string db_file("test.db");
+  auto dm = DiskManager(db_file, true);
+  std::strncpy(data, "A test string.", sizeof(data));
+  if (!dm.IsUsingDirectIo()) {
+    GTEST_SKIP() << "the file system does not support direct I/O";
+  }
+
+  // aligned buffers are transferred as they are, unaligned ones are bounced through an aligned page
+  std::memcpy(aligned, data, sizeof(data));
+  dm.WritePage(0, aligned);
+  dm.WritePage(1, data);
+  dm.ReadPage(1, buf + 1);
+  EXPECT_EQ(std::memcmp(buf + 1, data, sizeof(data)), 0);
+  std::memset(aligned, 0, sizeof(aligned));
+  dm.ReadPage(0, aligned);
+  EXPECT_EQ(std::memcmp(aligned, data, sizeof(data)), 0);
+  dm.ReadPage(2, buf + 1);  // past the end reads zeros
+  EXPECT_EQ(0, buf[1]);
+  EXPECT_EQ(2 * BUSTUB_PAGE_SIZE, dm.GetDbFileSize());
+
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, WritePagesTest) {
+  char buf[BUSTUB_PAGE_SIZE] = {0};
+  std::vector<std::vector<char>> data(8, std::vector<char>(BUSTUB_PAGE_SIZE));
+  std::string db_file("test.db");
+  auto dm = DiskManager(db_file);
+
+  // two runs of neighbouring pages and a single page
+  std::vector<page_id_t> page_ids{0, 1, 2, 5, 6, 9};
+  std::vector<const char *> page_data;
+  for (size_t i = 0; i < page_ids.size(); i++) {
+    snprintf(data[i].data(), BUSTUB_PAGE_SIZE, "page %d", page_ids[i]);
+    page_data.push_back(data[i].data());
+  }
+  dm.WritePages(page_ids, page_data);
+  EXPECT_EQ(static_cast<int>(page_ids.size()), dm.GetNumWrites());
+  EXPECT_EQ(10 * BUSTUB_PAGE_SIZE, dm.GetDbFileSize());
+  for (auto page_id : page_ids) {
+    dm.ReadPage(page_id, buf);
+    EXPECT_EQ("page " + std::to_string(page_id), std::string(buf));
+  }
+  dm.ReadPage(4, buf);
+  EXPECT_EQ("", std::string(buf));
+
+  dm.ShutDown();
+}
+
 // NOLINTNEXTLINE
 TEST_F(DiskManagerTest, ReadWriteLogTest) {
   char buf[16] = {0};
@@ -72,6 +166,241 @@ TEST_F(DiskManagerTest, ReadWriteLogTest) {
   dm.ShutDown();
 }
 
+/** Flip a byte of a page in the database file behind the disk manager's back. */
+static void CorruptPage(const std::string &db_file, page_id_t page_id) {
+  int fd = open(db_file.c_str(), O_RDWR);
+  ASSERT_GE(fd, 0);
+  char byte;
+  auto offset = static_cast<off_t>(page_id) * BUSTUB_PAGE_SIZE + 100;
+  ASSERT_EQ(1, pread(fd, &byte, 1, offset));
+  byte = static_cast<char>(~byte);
+  ASSERT_EQ(1, pwrite(fd, &byte, 1, offset));
+  close(fd);
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, Crc32cTest) {
+  const std::string data = "123456789";
+  EXPECT_EQ(0xE3069283, ChecksumUtil::Crc32c(data.data(), data.size()));
+  EXPECT_EQ(0, ChecksumUtil::Crc32c(data.data(), 0));
+
+  // Scenario: a checksum can be extended piece by piece, across word boundaries.
+  std::vector<char> page(BUSTUB_PAGE_SIZE + 3);
+  for (size_t i = 0; i < page.size(); i++) {
+    page[i] = static_cast<char>(i * 31 + 7);
+  }
+  auto crc = ChecksumUtil::Crc32c(page.data(), page.size());
+  auto first = ChecksumUtil::Crc32c(page.data(), 13);
+  EXPECT_EQ(crc, ChecksumUtil::Crc32c(page.data() + 13, page.size() - 13, first));
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, PageChecksumTest) {
+  char buf[BUSTUB_PAGE_SIZE] = {0};
+  char data[BUSTUB_PAGE_SIZE] = {0};
+  std::string db_file("test.db");
+  std::strncpy(data, "A test string.", sizeof(data));
+  {
+    auto dm = DiskManager(db_file);
+    dm.WritePage(0, data);
+    dm.WritePages({1, 2}, {data, data});
+    EXPECT_TRUE(dm.ReadPage(0, buf));
+    EXPECT_TRUE(dm.ReadPage(2, buf));
+    EXPECT_EQ(0, dm.GetNumChecksumFailures());
+    dm.ShutDown();
+  }
+
+  // Scenario: the checksums survive a restart, reading a corrupted page fails.
+  CorruptPage(db_file, 2);
+  auto dm = DiskManager(db_file);
+  EXPECT_TRUE(dm.ReadPage(0, buf));
+  EXPECT_EQ(0, dm.GetNumChecksumFailures());
+  EXPECT_FALSE(dm.ReadPage(2, buf));
+  EXPECT_EQ(1, dm.GetNumChecksumFailures());
+
+  // Scenario: writing the page again repairs it, and a page that was never written is not verified.
+  dm.WritePage(2, data);
+  EXPECT_TRUE(dm.ReadPage(2, buf));
+  EXPECT_TRUE(dm.ReadPage(10, buf));
+  EXPECT_EQ(1, dm.GetNumChecksumFailures());
+  dm.ShutDown();
+}
+
+/** @return the content of a file */
+static auto ReadFile(const std::string &file_name) -> std::string {
+  std::ifstream file(file_name, std::ios::binary);
+  return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, UncleanShutdownTest) {
+  char buf[BUSTUB_PAGE_SIZE] = {0};
+  char data[BUSTUB_PAGE_SIZE] = {0};
+  std::string db_file("test.db");
+  std::strncpy(data, "A test string.", sizeof(data));
+  {
+    auto dm = DiskManager(db_file);
+    dm.WritePages({0, 1}, {data, data});
+    // what a crash would leave behind: the checksum file is not marked clean while the db is open
+    auto crc_file = ReadFile(dm.GetChecksumFileName());
+    dm.ShutDown();
+    std::ofstream(dm.GetChecksumFileName(), std::ios::binary | std::ios::trunc) << crc_file;
+  }
+
+  // Scenario: after an unclean shutdown, a page that does not match its checksum is still read.
+  CorruptPage(db_file, 1);
+  auto dm = DiskManager(db_file);
+  EXPECT_TRUE(dm.ReadPage(1, buf));
+  EXPECT_EQ(1, dm.GetNumChecksumFailures());
+
+  // Scenario: once the page is written again, its checksum is trusted.
+  dm.WritePage(1, data);
+  CorruptPage(db_file, 1);
+  EXPECT_FALSE(dm.ReadPage(1, buf));
+  EXPECT_EQ(2, dm.GetNumChecksumFailures());
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, ConcurrentWritesTest) {
+  const size_t num_threads = 4;
+  const size_t num_writes = 200;
+  char buf[BUSTUB_PAGE_SIZE] = {0};
+  std::string db_file("test.db");
+  auto dm = DiskManager(db_file);
+
+  // Scenario: threads writing the same page at once, alone and in batches, leave the checksum of the page last written.
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < num_threads; t++) {
+    threads.emplace_back([&, t] {
+      std::vector<char> data(BUSTUB_PAGE_SIZE, static_cast<char>('a' + t));
+      for (size_t i = 0; i < num_writes; i++) {
+        if (i % 2 == 0) {
+          dm.WritePage(0, data.data());
+        } else {
+          dm.WritePages({0, 1}, {data.data(), data.data()});
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_TRUE(dm.ReadPage(0, buf));
+  EXPECT_TRUE(dm.ReadPage(1, buf));
+  EXPECT_EQ(0, dm.GetNumChecksumFailures());
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, ScrubberTest) {
+  const page_id_t num_pages = 64;
+  char data[BUSTUB_PAGE_SIZE] = {0};
+  std::string db_file("test.db");
+  auto dm = DiskManager(db_file);
+  for (page_id_t page_id = 0; page_id < num_pages; page_id++) {
+    snprintf(data, sizeof(data), "page %d", page_id);
+    dm.WritePage(page_id, data);
+  }
+  CorruptPage(db_file, 17);
+
+  // Scenario: the scrubber finds the corrupted page without anyone reading it, at no more than 1 MB/s.
+  auto start = std::chrono::steady_clock::now();
+  dm.StartScrubber(1024 * 1024);
+  while (dm.GetNumScrubPasses() == 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  dm.StopScrubber();
+  EXPECT_GE(elapsed, std::chrono::milliseconds(200));
+  EXPECT_GE(dm.GetNumScrubbedPages(), num_pages);
+  EXPECT_GE(dm.GetNumChecksumFailures(), 1);
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, SimulatedDeviceStorageTest) {
+  char buf[BUSTUB_PAGE_SIZE] = {0};
+  char data[BUSTUB_PAGE_SIZE] = {0};
+  const size_t capacity_pages = 1 << 20;  // 4 GB
+  DiskManagerSimulated dm(DeviceProfile::Instant(), capacity_pages);
+
+  // Scenario: pages far apart only take up the memory of the chunks they are in.
+  EXPECT_EQ(0, dm.GetMemoryUsage());
+  for (page_id_t page_id : {0, 1, static_cast<page_id_t>(capacity_pages - 1)}) {
+    snprintf(data, sizeof(data), "page %d", page_id);
+    dm.WritePage(page_id, data);
+  }
+  EXPECT_EQ(2 * static_cast<size_t>(FRAME_ARENA_ALIGNMENT), dm.GetMemoryUsage());
+  for (page_id_t page_id : {0, 1, static_cast<page_id_t>(capacity_pages - 1)}) {
+    dm.ReadPage(page_id, buf);
+    EXPECT_EQ("page " + std::to_string(page_id), std::string(buf));
+  }
+  EXPECT_EQ(3, dm.GetNumWrites());
+  EXPECT_EQ(3, dm.GetNumReads());
+
+  // Scenario: pages that were never written read as zeros, pages beyond the capacity can be neither read nor written.
+  EXPECT_TRUE(dm.ReadPage(2, buf));
+  EXPECT_EQ("", std::string(buf));
+  EXPECT_FALSE(dm.ReadPage(1 << 24, buf));
+  EXPECT_FALSE(dm.ReadPage(-1, buf));
+  EXPECT_FALSE(dm.WritePage(static_cast<page_id_t>(capacity_pages), data));
+  EXPECT_EQ(3, dm.GetNumWrites());
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, SimulatedDeviceTimingTest) {
+  char buf[BUSTUB_PAGE_SIZE] = {0};
+  DiskManagerSimulated dm;
+  auto time_reads = [&](const std::vector<page_id_t> &page_ids, size_t num_threads) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < num_threads; i++) {
+      threads.emplace_back([&] {
+        char thread_buf[BUSTUB_PAGE_SIZE];
+        for (auto page_id : page_ids) {
+          dm.ReadPage(page_id, thread_buf);
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  };
+
+  // Scenario: a fixed latency is paid by every I/O, and concurrent I/Os overlap unless the queue is full.
+  DeviceProfile profile = DeviceProfile::FixedLatency(2000);
+  dm.SetProfile(profile);
+  EXPECT_GE(time_reads({0, 1}, 1), 4000);
+  EXPECT_LT(time_reads({0}, 4), 4 * 2000);
+  profile.queue_depth_ = 1;
+  dm.SetProfile(profile);
+  EXPECT_GE(time_reads({0}, 4), 4 * 2000);
+
+  // Scenario: transfers share the bandwidth, 4 MB/s move a page in about a millisecond.
+  profile = DeviceProfile::Instant();
+  profile.bandwidth_mb_s_ = 4;
+  dm.SetProfile(profile);
+  EXPECT_GE(time_reads({0, 1, 2, 3, 4}, 2), 10 * BUSTUB_PAGE_SIZE / 4);
+
+  // Scenario: only accesses that do not continue the previous one pay the seek.
+  profile = DeviceProfile::Instant();
+  profile.seek_latency_us_ = 5000;
+  dm.SetProfile(profile);
+  dm.ReadPage(9, buf);
+  EXPECT_LT(time_reads({10, 11, 12, 13}, 1), 5000);
+  EXPECT_GE(time_reads({20}, 1), 5000);
+
+  // Scenario: jittered latencies keep their mean.
+  profile = DeviceProfile::FixedLatency(200);
+  profile.latency_sigma_ = 0.5;
+  dm.SetProfile(profile);
+  auto elapsed = time_reads(std::vector<page_id_t>(100, 0), 1);
+  EXPECT_GE(elapsed, 100 * 100);
+  EXPECT_LT(elapsed, 100 * 600);
+}
+
 // NOLINTNEXTLINE
 TEST_F(DiskManagerTest, ThrowBadFileTest) { EXPECT_THROW(DiskManager("dev/null\\/foo/bar/baz/test.db"), Exception); }
 
@@ -0,0 +1,147 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// disk_scheduler_test.cpp
+//
+// Identification: test/storage/disk_scheduler_test.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <future>  // NOLINT
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "storage/disk/disk_manager_memory.h"
+#include "storage/disk/disk_scheduler.h"
+
+namespace bustub {
+
+class DiskSchedulerTest : public ::testing::TestWithParam<bool> {
+ protected:
+  // This function is called before every test.
+  void SetUp() override {
+    remove("test.db");
+    remove("test.log");
+    remove("test.crc");
+  }
+
+  // This function is called after every test.
+  void TearDown() override {
+    remove("test.db");
+    remove("test.log");
+    remove("test.crc");
+  };
+};
+
+// NOLINTNEXTLINE
+TEST_P(DiskSchedulerTest, ScheduleWriteReadPageTest) {
+  auto dm = std::make_unique<DiskManager>("test.db");
+  auto disk_scheduler = std::make_unique<DiskScheduler>(dm.get(), GetParam());
+
+  // Scenario: a written page reads back, and a page past the end of the file reads as zeros.
+  char buf[BUSTUB_PAGE_SIZE] = {0};
+  char data[BUSTUB_PAGE_SIZE] = {0};
+  std::strncpy(data, "A test string.", sizeof(data));
+  EXPECT_TRUE(disk_scheduler->ScheduleWrite(0, data).get());
+  EXPECT_TRUE(disk_scheduler->ScheduleRead(0, buf).get());
+  EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+  std::memset(buf, 1, sizeof(buf));
+  EXPECT_TRUE(disk_scheduler->ScheduleRead(1, buf).get());
+  EXPECT_EQ(0, buf[BUSTUB_PAGE_SIZE - 1]);
+
+  // Scenario: many more requests than the queue depth are in flight at once, through promises like futures.
+  const size_t num_pages = 4 * DISK_SCHEDULER_QUEUE_DEPTH;
+  std::vector<std::vector<char>> pages(num_pages, std::vector<char>(BUSTUB_PAGE_SIZE));
+  std::vector<std::future<bool>> futures;
+  for (size_t i = 0; i < num_pages; ++i) {
+    snprintf(pages[i].data(), BUSTUB_PAGE_SIZE, "page %zu", i);
+    auto promise = disk_scheduler->CreatePromise();
+    futures.push_back(promise.get_future());
+    disk_scheduler->Schedule({true, pages[i].data(), static_cast<page_id_t>(i), std::move(promise)});
+  }
+  for (auto &future : futures) {
+    EXPECT_TRUE(future.get());
+  }
+  EXPECT_EQ(static_cast<int64_t>(num_pages) * BUSTUB_PAGE_SIZE, dm->GetDbFileSize());
+  for (auto &page : pages) {
+    std::memset(page.data(), 0, page.size());
+  }
+  futures.clear();
+  for (size_t i = 0; i < num_pages; ++i) {
+    futures.push_back(disk_scheduler->ScheduleRead(static_cast<page_id_t>(i), pages[i].data()));
+  }
+  for (size_t i = 0; i < num_pages; ++i) {
+    EXPECT_TRUE(futures[i].get());
+    EXPECT_EQ("page " + std::to_string(i), std::string(pages[i].data()));
+  }
+  EXPECT_EQ(0, dm->GetNumChecksumFailures());
+
+  // Scenario: reading a page corrupted on disk fails, and counts as a checksum failure.
+  int fd = open("test.db", O_RDWR);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(1, pwrite(fd, "X", 1, 5 * BUSTUB_PAGE_SIZE));
+  close(fd);
+  EXPECT_FALSE(disk_scheduler->ScheduleRead(5, buf).get());
+  EXPECT_EQ(1, dm->GetNumChecksumFailures());
+
+  // Scenario: requests still pending when the scheduler goes away are completed first.
+  futures.clear();
+  for (size_t i = 0; i < num_pages; ++i) {
+    futures.push_back(disk_scheduler->ScheduleWrite(static_cast<page_id_t>(i), pages[i].data()));
+  }
+  disk_scheduler.reset();
+  for (auto &future : futures) {
+    EXPECT_TRUE(future.get());
+  }
+  dm->ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_P(DiskSchedulerTest, InMemoryDiskManagerTest) {
+  // Scenario: disk managers without a database file are always served by the thread pool.
+  auto dm = std::make_unique<DiskManagerUnlimitedMemory>();
+  auto disk_scheduler = std::make_unique<DiskScheduler>(dm.get(), GetParam());
+  EXPECT_FALSE(disk_scheduler->IsUsingIoUring());
+  char buf[BUSTUB_PAGE_SIZE] = {0};
+  char data[BUSTUB_PAGE_SIZE] = {0};
+  std::strncpy(data, "A test string.", sizeof(data));
+  EXPECT_TRUE(disk_scheduler->ScheduleWrite(3, data).get());
+  EXPECT_TRUE(disk_scheduler->ScheduleRead(3, buf).get());
+  EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+}
+
+// NOLINTNEXTLINE
+TEST_P(DiskSchedulerTest, DirectIoTest) {
+  auto dm = std::make_unique<DiskManager>("test.db", true);
+  auto disk_scheduler = std::make_unique<DiskScheduler>(dm.get(), GetParam());
+
+  // Scenario: with O_DIRECT, unaligned buffers work like aligned ones.
+  alignas(BUSTUB_PAGE_SIZE) char aligned[BUSTUB_PAGE_SIZE] = {0};
+  char buf[BUSTUB_PAGE_SIZE + 1] = {0};
+  std::strncpy(aligned, "A test string.", sizeof(aligned));
+  EXPECT_TRUE(disk_scheduler->ScheduleWrite(0, aligned).get());
+  EXPECT_TRUE(disk_scheduler->ScheduleRead(0, buf + 1).get());
+  EXPECT_EQ(std::memcmp(buf + 1, aligned, sizeof(aligned)), 0);
+  EXPECT_TRUE(disk_scheduler->ScheduleWrite(1, buf + 1).get());
+  std::memset(aligned, 0, sizeof(aligned));
+  EXPECT_TRUE(disk_scheduler->ScheduleRead(1, aligned).get());
+  EXPECT_EQ(std::memcmp(buf + 1, aligned, sizeof(aligned)), 0);
+
+  disk_scheduler.reset();
+  dm->ShutDown();
+}
+
+INSTANTIATE_TEST_SUITE_P(DiskSchedulerTest, DiskSchedulerTest, ::testing::Bool(),
+                         [](const ::testing::TestParamInfo<bool> &info) {
+                           return info.param ? "IoUring" : "ThreadPool";
+                         });
+
+}  // namespace bustub
@@ -13,6 +13,8 @@
 #include <cstdio>
 #include <random>
 #include <string>
+#include <thread>  // NOLINT
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "storage/disk/disk_manager_memory.h"
@@ -48,4 +50,72 @@ TEST(PageGuardTest, SampleTest) {
   disk_manager->ShutDown();
 }
 
+// NOLINTNEXTLINE
+TEST(PageGuardTest, OptimisticReadTest) {
+  const size_t buffer_pool_size = 5;
+  const size_t k = 2;
+
+  auto disk_manager = std::make_shared<DiskManagerUnlimitedMemory>();
+  auto bpm = std::make_shared<BufferPoolManager>(buffer_pool_size, disk_manager.get(), k);
+
+  page_id_t page_id;
+  auto *page0 = bpm->NewPage(&page_id);
+  EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+
+  // Scenario: an optimistic guard pins the page but holds no latch, a write in between invalidates its reads.
+  {
+    auto guard = bpm->FetchPageOptimistic(page_id);
+    EXPECT_EQ(1, page0->GetPinCount());
+    EXPECT_TRUE(guard.Validate());
+    {
+      auto write_guard = bpm->FetchPageWrite(page_id);
+      EXPECT_EQ(2, page0->GetPinCount());
+      EXPECT_FALSE(guard.Validate());
+      write_guard.AsMut<int>()[0] = 42;
+    }
+    EXPECT_FALSE(guard.Validate());
+    guard.Restart();
+    EXPECT_EQ(42, guard.As<int>()[0]);
+    EXPECT_TRUE(guard.Validate());
+    // plain read latches do not invalidate anything
+    bpm->FetchPageRead(page_id).Drop();
+    EXPECT_TRUE(guard.Validate());
+  }
+  EXPECT_EQ(0, page0->GetPinCount());
+
+  // Scenario: a writer keeps two ints equal, a reader that validates never sees them differ.
+  const int num_writes = 10000;
+  std::thread writer([&bpm, page_id] {
+    for (int i = 1; i <= num_writes; ++i) {
+      auto write_guard = bpm->FetchPageWrite(page_id);
+      auto *data = write_guard.AsMut<int>();
+      data[0] = i;
+      data[1] = i;
+    }
+  });
+  std::vector<std::thread> readers;
+  for (size_t tid = 0; tid < 2; ++tid) {
+    readers.emplace_back([&bpm, page_id] {
+      auto guard = bpm->FetchPageOptimistic(page_id);
+      int last = 0;
+      while (last < num_writes) {
+        const auto *data = reinterpret_cast<const volatile int *>(guard.GetData());
+        int first = data[0];
+        int second = data[1];
+        if (guard.Validate()) {
+          EXPECT_EQ(first, second);
+          last = first;
+        }
+        guard.Restart();
+      }
+    });
+  }
+  writer.join();
+  for (auto &reader : readers) {
+    reader.join();
+  }
+
+  disk_manager->ShutDown();
+}
+
 }  // namespace bustub
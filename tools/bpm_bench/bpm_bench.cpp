@@ -19,7 +19,7 @@
 #include "common/util/string_util.h"
 #include "fmt/core.h"
 #include "fmt/std.h"
-#include "storage/disk/disk_manager_memory.h"
+#include "storage/disk/disk_manager_simulated.h"
 
 #include <sys/time.h>
 
@@ -104,12 +104,19 @@ struct BpmMetrics {
 auto main(int argc, char **argv) -> int {
   using bustub::AccessType;
   using bustub::BufferPoolManager;
-  using bustub::DiskManagerUnlimitedMemory;
+  using bustub::DeviceProfile;
+  using bustub::DiskManagerSimulated;
   using bustub::page_id_t;
+  using bustub::ReplacerPolicy;
 
   argparse::ArgumentParser program("bustub-bpm-bench");
   program.add_argument("--duration").help("run bpm bench for n milliseconds");
   program.add_argument("--latency").help("set disk latency to n milliseconds");
+  program.add_argument("--device").help("simulate a storage device: instant, nvme, ssd or hdd");
+  program.add_argument("--shards").help("partition the buffer pool into n shards");
+  program.add_argument("--page-cleaner").help("run the background page cleaner with this high watermark");
+  program.add_argument("--replacer").help("replacement policy: lru-k (default), lru, clock or arc");
+  program.add_argument("--victim-cache").help("keep evicted pages compressed in a victim cache of n KiB");
 
   try {
     program.parse_args(argc, argv);
@@ -129,12 +136,49 @@ auto main(int argc, char **argv) -> int {
     latency_ms = std::stoi(program.get("--latency"));
   }
 
-  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
-  auto bpm = std::make_unique<BufferPoolManager>(BUSTUB_BPM_SIZE, disk_manager.get(), LRU_K_SIZE);
+  size_t num_shards = 1;
+  if (program.present("--shards")) {
+    num_shards = std::stoi(program.get("--shards"));
+  }
+
+  std::string replacer_name = "lru-k";
+  if (program.present("--replacer")) {
+    replacer_name = program.get("--replacer");
+  }
+  ReplacerPolicy replacer_policy;
+  if (replacer_name == "lru-k") {
+    replacer_policy = ReplacerPolicy::LRUK;
+  } else if (replacer_name == "lru") {
+    replacer_policy = ReplacerPolicy::LRU;
+  } else if (replacer_name == "clock") {
+    replacer_policy = ReplacerPolicy::Clock;
+  } else if (replacer_name == "arc") {
+    replacer_policy = ReplacerPolicy::ARC;
+  } else {
+    std::cerr << "unknown replacer " << replacer_name << std::endl;
+    return 1;
+  }
+
+  std::string device_name = "fixed";
+  auto device = DeviceProfile::FixedLatency(latency_ms * 1000);
+  if (program.present("--device")) {
+    device_name = program.get("--device");
+    auto profile = DeviceProfile::FromName(device_name);
+    if (!profile.has_value()) {
+      std::cerr << "unknown device " << device_name << std::endl;
+      return 1;
+    }
+    device = *profile;
+  }
+
+  auto disk_manager = std::make_unique<DiskManagerSimulated>();
+  auto bpm = std::make_unique<BufferPoolManager>(BUSTUB_BPM_SIZE, disk_manager.get(), LRU_K_SIZE, nullptr, num_shards,
+                                                 replacer_policy);
   std::vector<page_id_t> page_ids;
 
-  fmt::print(stderr, "[info] total_page={}, duration_ms={}, latency_ms={}, lru_k_size={}, bpm_size={}\n",
-             BUSTUB_PAGE_CNT, duration_ms, latency_ms, LRU_K_SIZE, BUSTUB_BPM_SIZE);
+  fmt::print(stderr, "[info] total_page={}, duration_ms={}, latency_ms={}, lru_k_size={}, bpm_size={}, shards={}, ",
+             BUSTUB_PAGE_CNT, duration_ms, latency_ms, LRU_K_SIZE, BUSTUB_BPM_SIZE, num_shards);
+  fmt::print(stderr, "replacer={}, device={}\n", replacer_name, device_name);
 
   for (size_t i = 0; i < BUSTUB_PAGE_CNT; i++) {
     page_id_t page_id;
@@ -150,7 +194,16 @@ auto main(int argc, char **argv) -> int {
   }
 
   // enable disk latency after creating all pages
-  disk_manager->SetLatency(latency_ms);
+  disk_manager->SetProfile(device);
+
+  if (program.present("--page-cleaner")) {
+    auto high_watermark = std::stod(program.get("--page-cleaner"));
+    bpm->StartPageCleaner(high_watermark, high_watermark / 2);
+  }
+
+  if (program.present("--victim-cache")) {
+    bpm->SetVictimCacheBudget(std::stoul(program.get("--victim-cache")) * 1024);
+  }
 
   fmt::print(stderr, "[info] benchmark start\n");
 
@@ -228,5 +281,7 @@ auto main(int argc, char **argv) -> int {
 
   total_metrics.Report();
 
+  fmt::print(stderr, "[info] buffer pool stats:\n{}", bpm->GetStats().ToString());
+
   return 0;
 }
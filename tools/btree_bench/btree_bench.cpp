@@ -19,7 +19,7 @@
 #include "common/rid.h"
 #include "common/util/string_util.h"
 #include "fmt/format.h"
-#include "storage/disk/disk_manager_memory.h"
+#include "storage/disk/disk_manager_simulated.h"
 #include "storage/index/b_plus_tree.h"
 #include "storage/index/generic_key.h"
 #include "test_util.h"
@@ -114,11 +114,13 @@ auto KeyWillChange(size_t key) -> bool { return key % 5 == 0; }
 auto main(int argc, char **argv) -> int {
   using bustub::AccessType;
   using bustub::BufferPoolManager;
-  using bustub::DiskManagerUnlimitedMemory;
+  using bustub::DeviceProfile;
+  using bustub::DiskManagerSimulated;
   using bustub::page_id_t;
 
   argparse::ArgumentParser program("bustub-btree-bench");
   program.add_argument("--duration").help("run btree bench for n milliseconds");
+  program.add_argument("--device").help("simulate a storage device: instant (default), nvme, ssd or hdd");
 
   try {
     program.parse_args(argc, argv);
@@ -133,11 +135,21 @@ auto main(int argc, char **argv) -> int {
     duration_ms = std::stoi(program.get("--duration"));
   }
 
-  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  std::string device_name = "instant";
+  if (program.present("--device")) {
+    device_name = program.get("--device");
+  }
+  auto device = DeviceProfile::FromName(device_name);
+  if (!device.has_value()) {
+    std::cerr << "unknown device " << device_name << std::endl;
+    return 1;
+  }
+
+  auto disk_manager = std::make_unique<DiskManagerSimulated>();
   auto bpm = std::make_unique<BufferPoolManager>(BUSTUB_BPM_SIZE, disk_manager.get(), LRU_K_SIZE);
 
-  fmt::print(stderr, "[info] total_keys={}, duration_ms={}, lru_k_size={}, bpm_size={}\n", TOTAL_KEYS, duration_ms,
-             LRU_K_SIZE, BUSTUB_BPM_SIZE);
+  fmt::print(stderr, "[info] total_keys={}, duration_ms={}, lru_k_size={}, bpm_size={}, device={}\n", TOTAL_KEYS,
+             duration_ms, LRU_K_SIZE, BUSTUB_BPM_SIZE, device_name);
 
   auto key_schema = bustub::ParseCreateStatement("a bigint");
   bustub::GenericComparator<8> comparator(key_schema.get());
@@ -157,6 +169,9 @@ auto main(int argc, char **argv) -> int {
     index.Insert(index_key, rid, nullptr);
   }
 
+  // enable disk latency after loading all keys
+  disk_manager->SetProfile(*device);
+
   fmt::print(stderr, "[info] benchmark start\n");
 
   BTreeTotalMetrics total_metrics;
@@ -0,0 +1,124 @@
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+
+#include <cpp_random_distributions/zipfian_int_distribution.h>
+
+#include "argparse/argparse.hpp"
+#include "buffer/arc_replacer.h"
+#include "buffer/clock_replacer.h"
+#include "buffer/lru_k_replacer.h"
+#include "buffer/lru_replacer.h"
+#include "common/config.h"
+#include "fmt/core.h"
+
+/** Run `ops` iterations of `op` and print the average latency. */
+template <typename Op>
+void Measure(const std::string &name, size_t ops, Op op) {
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < ops; i++) {
+    op(i);
+  }
+  auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  fmt::print("{:<8} ops={:<10} ns/op={:<10.1f} ops/sec={:.0f}\n", name, ops, elapsed / ops, ops / elapsed * 1e9);
+}
+
+// NOLINTNEXTLINE
+auto main(int argc, char **argv) -> int {
+  using bustub::AccessType;
+  using bustub::frame_id_t;
+  using bustub::Replacer;
+
+  argparse::ArgumentParser program("bustub-replacer-bench");
+  program.add_argument("--frames").help("number of frames in the replacer");
+  program.add_argument("--k").help("lookback window of the lru-k replacer");
+  program.add_argument("--ops").help("number of operations per phase");
+  program.add_argument("--replacer").help("replacement policy: lru-k (default), lru, clock or arc");
+
+  try {
+    program.parse_args(argc, argv);
+  } catch (const std::runtime_error &err) {
+    std::cerr << err.what() << std::endl;
+    std::cerr << program;
+    return 1;
+  }
+
+  size_t num_frames = 100000;
+  if (program.present("--frames")) {
+    num_frames = std::stoul(program.get("--frames"));
+  }
+
+  size_t k = bustub::LRUK_REPLACER_K;
+  if (program.present("--k")) {
+    k = std::stoul(program.get("--k"));
+  }
+
+  size_t ops = 1000000;
+  if (program.present("--ops")) {
+    ops = std::stoul(program.get("--ops"));
+  }
+
+  std::string replacer_name = "lru-k";
+  if (program.present("--replacer")) {
+    replacer_name = program.get("--replacer");
+  }
+  std::unique_ptr<Replacer> replacer_ptr;
+  if (replacer_name == "lru-k") {
+    replacer_ptr = std::make_unique<bustub::LRUKReplacer>(num_frames, k);
+  } else if (replacer_name == "lru") {
+    replacer_ptr = std::make_unique<bustub::LRUReplacer>(num_frames);
+  } else if (replacer_name == "clock") {
+    replacer_ptr = std::make_unique<bustub::ClockReplacer>(num_frames);
+  } else if (replacer_name == "arc") {
+    replacer_ptr = std::make_unique<bustub::ARCReplacer>(num_frames);
+  } else {
+    std::cerr << "unknown replacer " << replacer_name << std::endl;
+    return 1;
+  }
+  auto &replacer = *replacer_ptr;
+
+  fmt::print(stderr, "[info] replacer={}, frames={}, k={}, ops={}\n", replacer_name, num_frames, k, ops);
+
+  std::default_random_engine gen(42);
+  zipfian_int_distribution<frame_id_t> dist(0, num_frames - 1, 0.8);
+
+  // every frame gets a full K-history, like a warmed-up buffer pool
+  Measure("fill", num_frames * k, [&](size_t i) {
+    auto frame_id = static_cast<frame_id_t>(i % num_frames);
+    replacer.RecordAccess(frame_id, AccessType::Get);
+  });
+
+  // a buffer pool hit pins the frame, records the access and unpins it again
+  Measure("hit", ops, [&](size_t) {
+    auto frame_id = dist(gen);
+    replacer.SetEvictable(frame_id, false);
+    replacer.RecordAccess(frame_id, AccessType::Get);
+    replacer.SetEvictable(frame_id, true);
+  });
+
+  // a buffer pool miss evicts a victim and reuses its frame for the new page
+  Measure("miss", ops, [&](size_t) {
+    frame_id_t frame_id;
+    if (!replacer.Evict(&frame_id)) {
+      throw std::runtime_error("nothing to evict");
+    }
+    replacer.RecordAccess(frame_id, AccessType::Get);
+    replacer.SetEvictable(frame_id, false);
+    replacer.SetEvictable(frame_id, true);
+  });
+
+  // a sequential scan recycles frames through the scan ring
+  Measure("scan", ops, [&](size_t) {
+    frame_id_t frame_id;
+    if (!replacer.Evict(&frame_id)) {
+      throw std::runtime_error("nothing to evict");
+    }
+    replacer.RecordAccess(frame_id, AccessType::Scan);
+    replacer.SetEvictable(frame_id, false);
+    replacer.SetEvictable(frame_id, true);
+  });
+
+  return 0;
+}
@@ -1,9 +1,12 @@
+#include <cstdlib>
 #include <iostream>
+#include <memory>
 #include <string>
 #include "binder/binder.h"
 #include "common/bustub_instance.h"
 #include "common/exception.h"
 #include "common/util/string_util.h"
+#include "storage/disk/disk_manager_snapshot.h"
 #include "libfort/lib/fort.hpp"
 #include "linenoise/linenoise.h"
 #include "utf8proc/utf8proc.h"
@@ -27,27 +30,52 @@ auto GetWidthOfUtf8(const void *beg, const void *end, size_t *width) -> int {
 auto main(int argc, char **argv) -> int {
   ft_set_u8strwid_func(&GetWidthOfUtf8);
 
-  auto bustub = std::make_unique<bustub::BustubInstance>("test.db");
-
   auto default_prompt = "bustub> ";
   auto emoji_prompt = "\U0001f6c1> ";  // the bathtub emoji
   bool use_emoji_prompt = false;
   bool disable_tty = false;
+  bool use_direct_io = false;
+  bool read_only = false;
+  size_t scrub_mb_per_second = 0;
 
   for (int i = 1; i < argc; i++) {
     if (strcmp(argv[i], "--emoji-prompt") == 0) {
       use_emoji_prompt = true;
-      break;
     }
     if (strcmp(argv[i], "--disable-tty") == 0) {
       disable_tty = true;
-      break;
+    }
+    if (strcmp(argv[i], "--direct-io") == 0) {
+      use_direct_io = true;
+    }
+    if (strcmp(argv[i], "--read-only") == 0) {
+      read_only = true;
+    }
+    if (strcmp(argv[i], "--scrub") == 0 && i + 1 < argc) {
+      scrub_mb_per_second = std::strtoul(argv[++i], nullptr, 10);
     }
   }
 
+  std::unique_ptr<bustub::BustubInstance> bustub;
+  try {
+    // a read-only shell maps test.db and serves its pages without copying them into the buffer pool
+    bustub = read_only ? std::make_unique<bustub::BustubInstance>(new bustub::DiskManagerSnapshot("test.db"))
+                       : std::make_unique<bustub::BustubInstance>("test.db", use_direct_io);
+  } catch (bustub::Exception &ex) {
+    std::cerr << ex.what() << std::endl;
+    if (read_only) {
+      std::cerr << "usage: --read-only needs an existing test.db, run the shell once without it to create one"
+                << std::endl;
+    }
+    return 1;
+  }
+
+  // verify the checksums of the whole db file in the background, at the given bandwidth in MB/s
+  bustub->disk_manager_->StartScrubber(scrub_mb_per_second * 1024 * 1024);
+
   bustub->GenerateMockTable();
 
-  if (bustub->buffer_pool_manager_ != nullptr) {
+  if (bustub->buffer_pool_manager_ != nullptr && !read_only) {
     bustub->GenerateTestTable();
   }
 
@@ -17,6 +17,7 @@
 #include "concurrency/transaction_manager.h"
 #include "fmt/core.h"
 #include "fmt/std.h"
+#include "storage/disk/disk_manager_simulated.h"
 #include "terrier_bench_config.h"
 
 #include <sys/time.h>
@@ -141,6 +142,7 @@ auto main(int argc, char **argv) -> int {
   program.add_argument("--force-create-index").help("create index in terrier bench");
   program.add_argument("--force-enable-update").help("use update statement in terrier bench");
   program.add_argument("--nft").help("number of NFTs in the bench");
+  program.add_argument("--device").help("simulate a storage device: instant (default), nvme, ssd or hdd");
 
   size_t bustub_nft_num = 10;
 
@@ -152,7 +154,18 @@ auto main(int argc, char **argv) -> int {
     return 1;
   }
 
-  auto bustub = std::make_unique<bustub::BustubInstance>();
+  std::string device_name = "instant";
+  if (program.present("--device")) {
+    device_name = program.get("--device");
+  }
+  auto device = bustub::DeviceProfile::FromName(device_name);
+  if (!device.has_value()) {
+    std::cerr << "unknown device " << device_name << std::endl;
+    return 1;
+  }
+
+  auto *disk_manager = new bustub::DiskManagerSimulated();
+  auto bustub = std::make_unique<bustub::BustubInstance>(disk_manager);
   auto writer = bustub::SimpleStreamWriter(std::cerr);
 
   // create schema
@@ -234,6 +247,10 @@ auto main(int argc, char **argv) -> int {
     }
   }
 
+  // enable disk latency after loading the data
+  std::cerr << "x: device=" << device_name << std::endl;
+  disk_manager->SetProfile(*device);
+
   std::cerr << "x: benchmark start" << std::endl;
 
   std::vector<std::thread> threads;